@@ -0,0 +1,192 @@
+// Just enough of Avro object container files for Iceberg manifests: files are written uncompressed,
+// and read back only by code that knows the schema they were written with.
+
+use std::error::Error;
+
+const MAGIC: &[u8] = b"Obj\x01";
+const SYNC_SIZE: usize = 16;
+
+// 16 random bytes from the operating system, for sync markers and the names and IDs of Iceberg
+// metadata
+pub fn random_bytes() -> Result<[u8; 16], Box<dyn Error>> {
+    let mut bytes = [0u8; 16];
+    getrandom::getrandom(&mut bytes)?;
+    Ok(bytes)
+}
+
+pub fn write_long(buf: &mut Vec<u8>, value: i64) {
+    let mut n = ((value << 1) ^ (value >> 63)) as u64;
+    while n & !0x7f != 0 {
+        buf.push((n & 0x7f) as u8 | 0x80);
+        n >>= 7;
+    }
+    buf.push(n as u8);
+}
+
+pub fn write_int(buf: &mut Vec<u8>, value: i32) {
+    write_long(buf, value as i64);
+}
+
+pub fn write_boolean(buf: &mut Vec<u8>, value: bool) {
+    buf.push(value as u8);
+}
+
+pub fn write_float(buf: &mut Vec<u8>, value: f32) {
+    buf.extend_from_slice(&value.to_le_bytes());
+}
+
+pub fn write_double(buf: &mut Vec<u8>, value: f64) {
+    buf.extend_from_slice(&value.to_le_bytes());
+}
+
+pub fn write_bytes(buf: &mut Vec<u8>, value: &[u8]) {
+    write_long(buf, value.len() as i64);
+    buf.extend_from_slice(value);
+}
+
+pub fn write_string(buf: &mut Vec<u8>, value: &str) {
+    write_bytes(buf, value.as_bytes());
+}
+
+// A file of the given records, each already encoded, in a single block
+pub fn write_file(
+    schema: &str,
+    metadata: &[(&str, String)],
+    records: &[Vec<u8>],
+) -> Result<Vec<u8>, Box<dyn Error>> {
+    let sync = random_bytes()?;
+    let mut buf = MAGIC.to_vec();
+    write_long(&mut buf, metadata.len() as i64 + 2);
+    write_string(&mut buf, "avro.schema");
+    write_string(&mut buf, schema);
+    write_string(&mut buf, "avro.codec");
+    write_string(&mut buf, "null");
+    for (key, value) in metadata {
+        write_string(&mut buf, key);
+        write_string(&mut buf, value);
+    }
+    write_long(&mut buf, 0);
+    buf.extend_from_slice(&sync);
+    if !records.is_empty() {
+        write_long(&mut buf, records.len() as i64);
+        write_long(
+            &mut buf,
+            records.iter().map(|record| record.len()).sum::<usize>() as i64,
+        );
+        for record in records {
+            buf.extend_from_slice(record);
+        }
+        buf.extend_from_slice(&sync);
+    }
+    Ok(buf)
+}
+
+pub struct Reader<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, len: usize) -> Result<&'a [u8], Box<dyn Error>> {
+        if self.data.len() - self.pos < len {
+            return Err("truncated Avro file".into());
+        }
+        let bytes = &self.data[self.pos..self.pos + len];
+        self.pos += len;
+        Ok(bytes)
+    }
+
+    pub fn read_long(&mut self) -> Result<i64, Box<dyn Error>> {
+        let mut n: u64 = 0;
+        let mut shift = 0;
+        loop {
+            let byte = self.take(1)?[0];
+            if shift > 63 {
+                return Err("invalid Avro long".into());
+            }
+            n |= ((byte & 0x7f) as u64) << shift;
+            if byte & 0x80 == 0 {
+                break;
+            }
+            shift += 7;
+        }
+        Ok((n >> 1) as i64 ^ -((n & 1) as i64))
+    }
+
+    pub fn read_int(&mut self) -> Result<i32, Box<dyn Error>> {
+        Ok(i32::try_from(self.read_long()?)?)
+    }
+
+    pub fn read_boolean(&mut self) -> Result<bool, Box<dyn Error>> {
+        Ok(self.take(1)?[0] != 0)
+    }
+
+    pub fn read_float(&mut self) -> Result<f32, Box<dyn Error>> {
+        Ok(f32::from_le_bytes(self.take(4)?.try_into()?))
+    }
+
+    pub fn read_double(&mut self) -> Result<f64, Box<dyn Error>> {
+        Ok(f64::from_le_bytes(self.take(8)?.try_into()?))
+    }
+
+    pub fn read_fixed(&mut self, size: usize) -> Result<&'a [u8], Box<dyn Error>> {
+        self.take(size)
+    }
+
+    pub fn read_bytes(&mut self) -> Result<&'a [u8], Box<dyn Error>> {
+        let len = usize::try_from(self.read_long()?)?;
+        self.take(len)
+    }
+
+    pub fn read_string(&mut self) -> Result<String, Box<dyn Error>> {
+        Ok(std::str::from_utf8(self.read_bytes()?)?.to_string())
+    }
+
+    // Item count of the next block of an array or map, 0 once it ends
+    pub fn read_block_count(&mut self) -> Result<i64, Box<dyn Error>> {
+        let count = self.read_long()?;
+        if count < 0 {
+            // Followed by the block size in bytes, which readers that decode every item don't need
+            self.read_long()?;
+            return Ok(-count);
+        }
+        Ok(count)
+    }
+}
+
+// Decodes the records of a file written with the schema read_record expects
+pub fn read_file<T>(
+    data: &[u8],
+    mut read_record: impl FnMut(&mut Reader) -> Result<T, Box<dyn Error>>,
+) -> Result<Vec<T>, Box<dyn Error>> {
+    let mut reader = Reader { data, pos: 0 };
+    if reader.take(MAGIC.len())? != MAGIC {
+        return Err("not an Avro file".into());
+    }
+    loop {
+        let count = reader.read_block_count()?;
+        if count == 0 {
+            break;
+        }
+        for _ in 0..count {
+            let key = reader.read_string()?;
+            let value = reader.read_bytes()?;
+            if key == "avro.codec" && value != b"null" {
+                return Err("compressed Avro files are not supported".into());
+            }
+        }
+    }
+    let sync = reader.take(SYNC_SIZE)?;
+    let mut records = Vec::new();
+    while reader.pos < data.len() {
+        let count = reader.read_long()?;
+        reader.read_long()?;
+        for _ in 0..count {
+            records.push(read_record(&mut reader)?);
+        }
+        if reader.take(SYNC_SIZE)? != sync {
+            return Err("corrupt Avro block".into());
+        }
+    }
+    Ok(records)
+}
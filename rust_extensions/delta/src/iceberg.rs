@@ -0,0 +1,1215 @@
+// Iceberg (format version 2) metadata for columnstore tables, written next to their data files:
+// metadata/v<N>.metadata.json with metadata/version-hint.text pointing at the latest, as Hadoop
+// catalogs (and DuckDB's iceberg_scan) expect. Each commit is one snapshot, whose manifest list
+// reuses the manifests of the previous snapshot that no removed data file is in.
+
+use crate::avro;
+use crate::{file_actions, parse_storage_options, runtime, skip_applied_actions, FileAction};
+use cxx::{CxxString, CxxVector};
+use deltalake::{DeltaTableBuilder, ObjectStore, Path};
+use serde_json::{json, Value};
+use std::collections::{HashMap, HashSet};
+use std::error::Error;
+use std::sync::{Arc, Mutex, OnceLock};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+const EXISTING: i32 = 0;
+const ADDED: i32 = 1;
+const DELETED: i32 = 2;
+
+// Past this many manifests, small ones are merged into the manifest of the next commit
+const MAX_MANIFESTS: usize = 100;
+const MIN_MANIFEST_ENTRIES: usize = 1000;
+
+const VERSION_HINT: &str = "metadata/version-hint.text";
+
+#[derive(Clone)]
+struct DataFile {
+    file_path: String,
+    // Values of the partition fields, see partition_value
+    partition: Vec<Value>,
+    record_count: i64,
+    file_size: i64,
+    value_counts: Vec<(i32, i64)>,
+    null_value_counts: Vec<(i32, i64)>,
+    lower_bounds: Vec<(i32, Vec<u8>)>,
+    upper_bounds: Vec<(i32, Vec<u8>)>,
+}
+
+#[derive(Clone)]
+struct ManifestEntry {
+    status: i32,
+    snapshot_id: i64,
+    sequence_number: i64,
+    file_sequence_number: i64,
+    data_file: DataFile,
+}
+
+#[derive(Clone)]
+struct ManifestFile {
+    path: String,
+    length: i64,
+    sequence_number: i64,
+    min_sequence_number: i64,
+    added_snapshot_id: i64,
+    added_files: i32,
+    existing_files: i32,
+    deleted_files: i32,
+    added_rows: i64,
+    existing_rows: i64,
+    deleted_rows: i64,
+}
+
+// Identity partition of a table column, with the Iceberg type of that column
+struct PartitionField {
+    name: String,
+    field_id: i32,
+    field_type: String,
+}
+
+struct CachedTable {
+    options: String,
+    store: Arc<dyn ObjectStore>,
+    version: i64,
+    metadata: Value,
+    // Manifests of the current snapshot
+    manifests: Vec<ManifestFile>,
+    // Entries by manifest location, manifests never change once written
+    manifest_entries: HashMap<String, Vec<ManifestEntry>>,
+}
+
+// Opened tables by path, like the Delta tables in lib.rs
+fn cached_tables() -> &'static Mutex<HashMap<String, CachedTable>> {
+    static TABLES: OnceLock<Mutex<HashMap<String, CachedTable>>> = OnceLock::new();
+    TABLES.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+fn object_store(path: &str, options: &str) -> Result<Arc<dyn ObjectStore>, Box<dyn Error>> {
+    let storage_options = parse_storage_options(options)?;
+    let log_store = DeltaTableBuilder::from_valid_uri(path)?
+        .with_storage_options(storage_options)
+        .build_storage()?;
+    Ok(log_store.object_store())
+}
+
+async fn read_file(store: &Arc<dyn ObjectStore>, path: &str) -> Result<Vec<u8>, Box<dyn Error>> {
+    Ok(store.get(&Path::from(path)).await?.bytes().await?.to_vec())
+}
+
+async fn write_file(
+    store: &Arc<dyn ObjectStore>,
+    path: &str,
+    data: Vec<u8>,
+) -> Result<(), Box<dyn Error>> {
+    store.put(&Path::from(path), data.into()).await?;
+    Ok(())
+}
+
+fn now_ms() -> i64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map_or(0, |duration| duration.as_millis() as i64)
+}
+
+// Random (version 4) UUID, in its hyphenated form
+fn new_uuid() -> Result<String, Box<dyn Error>> {
+    let mut bytes = avro::random_bytes()?;
+    bytes[6] = (bytes[6] & 0x0f) | 0x40;
+    bytes[8] = (bytes[8] & 0x3f) | 0x80;
+    let hex: String = bytes.iter().map(|byte| format!("{:02x}", byte)).collect();
+    Ok(format!(
+        "{}-{}-{}-{}-{}",
+        &hex[0..8],
+        &hex[8..12],
+        &hex[12..16],
+        &hex[16..20],
+        &hex[20..32]
+    ))
+}
+
+fn table_location(path: &str) -> String {
+    path.trim_end_matches('/').to_string()
+}
+
+// Metadata files are referenced by location, and read back relative to the table
+fn relative_path<'a>(location: &str, file_location: &'a str) -> Result<&'a str, Box<dyn Error>> {
+    file_location
+        .strip_prefix(location)
+        .and_then(|path| path.strip_prefix('/'))
+        .ok_or_else(|| format!("{} is not under {}", file_location, location).into())
+}
+
+fn property(metadata: &Value, key: &str) -> Option<i64> {
+    metadata["properties"][key].as_str()?.parse().ok()
+}
+
+fn max_field_id(field_type: &Value) -> i64 {
+    match field_type {
+        Value::Object(object) => {
+            let own_id = ["id", "element-id"]
+                .iter()
+                .filter_map(|key| object.get(*key).and_then(Value::as_i64))
+                .max()
+                .unwrap_or(0);
+            let child_id = ["fields", "type", "element"]
+                .iter()
+                .filter_map(|key| object.get(*key))
+                .map(max_field_id)
+                .max()
+                .unwrap_or(0);
+            own_id.max(child_id)
+        }
+        Value::Array(array) => array.iter().map(max_field_id).max().unwrap_or(0),
+        _ => 0,
+    }
+}
+
+fn partition_fields(metadata: &Value) -> Result<Vec<PartitionField>, Box<dyn Error>> {
+    let columns = metadata["schemas"][0]["fields"]
+        .as_array()
+        .ok_or("Iceberg schema has no fields")?;
+    let mut fields = Vec::new();
+    for field in metadata["partition-specs"][0]["fields"]
+        .as_array()
+        .ok_or("Iceberg partition spec has no fields")?
+    {
+        let column = columns
+            .iter()
+            .find(|column| column["id"] == field["source-id"])
+            .ok_or("Iceberg partition field has no source column")?;
+        fields.push(PartitionField {
+            name: field["name"].as_str().unwrap_or_default().to_string(),
+            field_id: field["field-id"].as_i64().unwrap_or_default() as i32,
+            field_type: column["type"].as_str().unwrap_or_default().to_string(),
+        });
+    }
+    Ok(fields)
+}
+
+// Precision and scale of decimal(P, S)
+fn decimal_type(field_type: &str) -> Option<(u32, u32)> {
+    let (precision, scale) = field_type
+        .strip_prefix("decimal(")?
+        .strip_suffix(')')?
+        .split_once(',')?;
+    Some((precision.trim().parse().ok()?, scale.trim().parse().ok()?))
+}
+
+// Bytes of the fixed that holds a decimal of this precision, as Iceberg sizes them
+fn decimal_size(precision: u32) -> usize {
+    let mut size = 1;
+    while 2f64.powi(8 * size as i32 - 1) < 10f64.powi(precision as i32) {
+        size += 1;
+    }
+    size
+}
+
+fn partition_avro_type(field: &PartitionField) -> Result<Value, Box<dyn Error>> {
+    let avro_type = match field.field_type.as_str() {
+        "boolean" | "int" | "long" | "float" | "double" | "string" => json!(field.field_type),
+        "date" => json!({"type": "int", "logicalType": "date"}),
+        "timestamp" | "timestamptz" => json!({
+            "type": "long",
+            "logicalType": "timestamp-micros",
+            "adjust-to-utc": field.field_type == "timestamptz",
+        }),
+        field_type => {
+            let (precision, scale) = decimal_type(field_type)
+                .ok_or(format!("unsupported partition type {}", field_type))?;
+            json!({
+                "type": "fixed",
+                "name": format!("fixed_{}", field.field_id),
+                "size": decimal_size(precision),
+                "logicalType": "decimal",
+                "precision": precision,
+                "scale": scale,
+            })
+        }
+    };
+    Ok(json!({
+        "name": field.name,
+        "type": ["null", avro_type],
+        "default": null,
+        "field-id": field.field_id,
+    }))
+}
+
+// Iceberg maps are Avro arrays of key-value records
+fn map_avro_field(
+    name: &str,
+    field_id: i32,
+    key_id: i32,
+    value_id: i32,
+    value_type: &str,
+) -> Value {
+    json!({
+        "name": name,
+        "type": ["null", {
+            "type": "array",
+            "items": {
+                "type": "record",
+                "name": format!("k{}_v{}", key_id, value_id),
+                "fields": [
+                    {"name": "key", "type": "int", "field-id": key_id},
+                    {"name": "value", "type": value_type, "field-id": value_id},
+                ],
+            },
+            "logicalType": "map",
+        }],
+        "default": null,
+        "field-id": field_id,
+    })
+}
+
+fn manifest_entry_schema(partition_fields: &[PartitionField]) -> Result<Value, Box<dyn Error>> {
+    let partition_fields = partition_fields
+        .iter()
+        .map(partition_avro_type)
+        .collect::<Result<Vec<Value>, Box<dyn Error>>>()?;
+    Ok(json!({
+        "type": "record",
+        "name": "manifest_entry",
+        "fields": [
+            {"name": "status", "type": "int", "field-id": 0},
+            {"name": "snapshot_id", "type": ["null", "long"], "default": null, "field-id": 1},
+            {"name": "sequence_number", "type": ["null", "long"], "default": null, "field-id": 3},
+            {
+                "name": "file_sequence_number",
+                "type": ["null", "long"],
+                "default": null,
+                "field-id": 4,
+            },
+            {"name": "data_file", "type": {
+                "type": "record",
+                "name": "r2",
+                "fields": [
+                    {"name": "content", "type": "int", "field-id": 134},
+                    {"name": "file_path", "type": "string", "field-id": 100},
+                    {"name": "file_format", "type": "string", "field-id": 101},
+                    {"name": "partition", "type": {
+                        "type": "record",
+                        "name": "r102",
+                        "fields": partition_fields,
+                    }, "field-id": 102},
+                    {"name": "record_count", "type": "long", "field-id": 103},
+                    {"name": "file_size_in_bytes", "type": "long", "field-id": 104},
+                    map_avro_field("value_counts", 109, 119, 120, "long"),
+                    map_avro_field("null_value_counts", 110, 121, 122, "long"),
+                    map_avro_field("lower_bounds", 125, 126, 127, "bytes"),
+                    map_avro_field("upper_bounds", 128, 129, 130, "bytes"),
+                ],
+            }, "field-id": 2},
+        ],
+    }))
+}
+
+fn manifest_file_schema() -> Value {
+    let field = |name: &str, field_type: &str, field_id: i32| {
+        json!({"name": name, "type": field_type, "field-id": field_id})
+    };
+    json!({
+        "type": "record",
+        "name": "manifest_file",
+        "fields": [
+            field("manifest_path", "string", 500),
+            field("manifest_length", "long", 501),
+            field("partition_spec_id", "int", 502),
+            field("content", "int", 517),
+            field("sequence_number", "long", 515),
+            field("min_sequence_number", "long", 516),
+            field("added_snapshot_id", "long", 503),
+            field("added_files_count", "int", 504),
+            field("existing_files_count", "int", 505),
+            field("deleted_files_count", "int", 506),
+            field("added_rows_count", "long", 512),
+            field("existing_rows_count", "long", 513),
+            field("deleted_rows_count", "long", 514),
+        ],
+    })
+}
+
+// Partition values come from the columnstore as JSON: numbers as Iceberg stores them, decimals as
+// their unscaled value in a string
+fn write_partition_value(
+    buf: &mut Vec<u8>,
+    field: &PartitionField,
+    value: &Value,
+) -> Result<(), Box<dyn Error>> {
+    if value.is_null() {
+        avro::write_long(buf, 0);
+        return Ok(());
+    }
+    avro::write_long(buf, 1);
+    let invalid = || format!("invalid value {} of partition {}", value, field.name);
+    match field.field_type.as_str() {
+        "boolean" => avro::write_boolean(buf, value.as_bool().ok_or_else(invalid)?),
+        "int" | "date" => avro::write_int(buf, i32::try_from(value.as_i64().ok_or_else(invalid)?)?),
+        "long" | "timestamp" | "timestamptz" => {
+            avro::write_long(buf, value.as_i64().ok_or_else(invalid)?)
+        }
+        "float" => avro::write_float(buf, value.as_f64().ok_or_else(invalid)? as f32),
+        "double" => avro::write_double(buf, value.as_f64().ok_or_else(invalid)?),
+        "string" => avro::write_string(buf, value.as_str().ok_or_else(invalid)?),
+        field_type => {
+            let (precision, _) = decimal_type(field_type).ok_or_else(invalid)?;
+            let unscaled: i128 = value.as_str().ok_or_else(invalid)?.parse()?;
+            let size = decimal_size(precision);
+            buf.extend_from_slice(&unscaled.to_be_bytes()[16 - size..]);
+        }
+    }
+    Ok(())
+}
+
+fn read_partition_value(
+    reader: &mut avro::Reader,
+    field: &PartitionField,
+) -> Result<Value, Box<dyn Error>> {
+    if reader.read_long()? == 0 {
+        return Ok(Value::Null);
+    }
+    Ok(match field.field_type.as_str() {
+        "boolean" => json!(reader.read_boolean()?),
+        "int" | "date" => json!(reader.read_int()?),
+        "long" | "timestamp" | "timestamptz" => json!(reader.read_long()?),
+        "float" => json!(reader.read_float()?),
+        "double" => json!(reader.read_double()?),
+        "string" => json!(reader.read_string()?),
+        field_type => {
+            let (precision, _) = decimal_type(field_type).ok_or("invalid decimal partition")?;
+            let bytes = reader.read_fixed(decimal_size(precision))?;
+            // Sign-extended to 16 bytes
+            let mut unscaled = [if bytes[0] & 0x80 != 0 { 0xff } else { 0 }; 16];
+            unscaled[16 - bytes.len()..].copy_from_slice(bytes);
+            json!(i128::from_be_bytes(unscaled).to_string())
+        }
+    })
+}
+
+fn write_long_map(buf: &mut Vec<u8>, map: &[(i32, i64)]) {
+    avro::write_long(buf, 1);
+    if !map.is_empty() {
+        avro::write_long(buf, map.len() as i64);
+        for (key, value) in map {
+            avro::write_int(buf, *key);
+            avro::write_long(buf, *value);
+        }
+    }
+    avro::write_long(buf, 0);
+}
+
+fn write_bytes_map(buf: &mut Vec<u8>, map: &[(i32, Vec<u8>)]) {
+    avro::write_long(buf, 1);
+    if !map.is_empty() {
+        avro::write_long(buf, map.len() as i64);
+        for (key, value) in map {
+            avro::write_int(buf, *key);
+            avro::write_bytes(buf, value);
+        }
+    }
+    avro::write_long(buf, 0);
+}
+
+fn read_long_map(reader: &mut avro::Reader) -> Result<Vec<(i32, i64)>, Box<dyn Error>> {
+    let mut map = Vec::new();
+    if reader.read_long()? == 0 {
+        return Ok(map);
+    }
+    loop {
+        let count = reader.read_block_count()?;
+        if count == 0 {
+            return Ok(map);
+        }
+        for _ in 0..count {
+            map.push((reader.read_int()?, reader.read_long()?));
+        }
+    }
+}
+
+fn read_bytes_map(reader: &mut avro::Reader) -> Result<Vec<(i32, Vec<u8>)>, Box<dyn Error>> {
+    let mut map = Vec::new();
+    if reader.read_long()? == 0 {
+        return Ok(map);
+    }
+    loop {
+        let count = reader.read_block_count()?;
+        if count == 0 {
+            return Ok(map);
+        }
+        for _ in 0..count {
+            map.push((reader.read_int()?, reader.read_bytes()?.to_vec()));
+        }
+    }
+}
+
+fn write_manifest_entry(
+    entry: &ManifestEntry,
+    partition_fields: &[PartitionField],
+) -> Result<Vec<u8>, Box<dyn Error>> {
+    let mut buf = Vec::new();
+    avro::write_int(&mut buf, entry.status);
+    for value in [
+        entry.snapshot_id,
+        entry.sequence_number,
+        entry.file_sequence_number,
+    ] {
+        avro::write_long(&mut buf, 1);
+        avro::write_long(&mut buf, value);
+    }
+    let data_file = &entry.data_file;
+    avro::write_int(&mut buf, 0 /*content: data*/);
+    avro::write_string(&mut buf, &data_file.file_path);
+    avro::write_string(&mut buf, "PARQUET");
+    for (field, value) in partition_fields.iter().zip(data_file.partition.iter()) {
+        write_partition_value(&mut buf, field, value)?;
+    }
+    avro::write_long(&mut buf, data_file.record_count);
+    avro::write_long(&mut buf, data_file.file_size);
+    write_long_map(&mut buf, &data_file.value_counts);
+    write_long_map(&mut buf, &data_file.null_value_counts);
+    write_bytes_map(&mut buf, &data_file.lower_bounds);
+    write_bytes_map(&mut buf, &data_file.upper_bounds);
+    Ok(buf)
+}
+
+fn read_optional_long(reader: &mut avro::Reader) -> Result<Option<i64>, Box<dyn Error>> {
+    if reader.read_long()? == 0 {
+        return Ok(None);
+    }
+    Ok(Some(reader.read_long()?))
+}
+
+// Entries of manifests this module wrote, whose sequence numbers are never left to inheritance
+fn read_manifest_entry(
+    reader: &mut avro::Reader,
+    partition_fields: &[PartitionField],
+) -> Result<ManifestEntry, Box<dyn Error>> {
+    let status = reader.read_int()?;
+    let snapshot_id = read_optional_long(reader)?.ok_or("manifest entry has no snapshot_id")?;
+    let sequence_number =
+        read_optional_long(reader)?.ok_or("manifest entry has no sequence_number")?;
+    let file_sequence_number = read_optional_long(reader)?.unwrap_or(sequence_number);
+    reader.read_int()?;
+    let file_path = reader.read_string()?;
+    reader.read_string()?;
+    let partition = partition_fields
+        .iter()
+        .map(|field| read_partition_value(reader, field))
+        .collect::<Result<Vec<Value>, Box<dyn Error>>>()?;
+    Ok(ManifestEntry {
+        status,
+        snapshot_id,
+        sequence_number,
+        file_sequence_number,
+        data_file: DataFile {
+            file_path,
+            partition,
+            record_count: reader.read_long()?,
+            file_size: reader.read_long()?,
+            value_counts: read_long_map(reader)?,
+            null_value_counts: read_long_map(reader)?,
+            lower_bounds: read_bytes_map(reader)?,
+            upper_bounds: read_bytes_map(reader)?,
+        },
+    })
+}
+
+fn write_manifest_file(manifest: &ManifestFile) -> Vec<u8> {
+    let mut buf = Vec::new();
+    avro::write_string(&mut buf, &manifest.path);
+    avro::write_long(&mut buf, manifest.length);
+    avro::write_int(&mut buf, 0 /*partition_spec_id*/);
+    avro::write_int(&mut buf, 0 /*content: data*/);
+    avro::write_long(&mut buf, manifest.sequence_number);
+    avro::write_long(&mut buf, manifest.min_sequence_number);
+    avro::write_long(&mut buf, manifest.added_snapshot_id);
+    avro::write_int(&mut buf, manifest.added_files);
+    avro::write_int(&mut buf, manifest.existing_files);
+    avro::write_int(&mut buf, manifest.deleted_files);
+    avro::write_long(&mut buf, manifest.added_rows);
+    avro::write_long(&mut buf, manifest.existing_rows);
+    avro::write_long(&mut buf, manifest.deleted_rows);
+    buf
+}
+
+fn read_manifest_file(reader: &mut avro::Reader) -> Result<ManifestFile, Box<dyn Error>> {
+    let path = reader.read_string()?;
+    let length = reader.read_long()?;
+    reader.read_int()?;
+    reader.read_int()?;
+    Ok(ManifestFile {
+        path,
+        length,
+        sequence_number: reader.read_long()?,
+        min_sequence_number: reader.read_long()?,
+        added_snapshot_id: reader.read_long()?,
+        added_files: reader.read_int()?,
+        existing_files: reader.read_int()?,
+        deleted_files: reader.read_int()?,
+        added_rows: reader.read_long()?,
+        existing_rows: reader.read_long()?,
+        deleted_rows: reader.read_long()?,
+    })
+}
+
+fn hex_decode(hex: &str) -> Result<Vec<u8>, Box<dyn Error>> {
+    (0..hex.len())
+        .step_by(2)
+        .map(|i| -> Result<u8, Box<dyn Error>> {
+            Ok(u8::from_str_radix(
+                hex.get(i..i + 2).ok_or("invalid hex")?,
+                16,
+            )?)
+        })
+        .collect()
+}
+
+// Stats come from the columnstore as JSON keyed by field ID, with bounds hex-encoded
+fn parse_data_file(
+    file_path: &str,
+    file_size: i64,
+    partition_values: &str,
+    stats: &str,
+    partition_fields: &[PartitionField],
+) -> Result<DataFile, Box<dyn Error>> {
+    let partition_values: Value = serde_json::from_str(partition_values)?;
+    let stats: Value = serde_json::from_str(stats)?;
+    let field_ids = |key: &str| -> Result<Vec<(i32, Value)>, Box<dyn Error>> {
+        let mut entries = Vec::new();
+        for (field_id, value) in stats[key].as_object().into_iter().flatten() {
+            entries.push((field_id.parse::<i32>()?, value.clone()));
+        }
+        entries.sort_by_key(|(field_id, _)| *field_id);
+        Ok(entries)
+    };
+    let counts = |key: &str| -> Result<Vec<(i32, i64)>, Box<dyn Error>> {
+        Ok(field_ids(key)?
+            .into_iter()
+            .map(|(field_id, value)| (field_id, value.as_i64().unwrap_or_default()))
+            .collect())
+    };
+    let bounds = |key: &str| -> Result<Vec<(i32, Vec<u8>)>, Box<dyn Error>> {
+        field_ids(key)?
+            .into_iter()
+            .map(
+                |(field_id, value)| -> Result<(i32, Vec<u8>), Box<dyn Error>> {
+                    Ok((field_id, hex_decode(value.as_str().unwrap_or_default())?))
+                },
+            )
+            .collect()
+    };
+    Ok(DataFile {
+        file_path: file_path.to_string(),
+        partition: partition_fields
+            .iter()
+            .map(|field| partition_values[&field.name].clone())
+            .collect(),
+        record_count: stats["recordCount"].as_i64().unwrap_or_default(),
+        file_size,
+        value_counts: counts("valueCounts")?,
+        null_value_counts: counts("nullValueCounts")?,
+        lower_bounds: bounds("lowerBounds")?,
+        upper_bounds: bounds("upperBounds")?,
+    })
+}
+
+impl CachedTable {
+    async fn open(path: &str, options: &str) -> Result<CachedTable, Box<dyn Error>> {
+        let mut table = CachedTable {
+            options: options.to_string(),
+            store: object_store(path, options)?,
+            version: 0,
+            metadata: Value::Null,
+            manifests: Vec::new(),
+            manifest_entries: HashMap::new(),
+        };
+        table.update().await?;
+        Ok(table)
+    }
+
+    // Catches up with commits of other backends since
+    async fn update(&mut self) -> Result<(), Box<dyn Error>> {
+        let hint = read_file(&self.store, VERSION_HINT).await?;
+        let version: i64 = std::str::from_utf8(&hint)?.trim().parse()?;
+        if version == self.version {
+            return Ok(());
+        }
+        let metadata_path = format!("metadata/v{}.metadata.json", version);
+        self.metadata = serde_json::from_slice(&read_file(&self.store, &metadata_path).await?)?;
+        self.version = version;
+        self.manifests = match self.current_snapshot() {
+            Some(snapshot) => {
+                let location = self.location();
+                let manifest_list = snapshot["manifest-list"].as_str().unwrap_or_default();
+                let data = read_file(&self.store, relative_path(&location, manifest_list)?).await?;
+                avro::read_file(&data, read_manifest_file)?
+            }
+            None => Vec::new(),
+        };
+        Ok(())
+    }
+
+    fn location(&self) -> String {
+        self.metadata["location"]
+            .as_str()
+            .unwrap_or_default()
+            .to_string()
+    }
+
+    fn current_snapshot(&self) -> Option<&Value> {
+        let snapshot_id = self.metadata["current-snapshot-id"].as_i64()?;
+        self.metadata["snapshots"]
+            .as_array()?
+            .iter()
+            .find(|snapshot| snapshot["snapshot-id"].as_i64() == Some(snapshot_id))
+    }
+
+    // Reads the manifests of the current snapshot that aren't cached yet
+    async fn load_manifest_entries(
+        &mut self,
+        partition_fields: &[PartitionField],
+    ) -> Result<(), Box<dyn Error>> {
+        let location = self.location();
+        for manifest in &self.manifests {
+            if self.manifest_entries.contains_key(&manifest.path) {
+                continue;
+            }
+            let data = read_file(&self.store, relative_path(&location, &manifest.path)?).await?;
+            let entries = avro::read_file(&data, |reader| {
+                read_manifest_entry(reader, partition_fields)
+            })?;
+            self.manifest_entries.insert(manifest.path.clone(), entries);
+        }
+        let paths: HashSet<&String> = self
+            .manifests
+            .iter()
+            .map(|manifest| &manifest.path)
+            .collect();
+        self.manifest_entries.retain(|path, _| paths.contains(path));
+        Ok(())
+    }
+
+    async fn write_manifest(
+        &mut self,
+        entries: Vec<ManifestEntry>,
+        snapshot_id: i64,
+        sequence_number: i64,
+        partition_fields: &[PartitionField],
+    ) -> Result<ManifestFile, Box<dyn Error>> {
+        let records = entries
+            .iter()
+            .map(|entry| write_manifest_entry(entry, partition_fields))
+            .collect::<Result<Vec<Vec<u8>>, Box<dyn Error>>>()?;
+        let metadata = [
+            ("schema", self.metadata["schemas"][0].to_string()),
+            ("schema-id", "0".to_string()),
+            (
+                "partition-spec",
+                self.metadata["partition-specs"][0]["fields"].to_string(),
+            ),
+            ("partition-spec-id", "0".to_string()),
+            ("format-version", "2".to_string()),
+            ("content", "data".to_string()),
+        ];
+        let data = avro::write_file(
+            &manifest_entry_schema(partition_fields)?.to_string(),
+            &metadata,
+            &records,
+        )?;
+        let name = format!("metadata/{}-m0.avro", new_uuid()?);
+        let mut manifest = ManifestFile {
+            path: format!("{}/{}", self.location(), name),
+            length: data.len() as i64,
+            sequence_number,
+            min_sequence_number: sequence_number,
+            added_snapshot_id: snapshot_id,
+            added_files: 0,
+            existing_files: 0,
+            deleted_files: 0,
+            added_rows: 0,
+            existing_rows: 0,
+            deleted_rows: 0,
+        };
+        write_file(&self.store, &name, data).await?;
+        for entry in &entries {
+            let rows = entry.data_file.record_count;
+            match entry.status {
+                ADDED => {
+                    manifest.added_files += 1;
+                    manifest.added_rows += rows;
+                }
+                EXISTING => {
+                    manifest.existing_files += 1;
+                    manifest.existing_rows += rows;
+                }
+                _ => {
+                    manifest.deleted_files += 1;
+                    manifest.deleted_rows += rows;
+                }
+            }
+            if entry.status != DELETED {
+                manifest.min_sequence_number =
+                    manifest.min_sequence_number.min(entry.sequence_number);
+            }
+        }
+        self.manifest_entries.insert(manifest.path.clone(), entries);
+        Ok(manifest)
+    }
+}
+
+#[allow(non_snake_case)]
+pub fn IcebergCreateTable(
+    path: &CxxString,
+    options: &CxxString,
+    schema: &CxxString,
+    partition_spec: &CxxString,
+    log_retention_secs: i64,
+) -> Result<(), Box<dyn Error>> {
+    create_table(
+        path.to_str()?,
+        options.to_str()?,
+        schema.to_str()?,
+        partition_spec.to_str()?,
+        log_retention_secs,
+    )
+}
+
+#[allow(non_snake_case)]
+pub fn IcebergModifyFiles(
+    path: &CxxString,
+    options: &CxxString,
+    file_paths: &CxxVector<CxxString>,
+    file_sizes: &CxxVector<i64>,
+    is_add_files: &CxxVector<i8>,
+    partition_values: &CxxVector<CxxString>,
+    stats: &CxxVector<CxxString>,
+) -> Result<(), Box<dyn Error>> {
+    let actions = file_actions(
+        file_paths,
+        file_sizes,
+        is_add_files,
+        partition_values,
+        stats,
+    )?;
+    modify_files(path.to_str()?, options.to_str()?, actions)
+}
+
+fn create_table(
+    path: &str,
+    options: &str,
+    schema: &str,
+    partition_spec: &str,
+    log_retention_secs: i64,
+) -> Result<(), Box<dyn Error>> {
+    runtime()?.block_on(async {
+        let store = object_store(path, options)?;
+        if store.head(&Path::from(VERSION_HINT)).await.is_ok() {
+            return Err(format!("Iceberg table {} already exists", path).into());
+        }
+        let schema: Value = serde_json::from_str(schema)?;
+        let last_column_id = max_field_id(&schema);
+        let partition_fields: Value = serde_json::from_str(partition_spec)?;
+        let num_partition_fields = partition_fields.as_array().map_or(0, Vec::len) as i64;
+        let metadata = json!({
+            "format-version": 2,
+            "table-uuid": new_uuid()?,
+            "location": table_location(path),
+            "last-sequence-number": 0,
+            "last-updated-ms": now_ms(),
+            "last-column-id": last_column_id,
+            "current-schema-id": 0,
+            "schemas": [schema],
+            "default-spec-id": 0,
+            "partition-specs": [{"spec-id": 0, "fields": partition_fields}],
+            "last-partition-id": 999 + num_partition_fields,
+            "default-sort-order-id": 0,
+            "sort-orders": [{"order-id": 0, "fields": []}],
+            "properties": {
+                "created-by": "pg_mooncake_extension",
+                "write.format.default": "parquet",
+                "history.expire.max-snapshot-age-ms": (log_retention_secs * 1000).to_string(),
+                "write.metadata.delete-after-commit.enabled": "true",
+                "write.metadata.previous-versions-max": "100",
+            },
+            "current-snapshot-id": -1,
+            "refs": {},
+            "snapshots": [],
+            "snapshot-log": [],
+            "metadata-log": [],
+        });
+        write_file(
+            &store,
+            "metadata/v1.metadata.json",
+            serde_json::to_vec_pretty(&metadata)?,
+        )
+        .await?;
+        write_file(&store, VERSION_HINT, b"1".to_vec()).await?;
+        cached_tables().lock().unwrap().insert(
+            path.to_string(),
+            CachedTable {
+                options: options.to_string(),
+                store,
+                version: 1,
+                metadata,
+                manifests: Vec::new(),
+                manifest_entries: HashMap::new(),
+            },
+        );
+        Ok(())
+    })
+}
+
+fn modify_files(
+    path: &str,
+    options: &str,
+    mut actions: Vec<FileAction>,
+) -> Result<(), Box<dyn Error>> {
+    runtime()?.block_on(async {
+        // Held across the commit, as for Delta tables
+        let mut tables = cached_tables().lock().unwrap();
+        let key = path.to_string();
+        let cached = match tables.remove(&key) {
+            Some(cached) if cached.options == options => Some(cached),
+            _ => None,
+        };
+        let mut table = match cached {
+            Some(mut cached) => {
+                cached.update().await?;
+                cached
+            }
+            None => CachedTable::open(path, options).await?,
+        };
+        let partition_fields = partition_fields(&table.metadata)?;
+        table.load_manifest_entries(&partition_fields).await?;
+
+        let mut live_files = HashMap::new();
+        for manifest in &table.manifests {
+            for entry in &table.manifest_entries[&manifest.path] {
+                if entry.status != DELETED {
+                    live_files.insert(
+                        entry.data_file.file_path.clone(),
+                        entry.data_file.record_count,
+                    );
+                }
+            }
+        }
+        skip_applied_actions(&mut actions, |file_path| live_files.contains_key(file_path));
+        let mut added_files = Vec::new();
+        let mut removed_files = HashSet::new();
+        for action in actions {
+            if action.is_add {
+                added_files.push(parse_data_file(
+                    &action.path,
+                    action.size,
+                    &action.partition_values,
+                    &action.stats,
+                    &partition_fields,
+                )?);
+            } else {
+                removed_files.insert(action.path);
+            }
+        }
+        if added_files.is_empty() && removed_files.is_empty() {
+            tables.insert(key, table);
+            return Ok(());
+        }
+
+        let snapshot_id = i64::from_le_bytes(avro::random_bytes()?[..8].try_into()?) & i64::MAX;
+        let sequence_number = table.metadata["last-sequence-number"].as_i64().unwrap_or(0) + 1;
+        let num_added_files = added_files.len();
+        let added_records: i64 = added_files
+            .iter()
+            .map(|data_file| data_file.record_count)
+            .sum();
+        let deleted_records: i64 = removed_files
+            .iter()
+            .map(|file_path| live_files[file_path])
+            .sum();
+        let total_records = live_files.values().sum::<i64>() + added_records - deleted_records;
+        let total_files = live_files.len() + num_added_files - removed_files.len();
+        let mut new_entries: Vec<ManifestEntry> = added_files
+            .into_iter()
+            .map(|data_file| ManifestEntry {
+                status: ADDED,
+                snapshot_id,
+                sequence_number,
+                file_sequence_number: sequence_number,
+                data_file,
+            })
+            .collect();
+        // Manifests without removed files are reused as they are. Others are rewritten with the
+        // removed files marked deleted, and deletes of earlier snapshots dropped.
+        let merge = table.manifests.len() >= MAX_MANIFESTS;
+        let mut manifests = Vec::new();
+        for manifest in table.manifests.clone() {
+            let entries = &table.manifest_entries[&manifest.path];
+            let live_entries: Vec<&ManifestEntry> = entries
+                .iter()
+                .filter(|entry| entry.status != DELETED)
+                .collect();
+            let has_removed_files = live_entries
+                .iter()
+                .any(|entry| removed_files.contains(&entry.data_file.file_path));
+            let is_small = merge && live_entries.len() < MIN_MANIFEST_ENTRIES;
+            if live_entries.is_empty() {
+                continue;
+            }
+            if !has_removed_files && !is_small {
+                manifests.push(manifest);
+                continue;
+            }
+            let rewritten_entries: Vec<ManifestEntry> = live_entries
+                .into_iter()
+                .map(|entry| {
+                    let mut entry = entry.clone();
+                    if removed_files.contains(&entry.data_file.file_path) {
+                        entry.status = DELETED;
+                        entry.snapshot_id = snapshot_id;
+                    } else {
+                        entry.status = EXISTING;
+                    }
+                    entry
+                })
+                .collect();
+            if is_small {
+                new_entries.extend(rewritten_entries);
+            } else {
+                manifests.push(
+                    table
+                        .write_manifest(
+                            rewritten_entries,
+                            snapshot_id,
+                            sequence_number,
+                            &partition_fields,
+                        )
+                        .await?,
+                );
+            }
+        }
+        if !new_entries.is_empty() {
+            let manifest = table
+                .write_manifest(new_entries, snapshot_id, sequence_number, &partition_fields)
+                .await?;
+            manifests.insert(0, manifest);
+        }
+
+        let location = table.location();
+        let parent_snapshot_id = table
+            .current_snapshot()
+            .map(|snapshot| snapshot["snapshot-id"].clone());
+        let manifest_list = format!("metadata/snap-{}-1-{}.avro", snapshot_id, new_uuid()?);
+        let list_metadata = [
+            ("snapshot-id", snapshot_id.to_string()),
+            (
+                "parent-snapshot-id",
+                parent_snapshot_id
+                    .clone()
+                    .map_or("null".to_string(), |id| id.to_string()),
+            ),
+            ("sequence-number", sequence_number.to_string()),
+            ("format-version", "2".to_string()),
+        ];
+        let records: Vec<Vec<u8>> = manifests.iter().map(write_manifest_file).collect();
+        let data = avro::write_file(
+            &manifest_file_schema().to_string(),
+            &list_metadata,
+            &records,
+        )?;
+        write_file(&table.store, &manifest_list, data).await?;
+
+        let now = now_ms();
+        let operation = if removed_files.is_empty() {
+            "append"
+        } else if num_added_files == 0 {
+            "delete"
+        } else {
+            "overwrite"
+        };
+        let mut snapshot = json!({
+            "snapshot-id": snapshot_id,
+            "sequence-number": sequence_number,
+            "timestamp-ms": now,
+            "manifest-list": format!("{}/{}", location, manifest_list),
+            "summary": {
+                "operation": operation,
+                "added-data-files": num_added_files.to_string(),
+                "deleted-data-files": removed_files.len().to_string(),
+                "added-records": added_records.to_string(),
+                "deleted-records": deleted_records.to_string(),
+                "total-data-files": total_files.to_string(),
+                "total-records": total_records.to_string(),
+            },
+            "schema-id": 0,
+        });
+        if let Some(parent_snapshot_id) = parent_snapshot_id {
+            snapshot["parent-snapshot-id"] = parent_snapshot_id;
+        }
+
+        // Snapshots past the retention expire, and metadata files beyond the last 100 are removed
+        let mut metadata = table.metadata.clone();
+        let max_snapshot_age =
+            property(&metadata, "history.expire.max-snapshot-age-ms").unwrap_or(i64::MAX);
+        let max_previous_versions =
+            property(&metadata, "write.metadata.previous-versions-max").unwrap_or(100);
+        let mut snapshots = metadata["snapshots"]
+            .as_array()
+            .cloned()
+            .unwrap_or_default();
+        snapshots.retain(|snapshot| {
+            snapshot["timestamp-ms"].as_i64().unwrap_or_default()
+                >= now.saturating_sub(max_snapshot_age)
+        });
+        snapshots.push(snapshot);
+        let snapshot_ids: HashSet<i64> = snapshots
+            .iter()
+            .filter_map(|snapshot| snapshot["snapshot-id"].as_i64())
+            .collect();
+        let mut snapshot_log = metadata["snapshot-log"]
+            .as_array()
+            .cloned()
+            .unwrap_or_default();
+        snapshot_log.push(json!({"timestamp-ms": now, "snapshot-id": snapshot_id}));
+        snapshot_log.retain(|entry| {
+            entry["snapshot-id"]
+                .as_i64()
+                .map_or(false, |id| snapshot_ids.contains(&id))
+        });
+        let mut metadata_log = metadata["metadata-log"]
+            .as_array()
+            .cloned()
+            .unwrap_or_default();
+        metadata_log.push(json!({
+            "timestamp-ms": metadata["last-updated-ms"].clone(),
+            "metadata-file": format!("{}/metadata/v{}.metadata.json", location, table.version),
+        }));
+        let num_expired = metadata_log
+            .len()
+            .saturating_sub(max_previous_versions as usize);
+        let expired_metadata: Vec<Value> = metadata_log.drain(..num_expired).collect();
+        metadata["snapshots"] = json!(snapshots);
+        metadata["snapshot-log"] = json!(snapshot_log);
+        metadata["metadata-log"] = json!(metadata_log);
+        metadata["current-snapshot-id"] = json!(snapshot_id);
+        metadata["refs"] = json!({"main": {"snapshot-id": snapshot_id, "type": "branch"}});
+        metadata["last-sequence-number"] = json!(sequence_number);
+        metadata["last-updated-ms"] = json!(now);
+
+        // A commit lands once the version hint points at it, flushes of a table are serialized by
+        // the columnstore
+        let version = table.version + 1;
+        let metadata_path = format!("metadata/v{}.metadata.json", version);
+        write_file(
+            &table.store,
+            &metadata_path,
+            serde_json::to_vec_pretty(&metadata)?,
+        )
+        .await?;
+        write_file(&table.store, VERSION_HINT, version.to_string().into_bytes()).await?;
+        for entry in expired_metadata {
+            if let Some(path) = entry["metadata-file"].as_str() {
+                if let Ok(path) = relative_path(&location, path) {
+                    let _ = table.store.delete(&Path::from(path)).await;
+                }
+            }
+        }
+        table.version = version;
+        table.metadata = metadata;
+        table.manifests = manifests;
+        tables.insert(key, table);
+        Ok(())
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use ::iceberg::io::FileIO;
+    use ::iceberg::table::StaticTable;
+    use ::iceberg::TableIdent;
+    use futures::TryStreamExt;
+
+    fn action(path: &str, file_name: &str, is_add: bool) -> FileAction {
+        FileAction {
+            path: format!("{}{}", path, file_name),
+            size: 100,
+            is_add,
+            partition_values: json!({"b": "x"}).to_string(),
+            stats: json!({
+                "recordCount": 1,
+                "valueCounts": {"1": 1, "2": 1},
+                "nullValueCounts": {"1": 0, "2": 0},
+                "lowerBounds": {"1": "0100000000000000"},
+                "upperBounds": {"1": "0100000000000000"},
+            })
+            .to_string(),
+        }
+    }
+
+    // Tables are read back with iceberg-rust, which decodes the manifests with apache-avro
+    #[test]
+    fn read_back_with_iceberg_rust() -> Result<(), Box<dyn Error>> {
+        let dir = std::env::temp_dir().join(format!("mooncake-iceberg-{}", new_uuid()?));
+        std::fs::create_dir_all(&dir)?;
+        let path = format!("{}/", dir.to_str().ok_or("invalid temporary directory")?);
+        let schema = json!({"type": "struct", "schema-id": 0, "fields": [
+            {"id": 1, "name": "a", "required": false, "type": "long"},
+            {"id": 2, "name": "b", "required": false, "type": "string"},
+            {"id": 3, "name": "c", "required": false, "type": {
+                "type": "list", "element-id": 4, "element": "int", "element-required": false,
+            }},
+        ]});
+        let partition_spec = json!([
+            {"source-id": 2, "field-id": 1000, "name": "b", "transform": "identity"},
+        ]);
+        create_table(
+            &path,
+            "{}",
+            &schema.to_string(),
+            &partition_spec.to_string(),
+            3600,
+        )?;
+        modify_files(
+            &path,
+            "{}",
+            vec![
+                action(&path, "1.parquet", true),
+                action(&path, "2.parquet", true),
+            ],
+        )?;
+        // A retried batch: 2.parquet is already added
+        modify_files(
+            &path,
+            "{}",
+            vec![
+                action(&path, "2.parquet", true),
+                action(&path, "1.parquet", false),
+                action(&path, "3.parquet", true),
+            ],
+        )?;
+
+        let metadata_file = format!("{}metadata/v3.metadata.json", path);
+        let (last_column_id, file_paths) = runtime()?.block_on(async {
+            let file_io = FileIO::from_path(&metadata_file)?.build()?;
+            let table_ident = TableIdent::from_strs(["mooncake", "t"])?;
+            let table = StaticTable::from_metadata_file(&metadata_file, table_ident, file_io)
+                .await?
+                .into_table();
+            let tasks: Vec<_> = table
+                .scan()
+                .build()?
+                .plan_files()
+                .await?
+                .try_collect()
+                .await?;
+            let file_paths: HashSet<String> =
+                tasks.into_iter().map(|task| task.data_file_path).collect();
+            Ok::<_, ::iceberg::Error>((table.metadata().last_column_id(), file_paths))
+        })?;
+        std::fs::remove_dir_all(&dir)?;
+        assert_eq!(last_column_id, 4);
+        assert_eq!(
+            file_paths,
+            HashSet::from([format!("{}2.parquet", path), format!("{}3.parquet", path)])
+        );
+        Ok(())
+    }
+}
@@ -2,10 +2,16 @@ use cxx::{CxxString, CxxVector};
 use deltalake::aws::register_handlers;
 use deltalake::kernel::{Action, Add, ArrayType, DataType, PrimitiveType, Remove, StructField};
 use deltalake::operations::create::CreateBuilder;
-use deltalake::operations::transaction::CommitBuilder;
+use deltalake::operations::transaction::{CommitBuilder, CommitProperties};
 use deltalake::protocol::{DeltaOperation, SaveMode};
-use deltalake::{open_table_with_storage_options, TableProperty};
-use std::collections::HashMap;
+use deltalake::{open_table_with_storage_options, DeltaTable, TableProperty};
+use std::collections::{HashMap, HashSet};
+use std::sync::{Mutex, OnceLock};
+use tokio::runtime::Runtime;
+
+mod avro;
+mod iceberg;
+use iceberg::{IcebergCreateTable, IcebergModifyFiles};
 
 #[cxx::bridge]
 mod ffi {
@@ -18,6 +24,9 @@ mod ffi {
             options: &CxxString,
             column_names: &CxxVector<CxxString>,
             column_types: &CxxVector<CxxString>,
+            partition_columns: &CxxVector<CxxString>,
+            checkpoint_interval: i32,
+            log_retention_secs: i64,
         ) -> Result<()>;
 
         fn DeltaModifyFiles(
@@ -26,10 +35,117 @@ mod ffi {
             file_paths: &CxxVector<CxxString>,
             file_sizes: &CxxVector<i64>,
             is_add_files: &CxxVector<i8>,
+            partition_values: &CxxVector<CxxString>,
+            stats: &CxxVector<CxxString>,
+        ) -> Result<()>;
+
+        fn IcebergCreateTable(
+            path: &CxxString,
+            options: &CxxString,
+            schema: &CxxString,
+            partition_spec: &CxxString,
+            log_retention_secs: i64,
+        ) -> Result<()>;
+
+        fn IcebergModifyFiles(
+            path: &CxxString,
+            options: &CxxString,
+            file_paths: &CxxVector<CxxString>,
+            file_sizes: &CxxVector<i64>,
+            is_add_files: &CxxVector<i8>,
+            partition_values: &CxxVector<CxxString>,
+            stats: &CxxVector<CxxString>,
         ) -> Result<()>;
     }
 }
 
+// Created on first use, so that each backend gets its own after fork
+fn runtime() -> Result<&'static Runtime, Box<dyn std::error::Error>> {
+    static RUNTIME: OnceLock<Runtime> = OnceLock::new();
+    if let Some(runtime) = RUNTIME.get() {
+        return Ok(runtime);
+    }
+    let runtime = tokio::runtime::Builder::new_multi_thread()
+        .enable_all()
+        .build()?;
+    Ok(RUNTIME.get_or_init(|| runtime))
+}
+
+struct CachedTable {
+    options: String,
+    table: DeltaTable,
+}
+
+// Opened tables by path. Commits bring a cached table up to date by reading only the log
+// entries added since, instead of replaying the whole log.
+fn cached_tables() -> &'static Mutex<HashMap<String, CachedTable>> {
+    static TABLES: OnceLock<Mutex<HashMap<String, CachedTable>>> = OnceLock::new();
+    TABLES.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+fn parse_storage_options(
+    options: &str,
+) -> Result<HashMap<String, String>, Box<dyn std::error::Error>> {
+    let mut storage_options: HashMap<String, String> =
+        serde_json::from_str(options).expect("invalid options");
+    // Write directly to S3 without locking is safe since Mooncake is the only writer
+    storage_options.insert("AWS_S3_ALLOW_UNSAFE_RENAME".to_string(), "true".to_string());
+    Ok(storage_options)
+}
+
+// A data file added to or removed from a lake table, with the partition values and stats of the
+// files it adds as JSON
+struct FileAction {
+    path: String,
+    size: i64,
+    is_add: bool,
+    partition_values: String,
+    stats: String,
+}
+
+fn file_actions(
+    file_paths: &CxxVector<CxxString>,
+    file_sizes: &CxxVector<i64>,
+    is_add_files: &CxxVector<i8>,
+    partition_values: &CxxVector<CxxString>,
+    stats: &CxxVector<CxxString>,
+) -> Result<Vec<FileAction>, Box<dyn std::error::Error>> {
+    let mut actions = Vec::new();
+    for ((((file_path, file_size), is_add), partition_value), file_stats) in file_paths
+        .iter()
+        .zip(file_sizes.iter())
+        .zip(is_add_files.iter())
+        .zip(partition_values.iter())
+        .zip(stats.iter())
+    {
+        actions.push(FileAction {
+            path: file_path.to_str()?.to_string(),
+            size: *file_size,
+            is_add: *is_add == 1,
+            partition_values: partition_value.to_str()?.to_string(),
+            stats: file_stats.to_str()?.to_string(),
+        });
+    }
+    Ok(actions)
+}
+
+// Actions may be retried after a crash, those the table already has are skipped. A file the batch
+// also removes isn't added, its removal applies if an earlier flush added it.
+fn skip_applied_actions(actions: &mut Vec<FileAction>, has_file: impl Fn(&str) -> bool) {
+    let removed_files: HashSet<String> = actions
+        .iter()
+        .filter(|action| !action.is_add)
+        .map(|action| action.path.clone())
+        .collect();
+    actions.retain(|action| {
+        if action.is_add {
+            !has_file(&action.path) && !removed_files.contains(&action.path)
+        } else {
+            has_file(&action.path)
+        }
+    });
+}
+
 #[allow(non_snake_case)]
 pub fn DeltaInit() {
     // Register S3 handlers
@@ -43,27 +159,48 @@ pub fn DeltaCreateTable(
     options: &CxxString,
     column_names: &CxxVector<CxxString>,
     column_types: &CxxVector<CxxString>,
+    partition_columns: &CxxVector<CxxString>,
+    checkpoint_interval: i32,
+    log_retention_secs: i64,
 ) -> Result<(), Box<dyn std::error::Error>> {
-    let runtime = tokio::runtime::Runtime::new()?;
-    runtime.block_on(async {
-        let mut storage_options: HashMap<String, String> =
-            serde_json::from_str(options.to_str()?).expect("invalid options");
-        // Write directly to S3 without locking is safe since Mooncake is the only writer
-        storage_options.insert("AWS_S3_ALLOW_UNSAFE_RENAME".to_string(), "true".to_string());
+    runtime()?.block_on(async {
+        let storage_options = parse_storage_options(options.to_str()?)?;
         let metadata = vec![(
             "creator".to_string(),
             serde_json::json!("pg_mooncake_extension"),
         )];
-        let _table = CreateBuilder::new()
+        let table = CreateBuilder::new()
             .with_location(path.to_str()?)
             .with_storage_options(storage_options)
             .with_table_name(table_name.to_str()?)
             .with_configuration_property(TableProperty::MinReaderVersion, Some("3"))
             .with_configuration_property(TableProperty::MinWriterVersion, Some("7"))
+            .with_configuration_property(
+                TableProperty::CheckpointInterval,
+                Some(checkpoint_interval.to_string()),
+            )
+            .with_configuration_property(
+                TableProperty::LogRetentionDuration,
+                Some(format!("interval {} seconds", log_retention_secs)),
+            )
+            .with_configuration_property(TableProperty::EnableExpiredLogCleanup, Some("true"))
             .with_columns(map_postgres_columns(column_names, column_types))
+            .with_partition_columns(
+                partition_columns
+                    .iter()
+                    .map(|column| column.to_string())
+                    .collect::<Vec<String>>(),
+            )
             .with_metadata(metadata)
             .with_save_mode(SaveMode::ErrorIfExists)
             .await?;
+        cached_tables().lock().unwrap().insert(
+            path.to_string(),
+            CachedTable {
+                options: options.to_string(),
+                table,
+            },
+        );
         Ok(())
     })
 }
@@ -75,48 +212,90 @@ pub fn DeltaModifyFiles(
     file_paths: &CxxVector<CxxString>,
     file_sizes: &CxxVector<i64>,
     is_add_files: &CxxVector<i8>,
+    partition_values: &CxxVector<CxxString>,
+    stats: &CxxVector<CxxString>,
 ) -> Result<(), Box<dyn std::error::Error>> {
-    let runtime: tokio::runtime::Runtime = tokio::runtime::Runtime::new()?;
-    runtime.block_on(async {
-        let mut actions = Vec::new();
-        for ((file_path, file_size), is_add) in file_paths
-            .iter()
-            .zip(file_sizes.iter())
-            .zip(is_add_files.iter())
-        {
-            if *is_add == 1 {
-                let add = Add {
-                    path: file_path.to_string(),
-                    size: *file_size,
-                    data_change: true,
-                    ..Default::default()
-                };
-                actions.push(Action::Add(add));
-            } else {
-                let rm = Remove {
-                    path: file_path.to_string(),
-                    data_change: true,
-                    ..Default::default()
-                };
-                actions.push(Action::Remove(rm));
+    runtime()?.block_on(async {
+        let mut actions = file_actions(
+            file_paths,
+            file_sizes,
+            is_add_files,
+            partition_values,
+            stats,
+        )?;
+        // Held across the commit, a backend commits one transaction at a time anyway
+        let mut tables = cached_tables().lock().unwrap();
+        let key = path.to_string();
+        let cached = match tables.remove(&key) {
+            Some(cached) if cached.options == options.to_string() => Some(cached),
+            _ => None,
+        };
+        let mut cached = match cached {
+            Some(mut cached) => {
+                // Other backends may have committed since
+                cached.table.update().await?;
+                cached
+            }
+            None => {
+                let storage_options = parse_storage_options(options.to_str()?)?;
+                CachedTable {
+                    options: options.to_string(),
+                    table: open_table_with_storage_options(key.clone(), storage_options).await?,
+                }
             }
+        };
+        let files: HashSet<String> = cached
+            .table
+            .snapshot()?
+            .file_actions()?
+            .into_iter()
+            .map(|add| add.path)
+            .collect();
+        skip_applied_actions(&mut actions, |file_path| files.contains(file_path));
+        if actions.is_empty() {
+            tables.insert(key, cached);
+            return Ok(());
         }
-        let mut storage_options: HashMap<String, String> =
-            serde_json::from_str(options.to_str()?).expect("invalid options");
-        // Write directly to S3 without locking is safe since Mooncake is the only writer
-        storage_options.insert("AWS_S3_ALLOW_UNSAFE_RENAME".to_string(), "true".to_string());
-        let mut table: deltalake::DeltaTable =
-            open_table_with_storage_options(path.to_string(), storage_options).await?;
+        let actions = actions
+            .into_iter()
+            .map(|action| -> Result<Action, Box<dyn std::error::Error>> {
+                Ok(if action.is_add {
+                    Action::Add(Add {
+                        path: action.path,
+                        size: action.size,
+                        partition_values: serde_json::from_str(&action.partition_values)?,
+                        stats: Some(action.stats),
+                        data_change: true,
+                        ..Default::default()
+                    })
+                } else {
+                    Action::Remove(Remove {
+                        path: action.path,
+                        data_change: true,
+                        ..Default::default()
+                    })
+                })
+            })
+            .collect::<Result<Vec<Action>, _>>()?;
+        let partition_columns = cached.table.metadata()?.partition_columns.clone();
         let op = DeltaOperation::Write {
             mode: SaveMode::Append,
-            partition_by: None,
+            partition_by: if partition_columns.is_empty() {
+                None
+            } else {
+                Some(partition_columns)
+            },
             predicate: None,
         };
-        CommitBuilder::default()
+        // A failed commit leaves the table out of the cache, the next one reopens it. Once
+        // committed, a checkpoint is written every delta.checkpointInterval versions, and log
+        // entries past delta.logRetentionDuration are cleaned up.
+        let commit = CommitBuilder::from(CommitProperties::default())
             .with_actions(actions)
-            .build(Some(table.snapshot()?), table.log_store().clone(), op)
+            .build(Some(cached.table.snapshot()?), cached.table.log_store().clone(), op)
             .await?;
-        table.update().await?;
+        cached.table.state = Some(commit.snapshot());
+        tables.insert(key, cached);
         Ok(())
     })
 }
@@ -13,11 +13,98 @@ CREATE UNIQUE INDEX tables_oid ON mooncake.tables (oid);
 
 CREATE TABLE mooncake.data_files (
     oid OID NOT NULL,
-    file_name TEXT NOT NULL
+    file_name TEXT NOT NULL,
+    file_size BIGINT NOT NULL,
+    row_count BIGINT NOT NULL,
+    column_names TEXT[] NOT NULL,
+    null_counts BIGINT[] NOT NULL,
+    min_values TEXT[] NOT NULL,
+    max_values TEXT[] NOT NULL
 );
 CREATE INDEX data_files_oid ON mooncake.data_files (oid);
 CREATE UNIQUE INDEX data_files_file_name ON mooncake.data_files (file_name);
 
+CREATE TABLE mooncake.deletion_vectors (
+    oid OID NOT NULL,
+    file_name TEXT NOT NULL,
+    deleted_count BIGINT NOT NULL,
+    content BYTEA NOT NULL
+);
+CREATE INDEX deletion_vectors_oid ON mooncake.deletion_vectors (oid);
+CREATE UNIQUE INDEX deletion_vectors_file_name ON mooncake.deletion_vectors (file_name);
+
+CREATE TABLE mooncake.buffered_files (
+    oid OID NOT NULL,
+    file_name TEXT NOT NULL,
+    row_count BIGINT NOT NULL,
+    file_size BIGINT NOT NULL,
+    created_at TIMESTAMPTZ NOT NULL,
+    content BYTEA NOT NULL
+);
+CREATE INDEX buffered_files_oid ON mooncake.buffered_files (oid);
+CREATE UNIQUE INDEX buffered_files_file_name ON mooncake.buffered_files (file_name);
+
+CREATE TABLE mooncake.compaction_policies (
+    oid OID NOT NULL,
+    target_file_size BIGINT,
+    min_file_count INT
+);
+CREATE UNIQUE INDEX compaction_policies_oid ON mooncake.compaction_policies (oid);
+
+CREATE TABLE mooncake.storage_options (
+    oid OID NOT NULL,
+    compression TEXT NOT NULL,
+    compression_level INT,
+    dictionary_compression_ratio_threshold DOUBLE PRECISION NOT NULL,
+    row_group_size BIGINT NOT NULL,
+    row_group_size_bytes BIGINT NOT NULL,
+    file_size_bytes BIGINT NOT NULL,
+    sort_by TEXT[] NOT NULL,
+    zorder BOOLEAN NOT NULL,
+    partition_by TEXT[] NOT NULL,
+    checkpoint_interval INT NOT NULL,
+    log_retention_secs BIGINT NOT NULL,
+    lake_format TEXT NOT NULL
+);
+CREATE UNIQUE INDEX storage_options_oid ON mooncake.storage_options (oid);
+
+CREATE TABLE mooncake.lake_outbox (
+    oid OID NOT NULL,
+    file_name TEXT NOT NULL,
+    is_add_file BOOLEAN NOT NULL,
+    file_size BIGINT NOT NULL,
+    partition_values TEXT NOT NULL,
+    stats TEXT NOT NULL
+);
+CREATE INDEX lake_outbox_oid ON mooncake.lake_outbox (oid);
+
+CREATE FUNCTION mooncake.compact(table_name REGCLASS) RETURNS VOID
+    AS 'MODULE_PATHNAME', 'mooncake_compact' LANGUAGE C STRICT;
+
+CREATE FUNCTION mooncake.flush_lake(table_name REGCLASS) RETURNS VOID
+    AS 'MODULE_PATHNAME', 'mooncake_flush_lake' LANGUAGE C STRICT;
+
+CREATE OR REPLACE FUNCTION mooncake.set_compaction_policy(
+    table_name REGCLASS,
+    target_file_size BIGINT DEFAULT NULL,
+    min_file_count INT DEFAULT NULL
+)
+RETURNS VOID
+LANGUAGE plpgsql
+AS $set_compaction_policy$
+BEGIN
+    IF NOT EXISTS (SELECT 1 FROM mooncake.tables WHERE oid = table_name) THEN
+        RAISE EXCEPTION '% is not a columnstore table', table_name;
+    END IF;
+    IF NOT pg_catalog.pg_has_role((SELECT relowner FROM pg_catalog.pg_class WHERE oid = table_name), 'USAGE') THEN
+        RAISE EXCEPTION 'must be owner of table %', table_name;
+    END IF;
+    INSERT INTO mooncake.compaction_policies VALUES (table_name, target_file_size, min_file_count)
+        ON CONFLICT (oid) DO UPDATE SET target_file_size = EXCLUDED.target_file_size,
+                                        min_file_count = EXCLUDED.min_file_count;
+END;
+$set_compaction_policy$ SECURITY DEFINER SET search_path = pg_catalog, pg_temp;
+
 CREATE TABLE mooncake.secrets (
     name TEXT NOT NULL,
     type TEXT NOT NULL,
@@ -1,12 +1,28 @@
 #include "columnstore/columnstore.hpp"
+#include "columnstore/columnstore_cache.hpp"
 #include "columnstore/columnstore_metadata.hpp"
+#include "columnstore/columnstore_reader.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "duckdb/main/connection.hpp"
 #include "duckdb/main/secret/secret_manager.hpp"
 #include "lake/lake.hpp"
+#include "pgduckdb/pgduckdb_duckdb.hpp"
 #include "pgduckdb/pgduckdb_utils.hpp"
 #include "pgduckdb/utility/cpp_wrapper.hpp"
 
 namespace duckdb {
 
+namespace {
+
+unique_ptr<ColumnstoreStorageOptions> create_table_options;
+
+} // namespace
+
+void Columnstore::SetCreateTableOptions(const ColumnstoreStorageOptions *options) {
+    create_table_options = options ? make_uniq<ColumnstoreStorageOptions>(*options) : nullptr;
+}
+
+// The lake table is partitioned as the storage options say, so they are stored before it is created
 void Columnstore::CreateTable(Oid oid) {
     ColumnstoreMetadata metadata(NULL /*snapshot*/);
     string path = metadata.GetTablePath(oid);
@@ -14,15 +30,114 @@ void Columnstore::CreateTable(Oid oid) {
         FileSystem::CreateLocal()->CreateDirectory(path);
     }
     metadata.TablesInsert(oid, path);
+    if (create_table_options) {
+        metadata.StorageOptionsInsert(oid, *create_table_options);
+        create_table_options.reset();
+    }
     InvokeCPPFunc(LakeCreateTable, oid, path);
 }
 
 void Columnstore::TruncateTable(Oid oid) {
     ColumnstoreMetadata metadata(NULL /*snapshot*/);
-    vector<string> file_names = metadata.DataFilesSearch(oid);
+    auto data_files = metadata.DataFilesSearch(oid);
+    auto buffered_files = metadata.BufferedFilesSearch(oid);
     metadata.DataFilesDelete(oid);
-    for (auto file_name : file_names) {
-        LakeDeleteFile(oid, file_name);
+    metadata.BufferedFilesDelete(oid);
+    for (auto &data_file : data_files) {
+        LakeDeleteFile(oid, data_file.file_name);
+    }
+    for (auto &buffered_file : buffered_files) {
+        ColumnstoreCache::Remove(buffered_file.file_name);
+        std::remove((x_mooncake_local_cache + buffered_file.file_name).c_str());
+    }
+}
+
+void Columnstore::GetTableSize(Oid oid, int64_t &file_size, int64_t &row_count) {
+    ColumnstoreMetadata metadata(NULL /*snapshot*/);
+    file_size = 0;
+    row_count = 0;
+    for (auto &data_file : metadata.DataFilesSearch(oid)) {
+        file_size += data_file.file_size;
+        row_count += data_file.row_count - NumericCast<int64_t>(data_file.deleted_rows.size());
+    }
+    for (auto &buffered_file : metadata.BufferedFilesSearch(oid)) {
+        file_size += buffered_file.file_size;
+        row_count += buffered_file.row_count;
+    }
+}
+
+void Columnstore::Compact(Oid oid, bool wait) {
+    ColumnstoreMetadata metadata(NULL /*snapshot*/);
+    if (!metadata.CompactionTryLock(oid, wait)) {
+        return;
+    }
+    int64_t target_file_size;
+    int64_t min_file_count;
+    metadata.CompactionPoliciesSearch(oid, target_file_size, min_file_count);
+
+    // Files past half the target are left alone, otherwise every pass would rewrite them to absorb a few small ones
+    vector<ColumnstoreDataFile> small_files;
+    for (auto &data_file : metadata.DataFilesSearch(oid)) {
+        if (data_file.file_size < target_file_size / 2) {
+            small_files.push_back(std::move(data_file));
+        }
+    }
+    if (small_files.empty() || NumericCast<int64_t>(small_files.size()) < min_file_count) {
+        return;
+    }
+    // Only files of the same partition are merged
+    std::sort(small_files.begin(), small_files.end(), [](const ColumnstoreDataFile &a, const ColumnstoreDataFile &b) {
+        auto a_partition = GetPartitionDirectory(a.file_name);
+        auto b_partition = GetPartitionDirectory(b.file_name);
+        return a_partition != b_partition ? a_partition < b_partition : a.file_size < b.file_size;
+    });
+    vector<vector<ColumnstoreDataFile>> groups;
+    int64_t group_size = 0;
+    for (auto &data_file : small_files) {
+        if (groups.empty() || group_size + data_file.file_size > target_file_size ||
+            GetPartitionDirectory(data_file.file_name) != GetPartitionDirectory(groups.back().back().file_name)) {
+            groups.emplace_back();
+            group_size = 0;
+        }
+        group_size += data_file.file_size;
+        groups.back().push_back(std::move(data_file));
+    }
+
+    string path = metadata.TablesSearch(oid);
+    string table_name;
+    vector<string> column_names;
+    vector<string> column_types;
+    metadata.GetTableMetadata(oid, table_name, column_names, column_types);
+    auto options = metadata.StorageOptionsSearch(oid);
+    auto &context = *pgduckdb::DuckDBManager::GetConnection(true /*force_transaction*/)->context;
+    for (auto &group : groups) {
+        if (group.size() < 2) {
+            continue;
+        }
+        vector<string> file_names;
+        for (auto &data_file : group) {
+            file_names.push_back(data_file.file_name);
+        }
+        auto file_paths = GetDataFilePaths(path, file_names);
+        unique_ptr<ColumnstoreWriter> writer;
+        for (idx_t i = 0; i < group.size(); i++) {
+            ScanDataFile(context, file_paths[i], group[i].deleted_rows, [&](DataChunk &chunk) {
+                if (!writer) {
+                    writer = make_uniq<ColumnstoreWriter>(path, chunk.GetTypes(), column_names, options);
+                }
+                writer->Write(context, chunk);
+            });
+        }
+        if (writer) {
+            for (auto &data_file : writer->Finalize()) {
+                metadata.DataFilesInsert(oid, data_file);
+                LakeAddFile(oid, data_file);
+            }
+        }
+        for (auto &file_name : file_names) {
+            metadata.DataFilesDelete(file_name);
+            LakeDeleteFile(oid, file_name);
+        }
     }
 }
 
@@ -30,8 +145,12 @@ void Columnstore::Abort() {
     LakeAbort();
 }
 
+void Columnstore::PreCommit() {
+    InvokeCPPFunc(LakePreCommit);
+}
+
 void Columnstore::Commit() {
-    InvokeCPPFunc(LakeCommit);
+    LakeCommit();
 }
 
 void Columnstore::LoadSecrets(ClientContext &context) {
@@ -8,21 +8,40 @@ namespace duckdb {
 class ClientContext;
 class LogicalDelete;
 class LogicalInsert;
+class LogicalOperator;
 class LogicalUpdate;
 class PhysicalOperator;
+struct ColumnstoreStorageOptions;
+struct OptimizerExtensionInput;
 
 class Columnstore {
 public:
+    // Storage options for the table the CREATE TABLE being run creates, taken from its WITH (...) by the utility hook.
+    // nullptr leaves it the defaults.
+    static void SetCreateTableOptions(const ColumnstoreStorageOptions *options);
+
     static void CreateTable(Oid oid);
 
     static void TruncateTable(Oid oid);
 
+    // Total size and live row count of the table's data and buffered files, from the catalog alone
+    static void GetTableSize(Oid oid, int64_t &file_size /*out*/, int64_t &row_count /*out*/);
+
+    // Merges small data files into files of about the target size of the table's compaction policy
+    static void Compact(Oid oid, bool wait);
+
     static void Abort();
 
+    // Flushes the lake outbox of the tables the transaction wrote, unless the lake worker does
+    static void PreCommit();
+
     static void Commit();
 
     static void LoadSecrets(ClientContext &context);
 
+    // Optimizer extension that answers count/min/max over columnstore tables from the catalog where possible
+    static void Optimize(OptimizerExtensionInput &input, unique_ptr<LogicalOperator> &plan);
+
     static unique_ptr<PhysicalOperator> PlanInsert(ClientContext &context, LogicalInsert &op,
                                                    unique_ptr<PhysicalOperator> plan);
 
@@ -0,0 +1,397 @@
+#include "columnstore/columnstore_cache.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/uuid.hpp"
+#include "pgmooncake_guc.hpp"
+
+extern "C" {
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+}
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+
+namespace duckdb {
+
+namespace {
+
+const char *x_read_through_prefix = "mooncake_cache://";
+
+// File names are UUIDs, see ColumnstoreWriter
+constexpr idx_t x_max_file_name = 64;
+// Open addressing with linear probing, kept at most half full
+constexpr uint32_t x_num_slots = 1 << 15;
+constexpr uint32_t x_max_entries = x_num_slots / 2;
+constexpr uint32_t x_no_entry = UINT32_MAX;
+
+// Entries stay at their index while tracked, so that the LRU list can link them while the hash table moves its slots
+struct CacheEntry {
+    char file_name[x_max_file_name];
+    int64_t file_size;
+    // Tells a file apart from a later admission of the same name, see ColumnstoreCache::Remove
+    uint64_t generation;
+    // Neighbours in the LRU list, next also links the free list
+    uint32_t prev;
+    uint32_t next;
+};
+
+// Entries only change under the mutex, and every operation takes O(1) work besides probing the hash table. It is a
+// process-shared pthread mutex rather than a spinlock or LWLock, as DuckDB threads take it and have no PGPROC.
+struct CacheState {
+    pthread_mutex_t mutex;
+    // Files cached before this time are left from before a restart, see LoadExistingFiles
+    time_t init_time;
+    bool loaded;
+    uint64_t next_generation;
+    int64_t total_size;
+    uint32_t num_entries;
+    // Most and least recently used entries
+    uint32_t head;
+    uint32_t tail;
+    uint32_t free_list;
+    // Index of the entry in each slot, x_no_entry for empty slots
+    uint32_t slots[x_num_slots];
+    CacheEntry entries[x_max_entries];
+};
+
+CacheState *cache_state = nullptr;
+
+class CacheLock {
+public:
+    CacheLock() {
+        pthread_mutex_lock(&cache_state->mutex);
+    }
+
+    ~CacheLock() {
+        pthread_mutex_unlock(&cache_state->mutex);
+    }
+};
+
+int64_t GetBudget() {
+    return int64_t(mooncake_local_cache_size) * 1024 * 1024;
+}
+
+uint32_t GetHomeSlot(const char *file_name) {
+    return hash_bytes(reinterpret_cast<const unsigned char *>(file_name), int(strlen(file_name))) & (x_num_slots - 1);
+}
+
+// Slot holding file_name, or the empty slot it would go to
+uint32_t FindSlot(const char *file_name) {
+    uint32_t slot = GetHomeSlot(file_name);
+    while (cache_state->slots[slot] != x_no_entry &&
+           strcmp(cache_state->entries[cache_state->slots[slot]].file_name, file_name) != 0) {
+        slot = (slot + 1) & (x_num_slots - 1);
+    }
+    return slot;
+}
+
+void Unlink(uint32_t index) {
+    auto &entry = cache_state->entries[index];
+    (entry.prev == x_no_entry ? cache_state->head : cache_state->entries[entry.prev].next) = entry.next;
+    (entry.next == x_no_entry ? cache_state->tail : cache_state->entries[entry.next].prev) = entry.prev;
+}
+
+void PushFront(uint32_t index) {
+    auto &entry = cache_state->entries[index];
+    entry.prev = x_no_entry;
+    entry.next = cache_state->head;
+    (cache_state->head == x_no_entry ? cache_state->tail : cache_state->entries[cache_state->head].prev) = index;
+    cache_state->head = index;
+}
+
+// Starts tracking a file in the empty slot FindSlot returned for it
+void InsertSlot(uint32_t slot, const char *file_name, int64_t file_size) {
+    uint32_t index = cache_state->free_list;
+    auto &entry = cache_state->entries[index];
+    cache_state->free_list = entry.next;
+    strcpy(entry.file_name, file_name);
+    entry.file_size = file_size;
+    entry.generation = cache_state->next_generation++;
+    PushFront(index);
+    cache_state->slots[slot] = index;
+    cache_state->total_size += file_size;
+    cache_state->num_entries++;
+}
+
+// Shifts later slots of the probe sequence back into the freed slot, so lookups need no tombstones
+void RemoveSlot(uint32_t slot) {
+    auto &slots = cache_state->slots;
+    uint32_t index = slots[slot];
+    auto &entry = cache_state->entries[index];
+    cache_state->total_size -= entry.file_size;
+    cache_state->num_entries--;
+    Unlink(index);
+    entry.next = cache_state->free_list;
+    cache_state->free_list = index;
+    uint32_t hole = slot;
+    for (uint32_t next = (slot + 1) & (x_num_slots - 1); slots[next] != x_no_entry;
+         next = (next + 1) & (x_num_slots - 1)) {
+        uint32_t home = GetHomeSlot(cache_state->entries[slots[next]].file_name);
+        if (((next - home) & (x_num_slots - 1)) >= ((next - hole) & (x_num_slots - 1))) {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+    }
+    slots[hole] = x_no_entry;
+}
+
+// Copies the least recently used file name into victim and stops tracking it
+void EvictLeastRecentlyUsed(char *victim) {
+    strcpy(victim, cache_state->entries[cache_state->tail].file_name);
+    RemoveSlot(FindSlot(victim));
+}
+
+// Files cached before a restart are kept, in no particular LRU order, and leftovers of interrupted downloads dropped.
+// Files since then are left alone: they are tracked already, or still being written by a backend that admits them once
+// done. Entries are named relative to the cache directory.
+void AdmitExistingFiles(const string &directory) {
+    try {
+        auto local_fs = FileSystem::CreateLocal();
+        vector<string> file_names;
+        local_fs->ListFiles(x_mooncake_local_cache + directory, [&](const string &file_name, bool is_directory) {
+            if (!is_directory) {
+                file_names.push_back(directory + file_name);
+            }
+        });
+        for (auto &file_name : file_names) {
+            string file_path = x_mooncake_local_cache + file_name;
+            struct stat st;
+            if (stat(file_path.c_str(), &st) != 0 || st.st_mtime >= cache_state->init_time) {
+                continue;
+            }
+            if (!StringUtil::EndsWith(file_name, ".parquet") || !ColumnstoreCache::Admit(file_name, st.st_size)) {
+                std::remove(file_path.c_str());
+            }
+        }
+    } catch (std::exception &ex) {
+        elog(WARNING, "could not load pg_mooncake local cache: %s", ex.what());
+    }
+}
+
+#if PG_VERSION_NUM >= 150000
+shmem_request_hook_type prev_shmem_request_hook = nullptr;
+
+void CacheShmemRequest() {
+    if (prev_shmem_request_hook) {
+        prev_shmem_request_hook();
+    }
+    RequestAddinShmemSpace(sizeof(CacheState));
+}
+#endif
+
+shmem_startup_hook_type prev_shmem_startup_hook = nullptr;
+
+void CacheShmemStartup() {
+    if (prev_shmem_startup_hook) {
+        prev_shmem_startup_hook();
+    }
+    bool found;
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+    cache_state = static_cast<CacheState *>(ShmemInitStruct("pg_mooncake local cache", sizeof(CacheState), &found));
+    if (!found) {
+        memset(cache_state, 0, sizeof(CacheState));
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&cache_state->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        cache_state->init_time = time(nullptr);
+        cache_state->head = x_no_entry;
+        cache_state->tail = x_no_entry;
+        for (uint32_t slot = 0; slot < x_num_slots; slot++) {
+            cache_state->slots[slot] = x_no_entry;
+        }
+        for (uint32_t index = 0; index < x_max_entries; index++) {
+            cache_state->entries[index].next = index + 1 < x_max_entries ? index + 1 : x_no_entry;
+        }
+    }
+    LWLockRelease(AddinShmemInitLock);
+}
+
+} // namespace
+
+bool ColumnstoreCache::IsShared() {
+    return cache_state != nullptr;
+}
+
+bool ColumnstoreCache::Fits(int64_t file_size) {
+    return cache_state && file_size <= GetBudget();
+}
+
+// The postmaster doesn't touch the cache directory, so the first backend to start DuckDB does
+void ColumnstoreCache::LoadExistingFiles() {
+    if (!cache_state) {
+        return;
+    }
+    {
+        CacheLock lock;
+        if (cache_state->loaded) {
+            return;
+        }
+        cache_state->loaded = true;
+    }
+    AdmitExistingFiles("");
+    AdmitExistingFiles("footers/");
+}
+
+bool ColumnstoreCache::Touch(const string &file_name, uint64_t *generation) {
+    if (!cache_state || file_name.size() >= x_max_file_name) {
+        return false;
+    }
+    CacheLock lock;
+    uint32_t index = cache_state->slots[FindSlot(file_name.c_str())];
+    if (index == x_no_entry) {
+        return false;
+    }
+    Unlink(index);
+    PushFront(index);
+    if (generation) {
+        *generation = cache_state->entries[index].generation;
+    }
+    return true;
+}
+
+bool ColumnstoreCache::Admit(const string &file_name, int64_t file_size) {
+    if (!cache_state) {
+        return true;
+    }
+    if (file_name.size() >= x_max_file_name || file_size > GetBudget()) {
+        return false;
+    }
+    // Evicts one file per round, so that no file is removed while holding the mutex
+    while (true) {
+        char victim[x_max_file_name];
+        {
+            CacheLock lock;
+            uint32_t slot = FindSlot(file_name.c_str());
+            uint32_t index = cache_state->slots[slot];
+            if (index != x_no_entry) {
+                Unlink(index);
+                PushFront(index);
+                return true;
+            }
+            if (cache_state->total_size + file_size <= GetBudget() && cache_state->num_entries < x_max_entries) {
+                InsertSlot(slot, file_name.c_str(), file_size);
+                return true;
+            }
+            EvictLeastRecentlyUsed(victim);
+        }
+        // Backends still reading the file keep their open handle
+        std::remove((x_mooncake_local_cache + string(victim)).c_str());
+    }
+}
+
+void ColumnstoreCache::Remove(const string &file_name) {
+    if (!cache_state || file_name.size() >= x_max_file_name) {
+        return;
+    }
+    CacheLock lock;
+    uint32_t slot = FindSlot(file_name.c_str());
+    if (cache_state->slots[slot] != x_no_entry) {
+        RemoveSlot(slot);
+    }
+}
+
+void ColumnstoreCache::Remove(const string &file_name, uint64_t generation) {
+    if (!cache_state || file_name.size() >= x_max_file_name) {
+        return;
+    }
+    CacheLock lock;
+    uint32_t slot = FindSlot(file_name.c_str());
+    uint32_t index = cache_state->slots[slot];
+    if (index != x_no_entry && cache_state->entries[index].generation == generation) {
+        RemoveSlot(slot);
+    }
+}
+
+ColumnstoreCacheFileSystem::ColumnstoreCacheFileSystem(FileSystem &fs) : fs(fs), local_fs(FileSystem::CreateLocal()) {}
+
+string ColumnstoreCacheFileSystem::GetReadThroughPath(const string &remote_path) {
+    return x_read_through_prefix + remote_path;
+}
+
+unique_ptr<FileHandle> ColumnstoreCacheFileSystem::OpenFile(const string &path, FileOpenFlags flags,
+                                                            optional_ptr<FileOpener> opener) {
+    if (flags.OpenForWriting()) {
+        throw NotImplementedException("%s is read-only", GetName());
+    }
+    string remote_path = path.substr(strlen(x_read_through_prefix));
+    string file_name = remote_path.substr(remote_path.rfind('/') + 1);
+    string cached_file_path = x_mooncake_local_cache + file_name;
+    uint64_t generation;
+    if (ColumnstoreCache::Touch(file_name, &generation)) {
+        // Another backend may have evicted the file in the meantime
+        auto handle = local_fs->OpenFile(cached_file_path, flags | FileFlags::FILE_FLAGS_NULL_IF_NOT_EXISTS, opener);
+        if (handle) {
+            return handle;
+        }
+        ColumnstoreCache::Remove(file_name, generation);
+    }
+
+    auto remote_handle = fs.OpenFile(remote_path, flags, opener);
+    auto file_size = NumericCast<int64_t>(fs.GetFileSize(*remote_handle));
+    if (!ColumnstoreCache::Fits(file_size)) {
+        return remote_handle;
+    }
+    // Downloads go to a private file first, so concurrent readers never see a partial file
+    string temp_file_path = cached_file_path + "." + UUID::ToString(UUID::GenerateRandomUUID()) + ".tmp";
+    try {
+        Download(*remote_handle, file_size, temp_file_path);
+    } catch (...) {
+        std::remove(temp_file_path.c_str());
+        throw;
+    }
+    // Admitted only once in place, so that backends never find an entry whose file is yet to appear
+    local_fs->MoveFile(temp_file_path, cached_file_path);
+    if (!ColumnstoreCache::Admit(file_name, file_size)) {
+        std::remove(cached_file_path.c_str());
+        return remote_handle;
+    }
+    auto handle = local_fs->OpenFile(cached_file_path, flags | FileFlags::FILE_FLAGS_NULL_IF_NOT_EXISTS, opener);
+    return handle ? std::move(handle) : std::move(remote_handle);
+}
+
+bool ColumnstoreCacheFileSystem::IsReadThroughPath(const string &path) {
+    return StringUtil::StartsWith(path, x_read_through_prefix);
+}
+
+bool ColumnstoreCacheFileSystem::CanHandleFile(const string &fpath) {
+    return IsReadThroughPath(fpath);
+}
+
+void ColumnstoreCacheFileSystem::Download(FileHandle &remote_handle, int64_t file_size, const string &file_path) {
+    static const idx_t x_buffer_size = 8 * 1024 * 1024;
+
+    auto handle = local_fs->OpenFile(file_path, FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_FILE_CREATE_NEW);
+    auto buffer = Allocator::DefaultAllocator().Allocate(x_buffer_size);
+    for (idx_t offset = 0; offset < idx_t(file_size); offset += x_buffer_size) {
+        idx_t nr_bytes = MinValue(x_buffer_size, idx_t(file_size) - offset);
+        fs.Read(remote_handle, buffer.get(), NumericCast<int64_t>(nr_bytes), offset);
+        handle->Write(buffer.get(), nr_bytes);
+    }
+    handle->Sync();
+    handle->Close();
+}
+
+} // namespace duckdb
+
+void MooncakeInitCache() {
+    if (!process_shared_preload_libraries_in_progress) {
+        return;
+    }
+#if PG_VERSION_NUM >= 150000
+    duckdb::prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = duckdb::CacheShmemRequest;
+#else
+    RequestAddinShmemSpace(sizeof(duckdb::CacheState));
+#endif
+    duckdb::prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = duckdb::CacheShmemStartup;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+
+namespace duckdb {
+
+// Bounded LRU cache of remote data files (and their footers, see ColumnstoreFooterCache) under mooncake_local_cache/.
+// Its contents are tracked in shared memory, so all backends share one budget (mooncake.local_cache_size); that needs
+// pg_mooncake in shared_preload_libraries. Without shared memory the cache is neither bounded nor read-through, only
+// files written by this server land in it. All methods are safe to call from DuckDB threads.
+class ColumnstoreCache {
+public:
+    static bool IsShared();
+
+    // Whether a file of this size may be cached at all
+    static bool Fits(int64_t file_size);
+
+    // Starts tracking the files cached before a restart, called by each backend as it starts DuckDB
+    static void LoadExistingFiles();
+
+    // Marks a cached file as just used, returns false if it isn't cached. generation identifies this admission of it.
+    static bool Touch(const string &file_name, uint64_t *generation = nullptr);
+
+    // Starts tracking a file just added to the cache, evicting the least recently used files to stay within budget.
+    // Files must be complete and in place before they are admitted. Returns false if the file doesn't fit, in which
+    // case the caller removes it.
+    static bool Admit(const string &file_name, int64_t file_size);
+
+    static void Remove(const string &file_name);
+
+    // Stops tracking a file whose cached copy turned out to be missing, unless it was admitted again since Touch
+    // returned generation
+    static void Remove(const string &file_name, uint64_t generation);
+};
+
+// Serves paths made by GetReadThroughPath from the local cache, downloading the whole remote file on first access
+class ColumnstoreCacheFileSystem : public FileSystem {
+public:
+    explicit ColumnstoreCacheFileSystem(FileSystem &fs);
+
+    static string GetReadThroughPath(const string &remote_path);
+
+    static bool IsReadThroughPath(const string &path);
+
+public:
+    unique_ptr<FileHandle> OpenFile(const string &path, FileOpenFlags flags,
+                                    optional_ptr<FileOpener> opener = nullptr) override;
+
+    bool CanHandleFile(const string &fpath) override;
+
+    string GetName() const override {
+        return "ColumnstoreCacheFileSystem";
+    }
+
+private:
+    void Download(FileHandle &remote_handle, int64_t file_size, const string &file_path);
+
+private:
+    FileSystem &fs;
+    unique_ptr<FileSystem> local_fs;
+};
+
+} // namespace duckdb
@@ -0,0 +1,154 @@
+#include "columnstore/columnstore_footer_cache.hpp"
+#include "columnstore/columnstore_cache.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "duckdb/common/serializer/memory_stream.hpp"
+#include "duckdb/common/types/uuid.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include "geo_parquet.hpp"
+#include "parquet_file_metadata_cache.hpp"
+#include "pgmooncake_guc.hpp"
+#include "thrift/protocol/TCompactProtocol.h"
+
+namespace duckdb {
+
+namespace {
+
+class ThriftMemoryTransport : public duckdb_apache::thrift::transport::TTransport {
+public:
+    explicit ThriftMemoryTransport(MemoryStream &stream) : stream(stream) {}
+
+    bool isOpen() const override {
+        return true;
+    }
+
+    void open() override {}
+
+    void close() override {}
+
+    uint32_t read_virt(uint8_t *buf, uint32_t len) override {
+        stream.ReadData(data_ptr_cast(buf), len);
+        return len;
+    }
+
+    void write_virt(const uint8_t *buf, uint32_t len) override {
+        stream.WriteData(const_data_ptr_cast(buf), len);
+    }
+
+private:
+    MemoryStream &stream;
+};
+
+const char *x_footers_directory = "footers/";
+
+// Cache entries of footers are named after their data file, relative to the cache directory
+string GetFooterName(const string &file_path) {
+    if (!mooncake_enable_local_cache ||
+        (!FileSystem::IsRemoteFile(file_path) && !ColumnstoreCacheFileSystem::IsReadThroughPath(file_path))) {
+        return "";
+    }
+    return x_footers_directory + file_path.substr(file_path.rfind('/') + 1);
+}
+
+bool IsCached(const string &footer_name, uint64_t *generation = nullptr) {
+    if (ColumnstoreCache::IsShared()) {
+        return ColumnstoreCache::Touch(footer_name, generation);
+    }
+    return FileSystem::CreateLocal()->FileExists(x_mooncake_local_cache + footer_name);
+}
+
+void WriteFooter(const string &footer_name, MemoryStream &stream) {
+    string footer_path = x_mooncake_local_cache + footer_name;
+    string temp_footer_path = footer_path + "." + UUID::ToString(UUID::GenerateRandomUUID()) + ".tmp";
+    auto local_fs = FileSystem::CreateLocal();
+    try {
+        auto handle =
+            local_fs->OpenFile(temp_footer_path, FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_FILE_CREATE_NEW);
+        handle->Write(stream.GetData(), stream.GetPosition());
+        handle->Close();
+        local_fs->MoveFile(temp_footer_path, footer_path);
+    } catch (...) {
+        std::remove(temp_footer_path.c_str());
+        throw;
+    }
+    if (!ColumnstoreCache::Admit(footer_name, NumericCast<int64_t>(stream.GetPosition()))) {
+        std::remove(footer_path.c_str());
+    }
+}
+
+} // namespace
+
+void ColumnstoreFooterCache::Load(ClientContext &context, const string &file_path) {
+    string footer_name = GetFooterName(file_path);
+    if (footer_name.empty()) {
+        return;
+    }
+    auto &object_cache = ObjectCache::GetObjectCache(context);
+    if (object_cache.Get<ParquetFileMetadataCache>(file_path)) {
+        return;
+    }
+    uint64_t generation = 0;
+    try {
+        if (!IsCached(footer_name, &generation)) {
+            return;
+        }
+        auto local_fs = FileSystem::CreateLocal();
+        auto handle = local_fs->OpenFile(x_mooncake_local_cache + footer_name,
+                                         FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_NULL_IF_NOT_EXISTS);
+        if (!handle) {
+            ColumnstoreCache::Remove(footer_name, generation);
+            return;
+        }
+        auto buffer = Allocator::DefaultAllocator().Allocate(NumericCast<idx_t>(local_fs->GetFileSize(*handle)));
+        handle->Read(buffer.get(), buffer.GetSize());
+        auto file_metadata = ReadFileMetaData(buffer.get(), buffer.GetSize());
+        auto geo_metadata = GeoParquetFileMetadata::TryRead(*file_metadata, context);
+        object_cache.Put(file_path, make_shared_ptr<ParquetFileMetadataCache>(std::move(file_metadata), time(nullptr),
+                                                                               std::move(geo_metadata)));
+    } catch (std::exception &) {
+        // A truncated or corrupt footer would fail every scan, it is dropped so the next one caches it anew
+        ColumnstoreCache::Remove(footer_name, generation);
+        std::remove((x_mooncake_local_cache + footer_name).c_str());
+    }
+}
+
+void ColumnstoreFooterCache::Store(ClientContext &context, const string &file_path) {
+    string footer_name = GetFooterName(file_path);
+    if (footer_name.empty() || IsCached(footer_name)) {
+        return;
+    }
+    auto metadata = ObjectCache::GetObjectCache(context).Get<ParquetFileMetadataCache>(file_path);
+    if (metadata && metadata->metadata) {
+        Store(file_path, *metadata->metadata);
+    }
+}
+
+void ColumnstoreFooterCache::Store(const string &file_path, const duckdb_parquet::format::FileMetaData &file_metadata) {
+    string footer_name = GetFooterName(file_path);
+    if (footer_name.empty()) {
+        return;
+    }
+    try {
+        MemoryStream stream;
+        WriteFileMetaData(file_metadata, stream);
+        WriteFooter(footer_name, stream);
+    } catch (std::exception &) {
+        // The footer is read from the data file as usual, e.g. while the local disk is full
+    }
+}
+
+void WriteFileMetaData(const duckdb_parquet::format::FileMetaData &file_metadata, MemoryStream &stream) {
+    duckdb_apache::thrift::protocol::TCompactProtocolFactoryT<ThriftMemoryTransport> protocol_factory;
+    auto protocol = protocol_factory.getProtocol(std::make_shared<ThriftMemoryTransport>(stream));
+    file_metadata.write(protocol.get());
+}
+
+unique_ptr<duckdb_parquet::format::FileMetaData> ReadFileMetaData(data_ptr_t data, idx_t size) {
+    MemoryStream stream(data, size);
+    duckdb_apache::thrift::protocol::TCompactProtocolFactoryT<ThriftMemoryTransport> protocol_factory;
+    auto protocol = protocol_factory.getProtocol(std::make_shared<ThriftMemoryTransport>(stream));
+    auto file_metadata = make_uniq<duckdb_parquet::format::FileMetaData>();
+    file_metadata->read(protocol.get());
+    return file_metadata;
+}
+
+} // namespace duckdb
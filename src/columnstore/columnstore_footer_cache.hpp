@@ -0,0 +1,36 @@
+#pragma once
+
+#include "duckdb/common/types.hpp"
+#include "duckdb/common/unique_ptr.hpp"
+
+namespace duckdb_parquet {
+namespace format {
+class FileMetaData;
+} // namespace format
+} // namespace duckdb_parquet
+
+namespace duckdb {
+
+class ClientContext;
+class MemoryStream;
+
+// Footers of remote data files, cached under mooncake_local_cache/footers/ within the budget of ColumnstoreCache. Data
+// files never change, so entries need no invalidation. A backend opening a data file whose footer another backend
+// has read gets it from local disk, and ParquetReader then finds it in DuckDB's object cache instead of fetching it.
+// Failures fall back to reading the footer from the data file as usual, cached footers that fail to read are removed.
+class ColumnstoreFooterCache {
+public:
+    // Puts the cached footer of a data file into DuckDB's object cache under file_path
+    static void Load(ClientContext &context, const string &file_path);
+
+    // Caches the footer ParquetReader left in DuckDB's object cache
+    static void Store(ClientContext &context, const string &file_path);
+
+    static void Store(const string &file_path, const duckdb_parquet::format::FileMetaData &file_metadata);
+};
+
+void WriteFileMetaData(const duckdb_parquet::format::FileMetaData &file_metadata, MemoryStream &stream);
+
+unique_ptr<duckdb_parquet::format::FileMetaData> ReadFileMetaData(data_ptr_t data, idx_t size);
+
+} // namespace duckdb
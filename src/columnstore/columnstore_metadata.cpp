@@ -1,4 +1,5 @@
 #include "columnstore/columnstore_metadata.hpp"
+#include "duckdb/common/unordered_set.hpp"
 #include "pgduckdb/pgduckdb_utils.hpp"
 #include "pgmooncake_guc.hpp"
 
@@ -10,12 +11,21 @@ extern "C" {
 #include "access/xact.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
 #include "miscadmin.h"
+#include "storage/lmgr.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/snapshot.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
 }
 
 namespace duckdb {
@@ -23,29 +33,237 @@ namespace duckdb {
 namespace {
 
 constexpr int x_tables_natts = 2;
-constexpr int x_data_files_natts = 2;
+constexpr int x_data_files_natts = 8;
+constexpr int x_deletion_vectors_natts = 4;
+constexpr int x_buffered_files_natts = 6;
+constexpr int x_compaction_policies_natts = 3;
+constexpr int x_storage_options_natts = 13;
+constexpr int x_lake_outbox_natts = 6;
 constexpr int x_secrets_natts = 5;
 
-Oid Mooncake() {
-    return get_namespace_oid("mooncake", false /*missing_ok*/);
+// Relations of the mooncake schema, their OIDs are resolved once per backend
+enum CatalogRelation {
+    x_tables,
+    x_tables_oid,
+    x_data_files,
+    x_data_files_oid,
+    x_data_files_file_name,
+    x_deletion_vectors,
+    x_deletion_vectors_oid,
+    x_deletion_vectors_file_name,
+    x_buffered_files,
+    x_buffered_files_oid,
+    x_buffered_files_file_name,
+    x_compaction_policies,
+    x_compaction_policies_oid,
+    x_storage_options,
+    x_storage_options_oid,
+    x_lake_outbox,
+    x_lake_outbox_oid,
+    x_secrets,
+    x_num_catalog_relations
+};
+
+const char *x_catalog_relation_names[x_num_catalog_relations] = {"tables",
+                                                                  "tables_oid",
+                                                                  "data_files",
+                                                                  "data_files_oid",
+                                                                  "data_files_file_name",
+                                                                  "deletion_vectors",
+                                                                  "deletion_vectors_oid",
+                                                                  "deletion_vectors_file_name",
+                                                                  "buffered_files",
+                                                                  "buffered_files_oid",
+                                                                  "buffered_files_file_name",
+                                                                  "compaction_policies",
+                                                                  "compaction_policies_oid",
+                                                                  "storage_options",
+                                                                  "storage_options_oid",
+                                                                  "lake_outbox",
+                                                                  "lake_outbox_oid",
+                                                                  "secrets"};
+
+Oid catalog_relids[x_num_catalog_relations];
+bool callbacks_registered = false;
+uint32 mooncake_hash_value;
+
+// Catalog rows a scan with a snapshot returned, reused by later scans with an identical snapshot. MVCC guarantees the
+// same rows, except for rows written by subtransactions of our own that were rolled back since, so the cache is also
+// dropped on abort.
+struct SnapshotKey {
+    TransactionId xmin;
+    TransactionId xmax;
+    vector<TransactionId> xip;
+    vector<TransactionId> subxip;
+    bool suboverflowed;
+    CommandId curcid;
+
+    bool Matches(Snapshot snapshot) const {
+        return snapshot->xmin == xmin && snapshot->xmax == xmax && snapshot->suboverflowed == suboverflowed &&
+               snapshot->curcid == curcid && snapshot->xcnt == xip.size() &&
+               std::equal(xip.begin(), xip.end(), snapshot->xip) && snapshot->subxcnt == int32(subxip.size()) &&
+               std::equal(subxip.begin(), subxip.end(), snapshot->subxip);
+    }
+};
+
+struct TableCacheEntry {
+    bool has_path = false;
+    string path;
+    bool has_data_files = false;
+    vector<ColumnstoreDataFile> data_files;
+};
+
+struct {
+    bool valid;
+    SnapshotKey snapshot;
+    unordered_map<Oid, TableCacheEntry> tables;
+} table_cache;
+
+void InvalidateCatalogRelids(Datum /*arg*/, int /*cache_id*/, uint32 hash_value) {
+    if (hash_value == mooncake_hash_value) {
+        std::fill(catalog_relids, catalog_relids + x_num_catalog_relations, InvalidOid);
+    }
+}
+
+void InvalidateCatalogRelid(Datum /*arg*/, Oid relid) {
+    for (auto &catalog_relid : catalog_relids) {
+        if (relid == InvalidOid || relid == catalog_relid) {
+            catalog_relid = InvalidOid;
+        }
+    }
+}
+
+void InvalidateTableCache() {
+    table_cache.valid = false;
+    table_cache.tables.clear();
+}
+
+void TableCacheXactCallback(XactEvent event, void * /*arg*/) {
+    if (event == XACT_EVENT_ABORT || event == XACT_EVENT_PARALLEL_ABORT) {
+        InvalidateTableCache();
+    }
+}
+
+void TableCacheSubXactCallback(SubXactEvent event, SubTransactionId /*my_subid*/, SubTransactionId /*parent_subid*/,
+                               void * /*arg*/) {
+    if (event == SUBXACT_EVENT_ABORT_SUB) {
+        InvalidateTableCache();
+    }
+}
+
+void RegisterCallbacks() {
+    if (callbacks_registered) {
+        return;
+    }
+    callbacks_registered = true;
+    // The schema is recreated along with the extension
+    mooncake_hash_value = GetSysCacheHashValue1(NAMESPACENAME, CStringGetDatum("mooncake"));
+    CacheRegisterSyscacheCallback(NAMESPACENAME, InvalidateCatalogRelids, (Datum)0);
+    CacheRegisterRelcacheCallback(InvalidateCatalogRelid, (Datum)0);
+    RegisterXactCallback(TableCacheXactCallback, NULL /*arg*/);
+    RegisterSubXactCallback(TableCacheSubXactCallback, NULL /*arg*/);
 }
+
+Oid GetCatalogRelid(CatalogRelation relation) {
+    RegisterCallbacks();
+    if (catalog_relids[relation] == InvalidOid) {
+        Oid mooncake = get_namespace_oid("mooncake", false /*missing_ok*/);
+        catalog_relids[relation] = get_relname_relid(x_catalog_relation_names[relation], mooncake);
+    }
+    return catalog_relids[relation];
+}
+
+// nullptr for snapshots that aren't worth caching, e.g. the latest catalog snapshot
+TableCacheEntry *GetTableCacheEntry(Snapshot snapshot, Oid oid) {
+    if (snapshot == NULL || snapshot->snapshot_type != SNAPSHOT_MVCC) {
+        return nullptr;
+    }
+    RegisterCallbacks();
+    if (!table_cache.valid || !table_cache.snapshot.Matches(snapshot)) {
+        InvalidateTableCache();
+        table_cache.snapshot = {snapshot->xmin,
+                                snapshot->xmax,
+                                vector<TransactionId>(snapshot->xip, snapshot->xip + snapshot->xcnt),
+                                vector<TransactionId>(snapshot->subxip, snapshot->subxip + snapshot->subxcnt),
+                                snapshot->suboverflowed,
+                                snapshot->curcid};
+        table_cache.valid = true;
+    }
+    return &table_cache.tables[oid];
+}
+
 Oid Tables() {
-    return get_relname_relid("tables", Mooncake());
+    return GetCatalogRelid(x_tables);
 }
 Oid TablesOid() {
-    return get_relname_relid("tables_oid", Mooncake());
+    return GetCatalogRelid(x_tables_oid);
 }
 Oid DataFiles() {
-    return get_relname_relid("data_files", Mooncake());
+    return GetCatalogRelid(x_data_files);
 }
 Oid DataFilesOid() {
-    return get_relname_relid("data_files_oid", Mooncake());
+    return GetCatalogRelid(x_data_files_oid);
 }
 Oid DataFilesFileName() {
-    return get_relname_relid("data_files_file_name", Mooncake());
+    return GetCatalogRelid(x_data_files_file_name);
+}
+Oid DeletionVectors() {
+    return GetCatalogRelid(x_deletion_vectors);
+}
+Oid DeletionVectorsOid() {
+    return GetCatalogRelid(x_deletion_vectors_oid);
+}
+Oid DeletionVectorsFileName() {
+    return GetCatalogRelid(x_deletion_vectors_file_name);
+}
+Oid BufferedFiles() {
+    return GetCatalogRelid(x_buffered_files);
+}
+Oid BufferedFilesOid() {
+    return GetCatalogRelid(x_buffered_files_oid);
+}
+Oid BufferedFilesFileName() {
+    return GetCatalogRelid(x_buffered_files_file_name);
+}
+Oid CompactionPolicies() {
+    return GetCatalogRelid(x_compaction_policies);
+}
+Oid CompactionPoliciesOid() {
+    return GetCatalogRelid(x_compaction_policies_oid);
+}
+Oid StorageOptions() {
+    return GetCatalogRelid(x_storage_options);
+}
+Oid StorageOptionsOid() {
+    return GetCatalogRelid(x_storage_options_oid);
+}
+Oid LakeOutbox() {
+    return GetCatalogRelid(x_lake_outbox);
+}
+Oid LakeOutboxOid() {
+    return GetCatalogRelid(x_lake_outbox_oid);
 }
 Oid Secrets() {
-    return get_relname_relid("secrets", Mooncake());
+    return GetCatalogRelid(x_secrets);
+}
+
+Datum ArrayGetDatum(Datum *elems, bool *isnull, int nelems, Oid elem_type) {
+    int dims[1] = {nelems};
+    int lbs[1] = {1};
+    int16 typlen;
+    bool typbyval;
+    char typalign;
+    get_typlenbyvalalign(elem_type, &typlen, &typbyval, &typalign);
+    return PointerGetDatum(construct_md_array(elems, isnull, 1 /*ndims*/, dims, lbs, elem_type, typlen, typbyval,
+                                              typalign));
+}
+
+void DatumGetArray(Datum datum, Oid elem_type, Datum **elems /*out*/, bool **isnull /*out*/, int *nelems /*out*/) {
+    int16 typlen;
+    bool typbyval;
+    char typalign;
+    get_typlenbyvalalign(elem_type, &typlen, &typbyval, &typalign);
+    deconstruct_array(DatumGetArrayTypeP(datum), elem_type, typlen, typbyval, typalign, elems, isnull, nelems);
 }
 
 } // namespace
@@ -80,6 +298,10 @@ void ColumnstoreMetadata::TablesDelete(Oid oid) {
 }
 
 string ColumnstoreMetadata::TablesSearch(Oid oid) {
+    auto cache_entry = GetTableCacheEntry(snapshot, oid);
+    if (cache_entry && cache_entry->has_path) {
+        return cache_entry->path;
+    }
     ::Relation table = table_open(Tables(), AccessShareLock);
     ::Relation index = index_open(TablesOid(), AccessShareLock);
     TupleDesc desc = RelationGetDescr(table);
@@ -99,9 +321,33 @@ string ColumnstoreMetadata::TablesSearch(Oid oid) {
     systable_endscan_ordered(scan);
     index_close(index, AccessShareLock);
     table_close(table, AccessShareLock);
+    if (cache_entry) {
+        cache_entry->has_path = true;
+        cache_entry->path = path;
+    }
     return path;
 }
 
+vector<Oid> ColumnstoreMetadata::TablesSearch() {
+    ::Relation table = table_open(Tables(), AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    SysScanDescData *scan =
+        systable_beginscan(table, InvalidOid /*indexId*/, false /*indexOK*/, snapshot, 0 /*nkeys*/, NULL /*key*/);
+
+    vector<Oid> oids;
+    HeapTuple tuple;
+    Datum values[x_tables_natts];
+    bool isnull[x_tables_natts];
+    while (HeapTupleIsValid(tuple = systable_getnext(scan))) {
+        heap_deform_tuple(tuple, desc, values, isnull);
+        oids.push_back(DatumGetObjectId(values[0]));
+    }
+
+    systable_endscan(scan);
+    table_close(table, AccessShareLock);
+    return oids;
+}
+
 string ColumnstoreMetadata::GetTablePath(Oid oid) {
     ::Relation table = table_open(oid, AccessShareLock);
     string path =
@@ -137,11 +383,33 @@ void ColumnstoreMetadata::GetTableMetadata(Oid oid, string &table_name /*out*/,
     table_close(table, AccessShareLock);
 }
 
-void ColumnstoreMetadata::DataFilesInsert(Oid oid, const string &file_name) {
+void ColumnstoreMetadata::DataFilesInsert(Oid oid, const ColumnstoreDataFile &data_file) {
     ::Relation table = table_open(DataFiles(), RowExclusiveLock);
     TupleDesc desc = RelationGetDescr(table);
-    Datum values[x_data_files_natts] = {oid, CStringGetTextDatum(file_name.c_str())};
-    bool isnull[x_data_files_natts] = {false, false};
+    int num_columns = NumericCast<int>(data_file.column_stats.size());
+    auto column_names = make_uniq_array<Datum>(num_columns);
+    auto null_counts = make_uniq_array<Datum>(num_columns);
+    auto min_values = make_uniq_array<Datum>(num_columns);
+    auto max_values = make_uniq_array<Datum>(num_columns);
+    auto min_max_isnull = make_uniq_array<bool>(num_columns);
+    for (int i = 0; i < num_columns; i++) {
+        auto &column_stats = data_file.column_stats[i];
+        column_names[i] = CStringGetTextDatum(column_stats.column_name.c_str());
+        null_counts[i] = Int64GetDatum(column_stats.null_count);
+        min_values[i] = CStringGetTextDatum(column_stats.min_value.c_str());
+        max_values[i] = CStringGetTextDatum(column_stats.max_value.c_str());
+        min_max_isnull[i] = !column_stats.has_min_max;
+    }
+    Datum values[x_data_files_natts] = {
+        oid,
+        CStringGetTextDatum(data_file.file_name.c_str()),
+        Int64GetDatum(data_file.file_size),
+        Int64GetDatum(data_file.row_count),
+        ArrayGetDatum(column_names.get(), NULL /*isnull*/, num_columns, TEXTOID),
+        ArrayGetDatum(null_counts.get(), NULL /*isnull*/, num_columns, INT8OID),
+        ArrayGetDatum(min_values.get(), min_max_isnull.get(), num_columns, TEXTOID),
+        ArrayGetDatum(max_values.get(), min_max_isnull.get(), num_columns, TEXTOID)};
+    bool isnull[x_data_files_natts] = {false, false, false, false, false, false, false, false};
     HeapTuple tuple = heap_form_tuple(desc, values, isnull);
     PostgresFunctionGuard(CatalogTupleInsert, table, tuple);
     CommandCounterIncrement();
@@ -165,6 +433,7 @@ void ColumnstoreMetadata::DataFilesDelete(const string &file_name) {
     CommandCounterIncrement();
     index_close(index, RowExclusiveLock);
     table_close(table, RowExclusiveLock);
+    DeletionVectorsDelete(file_name);
 }
 
 void ColumnstoreMetadata::DataFilesDelete(Oid oid) {
@@ -183,9 +452,14 @@ void ColumnstoreMetadata::DataFilesDelete(Oid oid) {
     CommandCounterIncrement();
     index_close(index, RowExclusiveLock);
     table_close(table, RowExclusiveLock);
+    DeletionVectorsDelete(oid);
 }
 
-vector<string> ColumnstoreMetadata::DataFilesSearch(Oid oid) {
+vector<ColumnstoreDataFile> ColumnstoreMetadata::DataFilesSearch(Oid oid) {
+    auto cache_entry = GetTableCacheEntry(snapshot, oid);
+    if (cache_entry && cache_entry->has_data_files) {
+        return cache_entry->data_files;
+    }
     ::Relation table = table_open(DataFiles(), AccessShareLock);
     ::Relation index = index_open(DataFilesOid(), AccessShareLock);
     TupleDesc desc = RelationGetDescr(table);
@@ -193,19 +467,465 @@ vector<string> ColumnstoreMetadata::DataFilesSearch(Oid oid) {
     ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
     SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
 
-    vector<string> file_names;
+    vector<ColumnstoreDataFile> data_files;
     HeapTuple tuple;
     Datum values[x_data_files_natts];
     bool isnull[x_data_files_natts];
     while (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
         heap_deform_tuple(tuple, desc, values, isnull);
-        file_names.emplace_back(TextDatumGetCString(values[1]));
+        ColumnstoreDataFile data_file{TextDatumGetCString(values[1]), DatumGetInt64(values[2]),
+                                      DatumGetInt64(values[3]), {} /*column_stats*/};
+        Datum *column_names, *null_counts, *min_values, *max_values;
+        bool *column_names_isnull, *null_counts_isnull, *min_values_isnull, *max_values_isnull;
+        int num_columns, num_null_counts, num_min_values, num_max_values;
+        DatumGetArray(values[4], TEXTOID, &column_names, &column_names_isnull, &num_columns);
+        DatumGetArray(values[5], INT8OID, &null_counts, &null_counts_isnull, &num_null_counts);
+        DatumGetArray(values[6], TEXTOID, &min_values, &min_values_isnull, &num_min_values);
+        DatumGetArray(values[7], TEXTOID, &max_values, &max_values_isnull, &num_max_values);
+        D_ASSERT(num_null_counts == num_columns && num_min_values == num_columns && num_max_values == num_columns);
+        for (int i = 0; i < num_columns; i++) {
+            bool has_min_max = !min_values_isnull[i] && !max_values_isnull[i];
+            data_file.column_stats.push_back({TextDatumGetCString(column_names[i]), DatumGetInt64(null_counts[i]),
+                                              has_min_max, has_min_max ? TextDatumGetCString(min_values[i]) : "",
+                                              has_min_max ? TextDatumGetCString(max_values[i]) : ""});
+        }
+        data_files.push_back(std::move(data_file));
+    }
+
+    systable_endscan_ordered(scan);
+    index_close(index, AccessShareLock);
+    table_close(table, AccessShareLock);
+
+    table = table_open(DeletionVectors(), AccessShareLock);
+    index = index_open(DeletionVectorsOid(), AccessShareLock);
+    desc = RelationGetDescr(table);
+    scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    unordered_map<string, idx_t> data_file_indices;
+    for (idx_t i = 0; i < data_files.size(); i++) {
+        data_file_indices[data_files[i].file_name] = i;
+    }
+    Datum dv_values[x_deletion_vectors_natts];
+    bool dv_isnull[x_deletion_vectors_natts];
+    while (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        heap_deform_tuple(tuple, desc, dv_values, dv_isnull);
+        auto it = data_file_indices.find(TextDatumGetCString(dv_values[1]));
+        if (it != data_file_indices.end()) {
+            bytea *content = DatumGetByteaPP(dv_values[3]);
+            auto &deleted_rows = data_files[it->second].deleted_rows;
+            deleted_rows.resize(VARSIZE_ANY_EXHDR(content) / sizeof(uint32_t));
+            memcpy(deleted_rows.data(), VARDATA_ANY(content), deleted_rows.size() * sizeof(uint32_t));
+        }
     }
 
     systable_endscan_ordered(scan);
     index_close(index, AccessShareLock);
     table_close(table, AccessShareLock);
-    return file_names;
+    if (cache_entry) {
+        cache_entry->has_data_files = true;
+        cache_entry->data_files = data_files;
+    }
+    return data_files;
+}
+
+// Replaces the deletion vector of the file, if any
+void ColumnstoreMetadata::DeletionVectorsInsert(Oid oid, const string &file_name,
+                                                const vector<uint32_t> &deleted_rows) {
+    DeletionVectorsDelete(file_name);
+    ::Relation table = table_open(DeletionVectors(), RowExclusiveLock);
+    TupleDesc desc = RelationGetDescr(table);
+    size_t content_size = deleted_rows.size() * sizeof(uint32_t);
+    bytea *content = static_cast<bytea *>(palloc(VARHDRSZ + content_size));
+    SET_VARSIZE(content, VARHDRSZ + content_size);
+    memcpy(VARDATA(content), deleted_rows.data(), content_size);
+    Datum values[x_deletion_vectors_natts] = {oid, CStringGetTextDatum(file_name.c_str()),
+                                              Int64GetDatum(deleted_rows.size()), PointerGetDatum(content)};
+    bool isnull[x_deletion_vectors_natts] = {false, false, false, false};
+    HeapTuple tuple = heap_form_tuple(desc, values, isnull);
+    PostgresFunctionGuard(CatalogTupleInsert, table, tuple);
+    CommandCounterIncrement();
+    table_close(table, RowExclusiveLock);
+}
+
+void ColumnstoreMetadata::DeletionVectorsDelete(const string &file_name) {
+    ::Relation table = table_open(DeletionVectors(), RowExclusiveLock);
+    ::Relation index = index_open(DeletionVectorsFileName(), RowExclusiveLock);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 2 /*attributeNumber*/, BTEqualStrategyNumber, F_TEXTEQ,
+                CStringGetTextDatum(file_name.c_str()));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    HeapTuple tuple;
+    if (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        PostgresFunctionGuard(CatalogTupleDelete, table, &tuple->t_self);
+    }
+
+    systable_endscan_ordered(scan);
+    CommandCounterIncrement();
+    index_close(index, RowExclusiveLock);
+    table_close(table, RowExclusiveLock);
+}
+
+void ColumnstoreMetadata::DeletionVectorsDelete(Oid oid) {
+    ::Relation table = table_open(DeletionVectors(), RowExclusiveLock);
+    ::Relation index = index_open(DeletionVectorsOid(), RowExclusiveLock);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    HeapTuple tuple;
+    while (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        PostgresFunctionGuard(CatalogTupleDelete, table, &tuple->t_self);
+    }
+
+    systable_endscan_ordered(scan);
+    CommandCounterIncrement();
+    index_close(index, RowExclusiveLock);
+    table_close(table, RowExclusiveLock);
+}
+
+void ColumnstoreMetadata::BufferedFilesInsert(Oid oid, const string &file_name, int64_t row_count,
+                                              const string &content) {
+    ::Relation table = table_open(BufferedFiles(), RowExclusiveLock);
+    TupleDesc desc = RelationGetDescr(table);
+    bytea *data = static_cast<bytea *>(palloc(VARHDRSZ + content.size()));
+    SET_VARSIZE(data, VARHDRSZ + content.size());
+    memcpy(VARDATA(data), content.data(), content.size());
+    Datum values[x_buffered_files_natts] = {oid,
+                                            CStringGetTextDatum(file_name.c_str()),
+                                            Int64GetDatum(row_count),
+                                            Int64GetDatum(content.size()),
+                                            TimestampTzGetDatum(GetCurrentTimestamp()),
+                                            PointerGetDatum(data)};
+    bool isnull[x_buffered_files_natts] = {false, false, false, false, false, false};
+    HeapTuple tuple = heap_form_tuple(desc, values, isnull);
+    PostgresFunctionGuard(CatalogTupleInsert, table, tuple);
+    CommandCounterIncrement();
+    table_close(table, RowExclusiveLock);
+}
+
+void ColumnstoreMetadata::BufferedFilesDelete(const string &file_name) {
+    ::Relation table = table_open(BufferedFiles(), RowExclusiveLock);
+    ::Relation index = index_open(BufferedFilesFileName(), RowExclusiveLock);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 2 /*attributeNumber*/, BTEqualStrategyNumber, F_TEXTEQ,
+                CStringGetTextDatum(file_name.c_str()));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    HeapTuple tuple;
+    if (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        PostgresFunctionGuard(CatalogTupleDelete, table, &tuple->t_self);
+    }
+
+    systable_endscan_ordered(scan);
+    CommandCounterIncrement();
+    index_close(index, RowExclusiveLock);
+    table_close(table, RowExclusiveLock);
+}
+
+void ColumnstoreMetadata::BufferedFilesDelete(Oid oid) {
+    ::Relation table = table_open(BufferedFiles(), RowExclusiveLock);
+    ::Relation index = index_open(BufferedFilesOid(), RowExclusiveLock);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    HeapTuple tuple;
+    while (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        PostgresFunctionGuard(CatalogTupleDelete, table, &tuple->t_self);
+    }
+
+    systable_endscan_ordered(scan);
+    CommandCounterIncrement();
+    index_close(index, RowExclusiveLock);
+    table_close(table, RowExclusiveLock);
+}
+
+vector<BufferedFile> ColumnstoreMetadata::BufferedFilesSearch(Oid oid) {
+    ::Relation table = table_open(BufferedFiles(), AccessShareLock);
+    ::Relation index = index_open(BufferedFilesOid(), AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    vector<BufferedFile> buffered_files;
+    TimestampTz now = GetCurrentTimestamp();
+    HeapTuple tuple;
+    Datum values[x_buffered_files_natts];
+    bool isnull[x_buffered_files_natts];
+    while (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        // content is left untouched so it is never detoasted here
+        heap_deform_tuple(tuple, desc, values, isnull);
+        buffered_files.push_back({TextDatumGetCString(values[1]), DatumGetInt64(values[2]), DatumGetInt64(values[3]),
+                                  (now - DatumGetTimestampTz(values[4])) / USECS_PER_SEC});
+    }
+
+    systable_endscan_ordered(scan);
+    index_close(index, AccessShareLock);
+    table_close(table, AccessShareLock);
+    return buffered_files;
+}
+
+string ColumnstoreMetadata::BufferedFilesGetContent(const string &file_name) {
+    ::Relation table = table_open(BufferedFiles(), AccessShareLock);
+    ::Relation index = index_open(BufferedFilesFileName(), AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 2 /*attributeNumber*/, BTEqualStrategyNumber, F_TEXTEQ,
+                CStringGetTextDatum(file_name.c_str()));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    string content;
+    HeapTuple tuple;
+    Datum values[x_buffered_files_natts];
+    bool isnull[x_buffered_files_natts];
+    if (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        heap_deform_tuple(tuple, desc, values, isnull);
+        bytea *data = DatumGetByteaPP(values[5]);
+        content.assign(VARDATA_ANY(data), VARSIZE_ANY_EXHDR(data));
+    }
+
+    systable_endscan_ordered(scan);
+    index_close(index, AccessShareLock);
+    table_close(table, AccessShareLock);
+    return content;
+}
+
+// A flush deletes buffered files that DELETE and UPDATE may also be deleting or rewriting, so like compaction it
+// excludes writers (but not readers) until the end of the transaction. The catalog snapshot is dropped, so that
+// buffered files a writer changed before we got the lock are seen as they are now.
+bool ColumnstoreMetadata::BufferedFilesTryLock(Oid oid) {
+    if (!ConditionalLockRelationOid(oid, ExclusiveLock)) {
+        return false;
+    }
+    InvalidateCatalogSnapshot();
+    return true;
+}
+
+// Columns left NULL in mooncake.compaction_policies fall back to the mooncake.compaction_* settings
+void ColumnstoreMetadata::CompactionPoliciesSearch(Oid oid, int64_t &target_file_size /*out*/,
+                                                   int64_t &min_file_count /*out*/) {
+    target_file_size = int64_t(mooncake_compaction_target_file_size) * 1024;
+    min_file_count = mooncake_compaction_min_file_count;
+
+    ::Relation table = table_open(CompactionPolicies(), AccessShareLock);
+    ::Relation index = index_open(CompactionPoliciesOid(), AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    HeapTuple tuple;
+    Datum values[x_compaction_policies_natts];
+    bool isnull[x_compaction_policies_natts];
+    if (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        heap_deform_tuple(tuple, desc, values, isnull);
+        if (!isnull[1]) {
+            target_file_size = DatumGetInt64(values[1]);
+        }
+        if (!isnull[2]) {
+            min_file_count = DatumGetInt32(values[2]);
+        }
+    }
+
+    systable_endscan_ordered(scan);
+    index_close(index, AccessShareLock);
+    table_close(table, AccessShareLock);
+}
+
+void ColumnstoreMetadata::StorageOptionsInsert(Oid oid, const ColumnstoreStorageOptions &options) {
+    ::Relation table = table_open(StorageOptions(), RowExclusiveLock);
+    TupleDesc desc = RelationGetDescr(table);
+    int num_sort_keys = NumericCast<int>(options.sort_by.size());
+    auto sort_by = make_uniq_array<Datum>(num_sort_keys);
+    for (int i = 0; i < num_sort_keys; i++) {
+        sort_by[i] = CStringGetTextDatum(options.sort_by[i].c_str());
+    }
+    int num_partition_keys = NumericCast<int>(options.partition_by.size());
+    auto partition_by = make_uniq_array<Datum>(num_partition_keys);
+    for (int i = 0; i < num_partition_keys; i++) {
+        partition_by[i] = CStringGetTextDatum(options.partition_by[i].c_str());
+    }
+    Datum values[x_storage_options_natts] = {oid,
+                                             CStringGetTextDatum(options.compression.c_str()),
+                                             Int32GetDatum(options.compression_level),
+                                             Float8GetDatum(options.dictionary_compression_ratio_threshold),
+                                             Int64GetDatum(options.row_group_size),
+                                             Int64GetDatum(options.row_group_size_bytes),
+                                             Int64GetDatum(options.file_size_bytes),
+                                             ArrayGetDatum(sort_by.get(), NULL /*isnull*/, num_sort_keys, TEXTOID),
+                                             BoolGetDatum(options.zorder),
+                                             ArrayGetDatum(partition_by.get(), NULL /*isnull*/, num_partition_keys,
+                                                           TEXTOID),
+                                             Int32GetDatum(options.checkpoint_interval),
+                                             Int64GetDatum(options.log_retention_secs),
+                                             CStringGetTextDatum(options.lake_format.c_str())};
+    bool nulls[x_storage_options_natts] = {false, false, !options.has_compression_level, false, false, false, false,
+                                           false, false, false, false, false, false};
+    HeapTuple tuple = heap_form_tuple(desc, values, nulls);
+    PostgresFunctionGuard(CatalogTupleInsert, table, tuple);
+    CommandCounterIncrement();
+    table_close(table, RowExclusiveLock);
+}
+
+// Tables created without storage options have no row and get the defaults of ColumnstoreStorageOptions
+ColumnstoreStorageOptions ColumnstoreMetadata::StorageOptionsSearch(Oid oid) {
+    ::Relation table = table_open(StorageOptions(), AccessShareLock);
+    ::Relation index = index_open(StorageOptionsOid(), AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    ColumnstoreStorageOptions options;
+    HeapTuple tuple;
+    Datum values[x_storage_options_natts];
+    bool isnull[x_storage_options_natts];
+    if (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        heap_deform_tuple(tuple, desc, values, isnull);
+        options.compression = TextDatumGetCString(values[1]);
+        options.has_compression_level = !isnull[2];
+        options.compression_level = isnull[2] ? 0 : DatumGetInt32(values[2]);
+        options.dictionary_compression_ratio_threshold = DatumGetFloat8(values[3]);
+        options.row_group_size = DatumGetInt64(values[4]);
+        options.row_group_size_bytes = DatumGetInt64(values[5]);
+        options.file_size_bytes = DatumGetInt64(values[6]);
+        Datum *sort_by;
+        bool *sort_by_isnull;
+        int num_sort_keys;
+        DatumGetArray(values[7], TEXTOID, &sort_by, &sort_by_isnull, &num_sort_keys);
+        for (int i = 0; i < num_sort_keys; i++) {
+            options.sort_by.push_back(TextDatumGetCString(sort_by[i]));
+        }
+        options.zorder = DatumGetBool(values[8]);
+        Datum *partition_by;
+        bool *partition_by_isnull;
+        int num_partition_keys;
+        DatumGetArray(values[9], TEXTOID, &partition_by, &partition_by_isnull, &num_partition_keys);
+        for (int i = 0; i < num_partition_keys; i++) {
+            options.partition_by.push_back(TextDatumGetCString(partition_by[i]));
+        }
+        options.checkpoint_interval = DatumGetInt32(values[10]);
+        options.log_retention_secs = DatumGetInt64(values[11]);
+        options.lake_format = TextDatumGetCString(values[12]);
+    }
+
+    systable_endscan_ordered(scan);
+    index_close(index, AccessShareLock);
+    table_close(table, AccessShareLock);
+    return options;
+}
+
+void ColumnstoreMetadata::LakeOutboxInsert(Oid oid, const LakeFileAction &action) {
+    ::Relation table = table_open(LakeOutbox(), RowExclusiveLock);
+    TupleDesc desc = RelationGetDescr(table);
+    Datum values[x_lake_outbox_natts] = {oid,
+                                         CStringGetTextDatum(action.file_name.c_str()),
+                                         BoolGetDatum(action.is_add_file),
+                                         Int64GetDatum(action.file_size),
+                                         CStringGetTextDatum(action.partition_values.c_str()),
+                                         CStringGetTextDatum(action.stats.c_str())};
+    bool nulls[x_lake_outbox_natts] = {false, false, false, false, false, false};
+    HeapTuple tuple = heap_form_tuple(desc, values, nulls);
+    PostgresFunctionGuard(CatalogTupleInsert, table, tuple);
+    CommandCounterIncrement();
+    table_close(table, RowExclusiveLock);
+}
+
+// Deletes the rows of the given actions only, rows inserted since they were read stay. A data file is added and
+// removed at most once, so file name and kind identify a row.
+void ColumnstoreMetadata::LakeOutboxDelete(Oid oid, const vector<LakeFileAction> &actions) {
+    unordered_set<string> added_files;
+    unordered_set<string> removed_files;
+    for (auto &action : actions) {
+        (action.is_add_file ? added_files : removed_files).insert(action.file_name);
+    }
+    ::Relation table = table_open(LakeOutbox(), RowExclusiveLock);
+    ::Relation index = index_open(LakeOutboxOid(), RowExclusiveLock);
+    TupleDesc desc = RelationGetDescr(table);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    HeapTuple tuple;
+    Datum values[x_lake_outbox_natts];
+    bool isnull[x_lake_outbox_natts];
+    while (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        heap_deform_tuple(tuple, desc, values, isnull);
+        auto &files = DatumGetBool(values[2]) ? added_files : removed_files;
+        if (files.count(TextDatumGetCString(values[1]))) {
+            PostgresFunctionGuard(CatalogTupleDelete, table, &tuple->t_self);
+        }
+    }
+
+    systable_endscan_ordered(scan);
+    CommandCounterIncrement();
+    index_close(index, RowExclusiveLock);
+    table_close(table, RowExclusiveLock);
+}
+
+vector<LakeFileAction> ColumnstoreMetadata::LakeOutboxSearch(Oid oid) {
+    ::Relation table = table_open(LakeOutbox(), AccessShareLock);
+    ::Relation index = index_open(LakeOutboxOid(), AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    ScanKeyData key[1];
+    ScanKeyInit(&key[0], 1 /*attributeNumber*/, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(oid));
+    SysScanDesc scan = systable_beginscan_ordered(table, index, snapshot, 1 /*nkeys*/, key);
+
+    vector<LakeFileAction> actions;
+    HeapTuple tuple;
+    Datum values[x_lake_outbox_natts];
+    bool isnull[x_lake_outbox_natts];
+    while (HeapTupleIsValid(tuple = systable_getnext_ordered(scan, ForwardScanDirection))) {
+        heap_deform_tuple(tuple, desc, values, isnull);
+        actions.push_back({TextDatumGetCString(values[1]), DatumGetBool(values[2]), DatumGetInt64(values[3]),
+                           TextDatumGetCString(values[4]), TextDatumGetCString(values[5])});
+    }
+
+    systable_endscan_ordered(scan);
+    index_close(index, AccessShareLock);
+    table_close(table, AccessShareLock);
+    return actions;
+}
+
+// Tables with actions in the outbox
+vector<Oid> ColumnstoreMetadata::LakeOutboxSearch() {
+    ::Relation table = table_open(LakeOutbox(), AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    SysScanDescData *scan =
+        systable_beginscan(table, InvalidOid /*indexId*/, false /*indexOK*/, snapshot, 0 /*nkeys*/, NULL /*key*/);
+
+    unordered_set<Oid> oids;
+    HeapTuple tuple;
+    Datum values[x_lake_outbox_natts];
+    bool isnull[x_lake_outbox_natts];
+    while (HeapTupleIsValid(tuple = systable_getnext(scan))) {
+        heap_deform_tuple(tuple, desc, values, isnull);
+        oids.insert(DatumGetObjectId(values[0]));
+    }
+
+    systable_endscan(scan);
+    table_close(table, AccessShareLock);
+    return vector<Oid>(oids.begin(), oids.end());
+}
+
+// Serializes commits of a table's outbox to the lake, held until the end of the transaction. It is a lock on the table
+// as an object rather than as a relation, so neither writers nor flushes of the write buffer wait for it. The catalog
+// snapshot is dropped, so that actions another backend committed to the lake while we waited are no longer seen.
+void ColumnstoreMetadata::LakeOutboxLock(Oid oid) {
+    LockDatabaseObject(RelationRelationId, oid, 0 /*objsubid*/, ExclusiveLock);
+    InvalidateCatalogSnapshot();
+}
+
+// Compaction rewrites files that DELETE and UPDATE may also be rewriting, so it excludes writers (but not readers)
+// until the end of the transaction
+bool ColumnstoreMetadata::CompactionTryLock(Oid oid, bool wait) {
+    if (wait) {
+        LockRelationOid(oid, ExclusiveLock);
+        return true;
+    }
+    return ConditionalLockRelationOid(oid, ExclusiveLock);
 }
 
 vector<string> ColumnstoreMetadata::SecretsGetDuckdbQueries() {
@@ -1,10 +1,77 @@
 #pragma once
 
 #include "duckdb/common/vector.hpp"
+#include "duckdb/storage/storage_info.hpp"
 #include "pgduckdb/pg/declarations.hpp"
 
 namespace duckdb {
 
+struct ColumnstoreColumnStats {
+    string column_name;
+    // -1 if unknown, as for nested columns of files made by CopyRowGroups
+    int64_t null_count;
+    // Unset if the column holds no values or its type keeps no min/max
+    bool has_min_max;
+    string min_value;
+    string max_value;
+};
+
+struct ColumnstoreDataFile {
+    string file_name;
+    int64_t file_size;
+    int64_t row_count;
+    vector<ColumnstoreColumnStats> column_stats;
+    // Sorted file row numbers deleted without rewriting the file
+    vector<uint32_t> deleted_rows;
+};
+
+struct BufferedFile {
+    string file_name;
+    int64_t row_count;
+    int64_t file_size;
+    int64_t age_secs;
+};
+
+// Add or Remove of a data file that has yet to be committed to the lake
+struct LakeFileAction {
+    string file_name;
+    bool is_add_file;
+    // Only set for adds, partition_values and stats are JSON objects
+    int64_t file_size;
+    string partition_values;
+    string stats;
+};
+
+// How ColumnstoreWriter lays out the data files of a table, set by CREATE TABLE ... USING columnstore WITH (...). The
+// names follow the options of DuckDB's COPY TO (FORMAT PARQUET).
+struct ColumnstoreStorageOptions {
+    // One of uncompressed, snappy, gzip, zstd, brotli or lz4
+    string compression = "snappy";
+    // Only zstd takes a level, unset uses its default level
+    bool has_compression_level = false;
+    int32_t compression_level = 0;
+    // Minimum ratio a dictionary must shrink a column chunk by to be used, -1 disables dictionary encoding
+    double dictionary_compression_ratio_threshold = 1.0;
+    // A row group is flushed once it reaches either size
+    int64_t row_group_size = Storage::ROW_GROUP_SIZE;
+    int64_t row_group_size_bytes = Storage::ROW_GROUP_SIZE * 1024;
+    // A data file is closed once it reaches this size, checked after each row group
+    int64_t file_size_bytes = 1 << 30;
+    // Columns the rows of each data file are sorted by, so that their min/max prune well. With zorder they are sorted
+    // along a Z-order curve over these columns instead, which keeps min/max of each of them tight.
+    vector<string> sort_by;
+    bool zorder = false;
+    // Columns whose values split data files into Hive-style directories, <column>=<value>/ under the table path
+    vector<string> partition_by;
+    // The lake table gets a checkpoint every this many commits, and log entries older than the retention (and covered
+    // by a checkpoint) are removed. Iceberg tables have no checkpoints, their snapshots expire after the retention.
+    int32_t checkpoint_interval = 10;
+    int64_t log_retention_secs = 30 * 24 * 3600;
+    // Metadata the lake table is written with, delta or iceberg. With none the table has no lake table, only
+    // pg_mooncake reads its data files.
+    string lake_format = "delta";
+};
+
 class ColumnstoreMetadata {
 public:
     explicit ColumnstoreMetadata(Snapshot snapshot) : snapshot(snapshot) {}
@@ -13,15 +80,39 @@ public:
     void TablesInsert(Oid oid, const string &path);
     void TablesDelete(Oid oid);
     string TablesSearch(Oid oid);
+    vector<Oid> TablesSearch();
 
     string GetTablePath(Oid oid);
     void GetTableMetadata(Oid oid, string &table_name /*out*/, vector<string> &column_names /*out*/,
                           vector<string> &column_types /*out*/);
 
-    void DataFilesInsert(Oid oid, const string &file_name);
+    void DataFilesInsert(Oid oid, const ColumnstoreDataFile &data_file);
     void DataFilesDelete(const string &file_name);
     void DataFilesDelete(Oid oid);
-    vector<string> DataFilesSearch(Oid oid);
+    vector<ColumnstoreDataFile> DataFilesSearch(Oid oid);
+
+    void DeletionVectorsInsert(Oid oid, const string &file_name, const vector<uint32_t> &deleted_rows);
+    void DeletionVectorsDelete(const string &file_name);
+    void DeletionVectorsDelete(Oid oid);
+
+    void BufferedFilesInsert(Oid oid, const string &file_name, int64_t row_count, const string &content);
+    void BufferedFilesDelete(const string &file_name);
+    void BufferedFilesDelete(Oid oid);
+    vector<BufferedFile> BufferedFilesSearch(Oid oid);
+    string BufferedFilesGetContent(const string &file_name);
+    bool BufferedFilesTryLock(Oid oid);
+
+    void CompactionPoliciesSearch(Oid oid, int64_t &target_file_size /*out*/, int64_t &min_file_count /*out*/);
+    bool CompactionTryLock(Oid oid, bool wait);
+
+    void StorageOptionsInsert(Oid oid, const ColumnstoreStorageOptions &options);
+    ColumnstoreStorageOptions StorageOptionsSearch(Oid oid);
+
+    void LakeOutboxInsert(Oid oid, const LakeFileAction &action);
+    void LakeOutboxDelete(Oid oid, const vector<LakeFileAction> &actions);
+    vector<LakeFileAction> LakeOutboxSearch(Oid oid);
+    vector<Oid> LakeOutboxSearch();
+    void LakeOutboxLock(Oid oid);
 
     vector<string> SecretsGetDuckdbQueries();
     string SecretsSearchDeltaOptions(const string &path);
@@ -0,0 +1,92 @@
+#include "columnstore/columnstore_reader.hpp"
+#include "columnstore/columnstore_cache.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "parquet_reader.hpp"
+#include "pgmooncake_guc.hpp"
+
+namespace duckdb {
+
+vector<string> GetDataFilePaths(const string &path, const vector<string> &file_names) {
+    bool use_cache = mooncake_enable_local_cache && FileSystem::IsRemoteFile(path);
+    bool read_through = use_cache && ColumnstoreCache::IsShared();
+    auto local_fs = FileSystem::CreateLocal();
+    vector<string> file_paths;
+    for (auto &file_name : file_names) {
+        // Cached under their UUID name, whatever partition they are in
+        string cached_file_path = x_mooncake_local_cache + file_name.substr(file_name.rfind('/') + 1);
+        if (read_through) {
+            file_paths.push_back(ColumnstoreCacheFileSystem::GetReadThroughPath(path + file_name));
+        } else if (use_cache && local_fs->FileExists(cached_file_path)) {
+            file_paths.push_back(cached_file_path);
+        } else {
+            file_paths.push_back(path + file_name);
+        }
+    }
+    return file_paths;
+}
+
+unique_ptr<ParquetReader> OpenDataFile(ClientContext &context, const string &file_path) {
+    ParquetOptions parquet_options;
+    auto reader = make_uniq<ParquetReader>(context, file_path, parquet_options, nullptr /*metadata*/);
+    for (idx_t i = 0; i < reader->GetTypes().size(); i++) {
+        reader->reader_data.column_mapping.push_back(i);
+        reader->reader_data.column_ids.push_back(i);
+    }
+    return reader;
+}
+
+void ScanRowGroups(ClientContext &context, ParquetReader &reader, const vector<idx_t> &row_groups,
+                   const vector<uint32_t> &deleted_rows, const std::function<void(DataChunk &)> &callback) {
+    auto &file_row_groups = reader.GetFileMetadata()->row_groups;
+    vector<uint32_t> first_file_row_numbers;
+    uint32_t num_rows = 0;
+    for (auto &row_group : file_row_groups) {
+        first_file_row_numbers.push_back(num_rows);
+        num_rows += NumericCast<uint32_t>(row_group.num_rows);
+    }
+
+    DataChunk chunk;
+    chunk.Initialize(context, reader.GetTypes());
+    SelectionVector sel(STANDARD_VECTOR_SIZE);
+    for (idx_t row_group : row_groups) {
+        // Row groups are scanned one at a time to know the file row number of every row
+        ParquetReaderScanState state;
+        reader.InitializeScan(context, state, {row_group});
+        uint32_t file_row_number = first_file_row_numbers[row_group];
+        auto it = std::lower_bound(deleted_rows.begin(), deleted_rows.end(), file_row_number);
+        chunk.Reset();
+        reader.Scan(state, chunk);
+        while (chunk.size()) {
+            idx_t sel_size = 0;
+            for (idx_t i = 0; i < chunk.size(); i++, file_row_number++) {
+                if (it != deleted_rows.end() && *it == file_row_number) {
+                    it++;
+                } else {
+                    sel.set_index(sel_size++, i);
+                }
+            }
+            if (sel_size < chunk.size()) {
+                chunk.Slice(sel, sel_size);
+            }
+            if (chunk.size()) {
+                callback(chunk);
+            }
+            chunk.Reset();
+            reader.Scan(state, chunk);
+        }
+    }
+}
+
+void ScanDataFile(ClientContext &context, const string &file_path, const std::function<void(DataChunk &)> &callback) {
+    ScanDataFile(context, file_path, {} /*deleted_rows*/, callback);
+}
+
+void ScanDataFile(ClientContext &context, const string &file_path, const vector<uint32_t> &deleted_rows,
+                  const std::function<void(DataChunk &)> &callback) {
+    auto reader = OpenDataFile(context, file_path);
+    vector<idx_t> row_groups(reader->GetFileMetadata()->row_groups.size());
+    std::iota(row_groups.begin(), row_groups.end(), 0);
+    ScanRowGroups(context, *reader, row_groups, deleted_rows, callback);
+}
+
+} // namespace duckdb
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "duckdb/common/types.hpp"
+#include "duckdb/common/unique_ptr.hpp"
+
+namespace duckdb {
+
+class ClientContext;
+class DataChunk;
+class ParquetReader;
+
+// Data files are read through the local cache (see ColumnstoreCache), otherwise from path
+vector<string> GetDataFilePaths(const string &path, const vector<string> &file_names);
+
+// Opens a data file for reading every column
+unique_ptr<ParquetReader> OpenDataFile(ClientContext &context, const string &file_path);
+
+// Scans every column of the given row groups of a data file, skipping the rows listed in deleted_rows (sorted file row
+// numbers)
+void ScanRowGroups(ClientContext &context, ParquetReader &reader, const vector<idx_t> &row_groups,
+                   const vector<uint32_t> &deleted_rows, const std::function<void(DataChunk &)> &callback);
+
+// Scans every column of every row group in a data file
+void ScanDataFile(ClientContext &context, const string &file_path, const std::function<void(DataChunk &)> &callback);
+
+// Same, but skips the rows listed in deleted_rows
+void ScanDataFile(ClientContext &context, const string &file_path, const vector<uint32_t> &deleted_rows,
+                  const std::function<void(DataChunk &)> &callback);
+
+} // namespace duckdb
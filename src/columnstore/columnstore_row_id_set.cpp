@@ -0,0 +1,91 @@
+#include "columnstore/columnstore_row_id_set.hpp"
+#include "duckdb/common/bit_utils.hpp"
+
+namespace duckdb {
+
+namespace {
+
+constexpr idx_t x_block_size = 1 << 16;
+// Past this many entries an array takes more memory than a bitmap
+constexpr idx_t x_max_array_size = x_block_size / 16;
+
+} // namespace
+
+bool FileRowNumberSet::Block::Add(uint16_t value) {
+    if (!bitmap.empty()) {
+        uint64_t &word = bitmap[value >> 6];
+        uint64_t mask = uint64_t(1) << (value & 63);
+        if (word & mask) {
+            return false;
+        }
+        word |= mask;
+        return true;
+    }
+    // Scans produce row numbers in order, so this is almost always an append
+    if (array.empty() || array.back() < value) {
+        array.push_back(value);
+    } else {
+        auto it = std::lower_bound(array.begin(), array.end(), value);
+        if (*it == value) {
+            return false;
+        }
+        array.insert(it, value);
+    }
+    if (array.size() > x_max_array_size) {
+        bitmap.resize(x_block_size / 64);
+        for (uint16_t entry : array) {
+            bitmap[entry >> 6] |= uint64_t(1) << (entry & 63);
+        }
+        vector<uint16_t>().swap(array);
+    }
+    return true;
+}
+
+void FileRowNumberSet::Add(uint32_t file_row_number) {
+    if (blocks[file_row_number >> 16].Add(file_row_number & 0xFFFF)) {
+        count++;
+    }
+}
+
+void FileRowNumberSet::Merge(const FileRowNumberSet &other) {
+    for (uint32_t file_row_number : other.ToVector()) {
+        Add(file_row_number);
+    }
+}
+
+vector<uint32_t> FileRowNumberSet::ToVector() const {
+    vector<uint32_t> result;
+    result.reserve(count);
+    for (auto &entry : blocks) {
+        uint32_t high = uint32_t(entry.first) << 16;
+        auto &block = entry.second;
+        if (block.bitmap.empty()) {
+            for (uint16_t value : block.array) {
+                result.push_back(high | value);
+            }
+            continue;
+        }
+        for (idx_t i = 0; i < block.bitmap.size(); i++) {
+            uint64_t word = block.bitmap[i];
+            while (word) {
+                result.push_back(high | uint32_t(i * 64 + CountZeros<uint64_t>::Trailing(word)));
+                word &= word - 1;
+            }
+        }
+    }
+    return result;
+}
+
+void RowIdSet::Merge(RowIdSet &&other) {
+    for (auto &entry : other.files) {
+        auto it = files.find(entry.first);
+        if (it == files.end()) {
+            files.emplace(entry.first, std::move(entry.second));
+        } else {
+            it->second.Merge(entry.second);
+        }
+    }
+    other.files.clear();
+}
+
+} // namespace duckdb
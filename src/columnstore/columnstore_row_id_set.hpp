@@ -0,0 +1,51 @@
+#pragma once
+
+#include "duckdb/common/map.hpp"
+#include "duckdb/common/types.hpp"
+
+namespace duckdb {
+
+// Set of row numbers of a single data file. Row numbers are split into blocks of 2^16, each stored as a sorted array
+// while sparse and as a bitmap once dense, so memory stays proportional to the number of rows in compressed form.
+class FileRowNumberSet {
+public:
+    void Add(uint32_t file_row_number);
+
+    void Merge(const FileRowNumberSet &other);
+
+    idx_t Count() const {
+        return count;
+    }
+
+    // Sorted file row numbers
+    vector<uint32_t> ToVector() const;
+
+private:
+    struct Block {
+        vector<uint16_t> array;
+        // Empty while the block is stored as an array
+        vector<uint64_t> bitmap;
+
+        bool Add(uint16_t value);
+    };
+
+private:
+    map<uint16_t, Block> blocks;
+    idx_t count = 0;
+};
+
+// Row ids collected by DELETE and UPDATE, grouped by file number. No sorting is needed since both the files and the
+// row numbers in them are kept in order.
+class RowIdSet {
+public:
+    void Add(row_t row_id) {
+        files[NumericCast<idx_t>(row_id >> 32)].Add(NumericCast<uint32_t>(row_id & 0xFFFFFFFF));
+    }
+
+    void Merge(RowIdSet &&other);
+
+public:
+    map<idx_t, FileRowNumberSet> files;
+};
+
+} // namespace duckdb
@@ -0,0 +1,177 @@
+#include "columnstore/columnstore_statistics.hpp"
+#include "duckdb/planner/filter/conjunction_filter.hpp"
+#include "duckdb/planner/filter/constant_filter.hpp"
+#include "duckdb/planner/table_filter.hpp"
+
+namespace duckdb {
+
+unique_ptr<BaseStatistics> GetColumnStatistics(const ColumnstoreColumnStats &column_stats, const LogicalType &type) {
+    if (!column_stats.has_min_max) {
+        return nullptr;
+    }
+    auto stats = BaseStatistics::CreateEmpty(type);
+    if (stats.GetStatsType() == StatisticsType::NUMERIC_STATS) {
+        Value min_value;
+        Value max_value;
+        if (!Value(column_stats.min_value).DefaultTryCastAs(type, min_value, nullptr /*error_message*/) ||
+            !Value(column_stats.max_value).DefaultTryCastAs(type, max_value, nullptr /*error_message*/)) {
+            return nullptr;
+        }
+        NumericStats::SetMin(stats, min_value);
+        NumericStats::SetMax(stats, max_value);
+    } else if (type.id() == LogicalTypeId::VARCHAR) {
+        StringStats::Update(stats, string_t(column_stats.min_value));
+        StringStats::Update(stats, string_t(column_stats.max_value));
+    } else {
+        return nullptr;
+    }
+    if (column_stats.null_count == 0) {
+        stats.Set(StatsInfo::CANNOT_HAVE_NULL_VALUES);
+        stats.Set(StatsInfo::CAN_HAVE_VALID_VALUES);
+    } else {
+        stats.Set(StatsInfo::CAN_HAVE_NULL_AND_VALID_VALUES);
+    }
+    return stats.ToUnique();
+}
+
+namespace {
+
+const ColumnstoreColumnStats *FindColumnStats(const vector<ColumnstoreColumnStats> &column_stats,
+                                              const string &column_name) {
+    auto it = std::find_if(column_stats.begin(), column_stats.end(),
+                           [&](const ColumnstoreColumnStats &stats) { return stats.column_name == column_name; });
+    return it != column_stats.end() ? &*it : nullptr;
+}
+
+const Value *FindPartitionValue(const vector<std::pair<string, Value>> &partition_values, const string &column_name) {
+    auto it = std::find_if(partition_values.begin(), partition_values.end(),
+                           [&](const std::pair<string, Value> &entry) { return entry.first == column_name; });
+    return it != partition_values.end() ? &it->second : nullptr;
+}
+
+// Checks a filter against the one value a partition column has in a data file. Unlike its stats, the value is exact,
+// NULLs included.
+FilterPropagateResult CheckPartitionValue(const TableFilter &filter, const Value &value) {
+    switch (filter.filter_type) {
+    case TableFilterType::CONSTANT_COMPARISON: {
+        if (value.IsNull()) {
+            return FilterPropagateResult::FILTER_ALWAYS_FALSE;
+        }
+        auto &constant_filter = filter.Cast<ConstantFilter>();
+        Value constant_value;
+        if (!value.DefaultTryCastAs(constant_filter.constant.type(), constant_value, nullptr /*error_message*/)) {
+            return FilterPropagateResult::NO_PRUNING_POSSIBLE;
+        }
+        bool result;
+        switch (constant_filter.comparison_type) {
+        case ExpressionType::COMPARE_EQUAL:
+            result = constant_value == constant_filter.constant;
+            break;
+        case ExpressionType::COMPARE_NOTEQUAL:
+            result = constant_value != constant_filter.constant;
+            break;
+        case ExpressionType::COMPARE_LESSTHAN:
+            result = constant_value < constant_filter.constant;
+            break;
+        case ExpressionType::COMPARE_LESSTHANOREQUALTO:
+            result = constant_value <= constant_filter.constant;
+            break;
+        case ExpressionType::COMPARE_GREATERTHAN:
+            result = constant_value > constant_filter.constant;
+            break;
+        case ExpressionType::COMPARE_GREATERTHANOREQUALTO:
+            result = constant_value >= constant_filter.constant;
+            break;
+        default:
+            return FilterPropagateResult::NO_PRUNING_POSSIBLE;
+        }
+        return result ? FilterPropagateResult::FILTER_ALWAYS_TRUE : FilterPropagateResult::FILTER_ALWAYS_FALSE;
+    }
+    case TableFilterType::IS_NULL:
+        return value.IsNull() ? FilterPropagateResult::FILTER_ALWAYS_TRUE : FilterPropagateResult::FILTER_ALWAYS_FALSE;
+    case TableFilterType::IS_NOT_NULL:
+        return value.IsNull() ? FilterPropagateResult::FILTER_ALWAYS_FALSE : FilterPropagateResult::FILTER_ALWAYS_TRUE;
+    case TableFilterType::CONJUNCTION_AND:
+    case TableFilterType::CONJUNCTION_OR: {
+        // AND is decided by a child that is always false, OR by one that is always true
+        bool is_and = filter.filter_type == TableFilterType::CONJUNCTION_AND;
+        auto decisive = is_and ? FilterPropagateResult::FILTER_ALWAYS_FALSE : FilterPropagateResult::FILTER_ALWAYS_TRUE;
+        auto result = is_and ? FilterPropagateResult::FILTER_ALWAYS_TRUE : FilterPropagateResult::FILTER_ALWAYS_FALSE;
+        auto &child_filters = is_and ? filter.Cast<ConjunctionAndFilter>().child_filters
+                                     : filter.Cast<ConjunctionOrFilter>().child_filters;
+        for (auto &child_filter : child_filters) {
+            auto child_result = CheckPartitionValue(*child_filter, value);
+            if (child_result == decisive) {
+                return decisive;
+            }
+            if (child_result != result) {
+                result = FilterPropagateResult::NO_PRUNING_POSSIBLE;
+            }
+        }
+        return result;
+    }
+    default:
+        return FilterPropagateResult::NO_PRUNING_POSSIBLE;
+    }
+}
+
+} // namespace
+
+bool DataFileMayMatch(const vector<ColumnstoreColumnStats> &column_stats,
+                      const vector<std::pair<string, Value>> &partition_values, const vector<string> &names,
+                      const vector<LogicalType> &types, const vector<column_t> &column_ids, TableFilterSet &filters) {
+    for (auto &entry : filters.filters) {
+        if (entry.first >= column_ids.size() || IsRowIdColumnId(column_ids[entry.first])) {
+            continue;
+        }
+        auto column_id = column_ids[entry.first];
+        auto partition_value = FindPartitionValue(partition_values, names[column_id]);
+        if (partition_value) {
+            if (CheckPartitionValue(*entry.second, *partition_value) == FilterPropagateResult::FILTER_ALWAYS_FALSE) {
+                return false;
+            }
+            continue;
+        }
+        auto stats = FindColumnStats(column_stats, names[column_id]);
+        if (!stats) {
+            continue;
+        }
+        auto statistics = GetColumnStatistics(*stats, types[column_id]);
+        if (statistics &&
+            entry.second->CheckStatistics(*statistics) == FilterPropagateResult::FILTER_ALWAYS_FALSE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The min/max of a column only guarantee a filter holds for every row when the column has no NULLs
+bool DataFileIsCovered(const vector<ColumnstoreColumnStats> &column_stats,
+                       const vector<std::pair<string, Value>> &partition_values, const vector<string> &names,
+                       const vector<LogicalType> &types, const vector<column_t> &column_ids, TableFilterSet &filters) {
+    for (auto &entry : filters.filters) {
+        if (entry.first >= column_ids.size() || IsRowIdColumnId(column_ids[entry.first])) {
+            return false;
+        }
+        auto column_id = column_ids[entry.first];
+        auto partition_value = FindPartitionValue(partition_values, names[column_id]);
+        if (partition_value) {
+            if (CheckPartitionValue(*entry.second, *partition_value) != FilterPropagateResult::FILTER_ALWAYS_TRUE) {
+                return false;
+            }
+            continue;
+        }
+        auto stats = FindColumnStats(column_stats, names[column_id]);
+        if (!stats || stats->null_count != 0) {
+            return false;
+        }
+        auto statistics = GetColumnStatistics(*stats, types[column_id]);
+        if (!statistics ||
+            entry.second->CheckStatistics(*statistics) != FilterPropagateResult::FILTER_ALWAYS_TRUE) {
+            return false;
+        }
+    }
+    return !filters.filters.empty();
+}
+
+} // namespace duckdb
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "columnstore/columnstore_metadata.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/storage/statistics/base_statistics.hpp"
+
+namespace duckdb {
+
+class TableFilterSet;
+
+// Attached to the columnstore_scan function, so the optimizer can answer queries from the catalog alone
+struct ColumnstoreScanInfo : public TableFunctionInfo {
+    ColumnstoreScanInfo(vector<ColumnstoreDataFile> data_files, int64_t buffered_row_count, bool has_buffered_files)
+        : data_files(std::move(data_files)), buffered_row_count(buffered_row_count),
+          has_buffered_files(has_buffered_files) {}
+
+    vector<ColumnstoreDataFile> data_files;
+    int64_t buffered_row_count;
+    // Buffered files have no column stats
+    bool has_buffered_files;
+};
+
+// DuckDB statistics of a column of a data file, nullptr if its min/max is unknown
+unique_ptr<BaseStatistics> GetColumnStatistics(const ColumnstoreColumnStats &column_stats, const LogicalType &type);
+
+// Whether some row of a data file may match filters going by its column stats, and by its partition values (see
+// GetPartitionValues) for partition columns. Filters are keyed by index into column_ids, names and types by column id.
+bool DataFileMayMatch(const vector<ColumnstoreColumnStats> &column_stats,
+                      const vector<std::pair<string, Value>> &partition_values, const vector<string> &names,
+                      const vector<LogicalType> &types, const vector<column_t> &column_ids, TableFilterSet &filters);
+
+// Whether every row of a data file matches filters going by its column stats and partition values
+bool DataFileIsCovered(const vector<ColumnstoreColumnStats> &column_stats,
+                       const vector<std::pair<string, Value>> &partition_values, const vector<string> &names,
+                       const vector<LogicalType> &types, const vector<column_t> &column_ids, TableFilterSet &filters);
+
+} // namespace duckdb
@@ -1,147 +1,131 @@
 #include "columnstore/columnstore_table.hpp"
+#include "columnstore/columnstore_cache.hpp"
 #include "columnstore/columnstore_metadata.hpp"
+#include "columnstore/columnstore_reader.hpp"
+#include "columnstore/columnstore_row_id_set.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "duckdb/common/types/column/column_data_collection.hpp"
 #include "duckdb/common/types/uuid.hpp"
+#include "duckdb/parallel/task_executor.hpp"
 #include "lake/lake.hpp"
 #include "parquet_reader.hpp"
-#include "parquet_writer.hpp"
 #include "pgmooncake_guc.hpp"
 
 namespace duckdb {
 
-const char *x_mooncake_local_cache = "mooncake_local_cache/";
+namespace {
 
-class SingleFileCachedWriteFileSystem : public FileSystem {
-public:
-    SingleFileCachedWriteFileSystem(ClientContext &context, const string &file_name)
-        : fs(GetFileSystem(context)), cached_file_path(x_mooncake_local_cache + file_name), file_size(0) {}
-
-public:
-    unique_ptr<FileHandle> OpenFile(const string &path, FileOpenFlags flags,
-                                    optional_ptr<FileOpener> opener = nullptr) override {
-        if (IsRemoteFile(path) && mooncake_enable_local_cache) {
-            auto disk_space = fs.GetAvailableDiskSpace(x_mooncake_local_cache);
-            if (disk_space.IsValid() && disk_space.GetIndex() > x_min_disk_space) {
-                cached_file = fs.OpenFile(cached_file_path, flags, opener);
-            }
-        }
-        return fs.OpenFile(path, flags, opener);
-    }
-
-    int64_t Write(FileHandle &handle, void *buffer, int64_t nr_bytes) override {
-        file_size += nr_bytes;
-        if (cached_file) {
-            int64_t bytes_written = fs.Write(*cached_file, buffer, nr_bytes);
-            D_ASSERT(bytes_written == nr_bytes);
-        }
-        return fs.Write(handle, buffer, nr_bytes);
-    }
-
-    string GetName() const override {
-        return "SingleFileCachedWriteFileSystem";
-    }
-
-    idx_t GetFileSize() const {
-        return file_size;
-    }
-
-private:
-    static const idx_t x_min_disk_space = 1024 * 1024 * 1024;
-
-    FileSystem &fs;
-    string cached_file_path;
-    unique_ptr<FileHandle> cached_file;
-    idx_t file_size;
-};
-
-class DataFileWriter {
-public:
-    DataFileWriter(ClientContext &context, FileSystem &fs, string file_name, vector<LogicalType> types,
-                   vector<string> names, ChildFieldIDs field_ids)
-        : collection(context, types, ColumnDataAllocatorType::HYBRID),
-          writer(context, fs, std::move(file_name), std::move(types), std::move(names),
-                 duckdb_parquet::format::CompressionCodec::SNAPPY /*codec*/, std::move(field_ids), {} /*kv_metadata*/,
-                 {} /*encryption_config*/, 1.0 /*dictionary_compression_ratio_threshold*/, {} /*compression_level*/,
-                 true /*debug_use_openssl*/) {
-        collection.InitializeAppend(append_state);
+// Buffered files are served from the local cache, which is rebuilt from the catalog when missing (e.g. after a
+// restart or on a replica)
+string GetBufferedFilePath(ColumnstoreMetadata &metadata, const string &file_name) {
+    string file_path = x_mooncake_local_cache + file_name;
+    auto local_fs = FileSystem::CreateLocal();
+    if (!local_fs->FileExists(file_path)) {
+        string content = metadata.BufferedFilesGetContent(file_name);
+        string temp_file_path = file_path + "." + UUID::ToString(UUID::GenerateRandomUUID());
+        auto handle =
+            local_fs->OpenFile(temp_file_path, FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_FILE_CREATE_NEW);
+        handle->Write(const_cast<char *>(content.data()), content.size());
+        handle->Sync();
+        handle->Close();
+        local_fs->MoveFile(temp_file_path, file_path);
     }
+    return file_path;
+}
 
-public:
-    // Return true if needs to rotate to a new data file
-    bool Write(DataChunk &chunk) {
-        collection.Append(append_state, chunk);
-        if (collection.Count() >= x_row_group_size || collection.SizeInBytes() >= x_row_group_size_bytes) {
-            writer.Flush(collection);
-            append_state.current_chunk_state.handles.clear();
-            collection.InitializeAppend(append_state);
-            return writer.FileSize() >= x_file_size_bytes;
-        }
-        return false;
-    }
+// The local copy goes along with the catalog row. Should the transaction abort, GetBufferedFilePath restores it.
+void DeleteBufferedFile(ColumnstoreMetadata &metadata, const string &file_name) {
+    metadata.BufferedFilesDelete(file_name);
+    ColumnstoreCache::Remove(file_name);
+    std::remove((x_mooncake_local_cache + file_name).c_str());
+}
 
-    void Finalize() {
-        writer.Flush(collection);
-        writer.Finalize();
+void WriteCollection(ClientContext &context, ColumnDataCollection &collection, ColumnstoreWriter &writer) {
+    ColumnDataScanState scan_state;
+    collection.InitializeScan(scan_state);
+    DataChunk chunk;
+    collection.InitializeScanChunk(chunk);
+    while (collection.Scan(scan_state, chunk)) {
+        writer.Write(context, chunk);
     }
+}
 
-private:
-    static const idx_t x_row_group_size = duckdb::Storage::ROW_GROUP_SIZE;
-    static const idx_t x_row_group_size_bytes = x_row_group_size * 1024;
-    static const idx_t x_file_size_bytes = 1 << 30;
-
-    ColumnDataCollection collection;
-    ColumnDataAppendState append_state;
-    ParquetWriter writer;
+struct FileRewrite {
+    string file_path;
+    ColumnstoreDataFile data_file;
+    bool is_data_file;
+    // Expanded by the rewrite task, so only running rewrites hold their deleted rows uncompressed
+    FileRowNumberSet deleted_rows;
+    // Updated rows that came from this file
+    optional_ptr<ColumnDataCollection> new_rows;
+    vector<ColumnstoreDataFile> new_data_files;
 };
 
-class ColumnstoreWriter {
+// Writes the rows of a file that survive its deleted rows into new data files under path. Row groups without deleted
+// rows are copied byte for byte, only the others are decoded and their surviving rows re-encoded. Doesn't touch the
+// catalog, so files can be rewritten in parallel.
+class RewriteFileTask : public BaseExecutorTask {
 public:
-    ColumnstoreWriter(Oid oid, ColumnstoreMetadata &metadata, vector<LogicalType> types, vector<string> names)
-        : oid(oid), metadata(metadata), path(metadata.TablesSearch(oid)), types(std::move(types)),
-          names(std::move(names)) {}
+    RewriteFileTask(TaskExecutor &executor, ClientContext &context, const string &path,
+                    const vector<LogicalType> &types, const vector<string> &names,
+                    const ColumnstoreStorageOptions &options, FileRewrite &rewrite)
+        : BaseExecutorTask(executor), context(context), path(path), types(types), names(names), options(options),
+          rewrite(rewrite) {}
 
-public:
-    void Write(ClientContext &context, DataChunk &chunk) {
-        if (!writer) {
-            file_name = UUID::ToString(UUID::GenerateRandomUUID()) + ".parquet";
-            fs = make_uniq<SingleFileCachedWriteFileSystem>(context, file_name);
-            ChildFieldIDs field_ids;
-            for (idx_t i = 0; i < names.size(); i++) {
-                (*field_ids.ids)[names[i]] = duckdb::FieldID(i);
+    void ExecuteTask() override {
+        auto reader = OpenDataFile(context, rewrite.file_path);
+        vector<idx_t> copied_row_groups;
+        vector<idx_t> rewritten_row_groups;
+        uint32_t file_row_number = 0;
+        auto &row_groups = reader->GetFileMetadata()->row_groups;
+        auto deleted_rows = rewrite.deleted_rows.ToVector();
+        for (idx_t i = 0; i < row_groups.size(); i++) {
+            uint32_t next_file_row_number = file_row_number + NumericCast<uint32_t>(row_groups[i].num_rows);
+            auto it = std::lower_bound(deleted_rows.begin(), deleted_rows.end(), file_row_number);
+            if (it != deleted_rows.end() && *it < next_file_row_number) {
+                rewritten_row_groups.push_back(i);
+            } else {
+                copied_row_groups.push_back(i);
             }
-            writer = make_uniq<DataFileWriter>(context, *fs, path + file_name, types, names, std::move(field_ids));
+            file_row_number = next_file_row_number;
         }
-        if (writer->Write(chunk)) {
-            FinalizeDataFile();
+        // Buffered files are small, they are simply re-encoded whole
+        if (!rewrite.is_data_file) {
+            rewritten_row_groups.insert(rewritten_row_groups.end(), copied_row_groups.begin(),
+                                        copied_row_groups.end());
+            std::sort(rewritten_row_groups.begin(), rewritten_row_groups.end());
+            copied_row_groups.clear();
         }
-    }
-
-    void Finalize() {
-        if (writer) {
-            FinalizeDataFile();
+        if (!copied_row_groups.empty()) {
+            // Copied row groups stay in the partition of their file
+            string partition_directory = GetPartitionDirectory(rewrite.data_file.file_name);
+            auto data_file = CopyRowGroups(context, path + partition_directory, rewrite.file_path, *reader,
+                                           copied_row_groups, rewrite.data_file.column_stats);
+            data_file.file_name = partition_directory + data_file.file_name;
+            rewrite.new_data_files.push_back(std::move(data_file));
+        }
+        ColumnstoreWriter writer(path, types, names, options);
+        ScanRowGroups(context, *reader, rewritten_row_groups, deleted_rows,
+                      [&](DataChunk &chunk) { writer.Write(context, chunk); });
+        if (rewrite.new_rows) {
+            WriteCollection(context, *rewrite.new_rows, writer);
+        }
+        for (auto &data_file : writer.Finalize()) {
+            rewrite.new_data_files.push_back(std::move(data_file));
         }
     }
 
 private:
-    void FinalizeDataFile() {
-        writer->Finalize();
-        writer.reset();
-        idx_t file_size = fs->GetFileSize();
-        fs.reset();
-        metadata.DataFilesInsert(oid, file_name.c_str());
-        LakeAddFile(oid, file_name, file_size);
-    }
-
-private:
-    Oid oid;
-    ColumnstoreMetadata &metadata;
-    string path;
-    string file_name;
-    vector<LogicalType> types;
-    vector<string> names;
-    unique_ptr<SingleFileCachedWriteFileSystem> fs;
-    unique_ptr<DataFileWriter> writer;
+    ClientContext &context;
+    const string &path;
+    const vector<LogicalType> &types;
+    const vector<string> &names;
+    const ColumnstoreStorageOptions &options;
+    FileRewrite &rewrite;
 };
 
+} // namespace
+
 ColumnstoreTable::ColumnstoreTable(Catalog &catalog, SchemaCatalogEntry &schema, CreateTableInfo &info, Oid oid,
                                    Snapshot snapshot)
     : TableCatalogEntry(catalog, schema, info), oid(oid), metadata(make_uniq<ColumnstoreMetadata>(snapshot)) {}
@@ -159,89 +143,191 @@ TableStorageInfo ColumnstoreTable::GetStorageInfo(ClientContext &context) {
     return result;
 }
 
+string ColumnstoreTable::GetPath() {
+    return metadata->TablesSearch(oid);
+}
+
+ColumnstoreStorageOptions ColumnstoreTable::GetStorageOptions() {
+    return metadata->StorageOptionsSearch(oid);
+}
+
 void ColumnstoreTable::Insert(ClientContext &context, DataChunk &chunk) {
     if (!writer) {
-        writer = make_uniq<ColumnstoreWriter>(oid, *metadata, columns.GetColumnTypes(), columns.GetColumnNames());
+        writer = make_uniq<ColumnstoreWriter>(GetPath(), columns.GetColumnTypes(), columns.GetColumnNames(),
+                                              GetStorageOptions());
     }
     writer->Write(context, chunk);
 }
 
 void ColumnstoreTable::FinalizeInsert() {
     if (writer) {
-        writer->Finalize();
+        AddDataFiles(writer->Finalize());
         writer.reset();
     }
 }
 
-void ColumnstoreTable::Delete(ClientContext &context, vector<row_t> &row_ids) {
-    std::sort(row_ids.begin(), row_ids.end());
-    auto path = metadata->TablesSearch(oid);
-    auto file_names = metadata->DataFilesSearch(oid);
-    auto file_paths = GetFilePaths(path, file_names);
-
-    for (idx_t row_ids_index = 0; row_ids_index < row_ids.size();) {
-        int32_t file_number = row_ids[row_ids_index] >> 32;
-        uint32_t next_file_row_number = row_ids[row_ids_index] & 0xFFFFFFFF;
-        ParquetOptions parquet_options;
-        ParquetReader reader(context, file_paths[file_number], parquet_options, nullptr /*metadata*/);
-        for (idx_t i = 0; i < reader.GetTypes().size(); i++) {
-            reader.reader_data.column_mapping.push_back(i);
-            reader.reader_data.column_ids.push_back(i);
+void ColumnstoreTable::AddDataFiles(const vector<ColumnstoreDataFile> &data_files) {
+    for (auto &data_file : data_files) {
+        metadata->DataFilesInsert(oid, data_file);
+        LakeAddFile(oid, data_file);
+    }
+}
+
+void ColumnstoreTable::BufferInsert(ClientContext &context, ColumnDataCollection &collection) {
+    // Buffered files are partitioned once they are flushed
+    auto options = GetStorageOptions();
+    options.partition_by.clear();
+    ColumnstoreWriter buffer_writer(x_mooncake_local_cache, columns.GetColumnTypes(), columns.GetColumnNames(),
+                                    std::move(options));
+    WriteCollection(context, collection, buffer_writer);
+    auto local_fs = FileSystem::CreateLocal();
+    for (auto &data_file : buffer_writer.Finalize()) {
+        auto handle = local_fs->OpenFile(x_mooncake_local_cache + data_file.file_name, FileFlags::FILE_FLAGS_READ);
+        string content(NumericCast<idx_t>(data_file.file_size), '\0');
+        handle->Read(const_cast<char *>(content.data()), content.size());
+        metadata->BufferedFilesInsert(oid, data_file.file_name, data_file.row_count, content);
+    }
+    FlushBuffer(context, false /*force*/);
+}
+
+void ColumnstoreTable::FlushBuffer(ClientContext &context, bool force) {
+    // Inserts from this statement and flushes committed by other backends must be visible, so always read the write
+    // buffer with the latest snapshot
+    ColumnstoreMetadata latest_metadata(NULL /*snapshot*/);
+    auto buffered_files = latest_metadata.BufferedFilesSearch(oid);
+    if (buffered_files.empty()) {
+        return;
+    }
+    if (!force) {
+        int64_t row_count = 0;
+        int64_t file_size = 0;
+        int64_t age_secs = 0;
+        for (auto &buffered_file : buffered_files) {
+            row_count += buffered_file.row_count;
+            file_size += buffered_file.file_size;
+            age_secs = MaxValue(age_secs, buffered_file.age_secs);
         }
-        ParquetReaderScanState state;
-        vector<idx_t> groups_to_read(reader.GetFileMetadata()->row_groups.size());
-        std::iota(groups_to_read.begin(), groups_to_read.end(), 0);
-        reader.InitializeScan(context, state, std::move(groups_to_read));
-
-        DataChunk chunk;
-        chunk.Initialize(context, reader.GetTypes());
-        SelectionVector sel;
-        sel.Initialize(STANDARD_VECTOR_SIZE);
-        uint32_t file_row_number = 0;
-        reader.Scan(state, chunk);
-        while (chunk.size()) {
-            idx_t sel_size = 0;
-            for (idx_t chunk_row_number = 0; chunk_row_number < chunk.size(); chunk_row_number++, file_row_number++) {
-                if (file_row_number == next_file_row_number) {
-                    row_ids_index++;
-                    if (row_ids_index < row_ids.size() && row_ids[row_ids_index] >> 32 == file_number) {
-                        next_file_row_number = row_ids[row_ids_index] & 0xFFFFFFFF;
-                    }
-                } else {
-                    sel.set_index(sel_size++, chunk_row_number);
-                }
-            }
-            chunk.Slice(sel, sel_size);
-            if (chunk.size()) {
-                Insert(context, chunk);
-            }
-            chunk.Reset();
-            reader.Scan(state, chunk);
+        if (row_count < mooncake_write_buffer_flush_rows &&
+            file_size < int64_t(mooncake_write_buffer_flush_size) * 1024 &&
+            (mooncake_write_buffer_flush_interval == 0 || age_secs < mooncake_write_buffer_flush_interval)) {
+            return;
         }
-        metadata->DataFilesDelete(file_names[file_number]);
-        LakeDeleteFile(oid, file_names[file_number]);
+    }
+    // Some other backend is flushing this write buffer
+    if (!latest_metadata.BufferedFilesTryLock(oid)) {
+        return;
+    }
+    for (auto &buffered_file : latest_metadata.BufferedFilesSearch(oid)) {
+        ScanDataFile(context, GetBufferedFilePath(latest_metadata, buffered_file.file_name),
+                     [&](DataChunk &chunk) { Insert(context, chunk); });
+        DeleteBufferedFile(latest_metadata, buffered_file.file_name);
     }
     FinalizeInsert();
 }
 
-vector<string> ColumnstoreTable::GetFilePaths(const string &path, const vector<string> &file_names) {
+void ColumnstoreTable::Delete(ClientContext &context, RowIdSet &row_ids) {
+    unordered_map<idx_t, unique_ptr<ColumnDataCollection>> new_rows;
+    DeleteAndInsert(context, row_ids, new_rows);
+}
+
+void ColumnstoreTable::DeleteDataFiles(const vector<ColumnstoreDataFile> &data_files) {
+    for (auto &data_file : data_files) {
+        metadata->DataFilesDelete(data_file.file_name);
+        LakeDeleteFile(oid, data_file.file_name);
+    }
+}
+
+void ColumnstoreTable::Update(ClientContext &context, RowIdSet &row_ids,
+                              unordered_map<idx_t, unique_ptr<ColumnDataCollection>> &new_rows) {
+    DeleteAndInsert(context, row_ids, new_rows);
+}
+
+// Deletes of a small enough fraction of a data file's rows only extend its deletion vector, anything else rewrites the
+// surviving rows into new data files. Deletion vectors only live in the catalog, lake readers would still see the rows,
+// so tables with a lake table always rewrite. Rewrites run in parallel on DuckDB's task scheduler, the catalog and the
+// lake are only updated once all of them are done.
+void ColumnstoreTable::DeleteAndInsert(ClientContext &context, RowIdSet &row_ids,
+                                       unordered_map<idx_t, unique_ptr<ColumnDataCollection>> &new_rows) {
+    vector<ColumnstoreDataFile> data_files;
     vector<string> file_paths;
-    if (mooncake_enable_local_cache && FileSystem::IsRemoteFile(path)) {
-        auto local_fs = FileSystem::CreateLocal();
-        for (auto &file_name : file_names) {
-            string cached_file_path = x_mooncake_local_cache + file_name;
-            if (local_fs->FileExists(cached_file_path)) {
-                file_paths.push_back(cached_file_path);
-            } else {
-                file_paths.push_back(path + file_name);
+    idx_t num_data_files = GetFiles(data_files, file_paths);
+    auto options = GetStorageOptions();
+    double deletion_vector_threshold = options.lake_format == "none" ? mooncake_deletion_vector_threshold : 0;
+
+    vector<FileRewrite> rewrites;
+    for (auto &entry : row_ids.files) {
+        idx_t file_number = entry.first;
+        auto &data_file = data_files[file_number];
+        auto &deleted_rows = entry.second;
+        for (uint32_t file_row_number : data_file.deleted_rows) {
+            deleted_rows.Add(file_row_number);
+        }
+
+        bool is_data_file = file_number < num_data_files;
+        auto deleted_count = NumericCast<int64_t>(deleted_rows.Count());
+        auto it = new_rows.find(file_number);
+        optional_ptr<ColumnDataCollection> file_new_rows = it != new_rows.end() ? it->second.get() : nullptr;
+        if (deleted_count < data_file.row_count &&
+            (!is_data_file || deleted_count >= deletion_vector_threshold * double(data_file.row_count))) {
+            rewrites.push_back(
+                {file_paths[file_number], data_file, is_data_file, std::move(deleted_rows), file_new_rows, {}});
+            continue;
+        }
+        if (file_new_rows) {
+            if (!writer) {
+                writer = make_uniq<ColumnstoreWriter>(GetPath(), columns.GetColumnTypes(), columns.GetColumnNames(),
+                                                      options);
             }
+            WriteCollection(context, *file_new_rows, *writer);
+        }
+        if (deleted_count < data_file.row_count) {
+            metadata->DeletionVectorsInsert(oid, data_file.file_name, deleted_rows.ToVector());
+        } else if (is_data_file) {
+            metadata->DataFilesDelete(data_file.file_name);
+            LakeDeleteFile(oid, data_file.file_name);
+        } else {
+            DeleteBufferedFile(*metadata, data_file.file_name);
+        }
+    }
+
+    if (!rewrites.empty()) {
+        string path = GetPath();
+        auto types = columns.GetColumnTypes();
+        auto names = columns.GetColumnNames();
+        TaskExecutor executor(context);
+        for (auto &rewrite : rewrites) {
+            executor.ScheduleTask(
+                make_uniq<RewriteFileTask>(executor, context, path, types, names, options, rewrite));
         }
-    } else {
-        for (auto &file_name : file_names) {
-            file_paths.push_back(path + file_name);
+        executor.WorkOnTasks();
+        for (auto &rewrite : rewrites) {
+            AddDataFiles(rewrite.new_data_files);
+            if (rewrite.is_data_file) {
+                metadata->DataFilesDelete(rewrite.data_file.file_name);
+                LakeDeleteFile(oid, rewrite.data_file.file_name);
+            } else {
+                DeleteBufferedFile(*metadata, rewrite.data_file.file_name);
+            }
         }
     }
-    return file_paths;
+    FinalizeInsert();
+}
+
+idx_t ColumnstoreTable::GetFiles(vector<ColumnstoreDataFile> &data_files, vector<string> &file_paths) {
+    auto path = metadata->TablesSearch(oid);
+    data_files = metadata->DataFilesSearch(oid);
+    vector<string> file_names;
+    for (auto &data_file : data_files) {
+        file_names.push_back(data_file.file_name);
+    }
+    file_paths = GetDataFilePaths(path, file_names);
+    idx_t num_data_files = data_files.size();
+    for (auto &buffered_file : metadata->BufferedFilesSearch(oid)) {
+        file_paths.push_back(GetBufferedFilePath(*metadata, buffered_file.file_name));
+        data_files.push_back({std::move(buffered_file.file_name), buffered_file.file_size, buffered_file.row_count,
+                              {} /*column_stats*/});
+    }
+    return num_data_files;
 }
 
 } // namespace duckdb
@@ -5,9 +5,14 @@
 
 namespace duckdb {
 
+class ColumnDataCollection;
 class ColumnstoreMetadata;
 class ColumnstoreWriter;
 class DataChunk;
+class RowIdSet;
+class TableFilterSet;
+struct ColumnstoreDataFile;
+struct ColumnstoreStorageOptions;
 
 class ColumnstoreTable : public TableCatalogEntry {
 public:
@@ -16,28 +21,62 @@ public:
     ~ColumnstoreTable() override;
 
 public:
-    unique_ptr<BaseStatistics> GetStatistics(ClientContext &context, column_t column_id) override {
-        throw NotImplementedException("GetStatistics not supported yet");
-    }
+    unique_ptr<BaseStatistics> GetStatistics(ClientContext &context, column_t column_id) override;
 
     TableFunction GetScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data) override;
 
     TableStorageInfo GetStorageInfo(ClientContext &context) override;
 
+    // Like GetScanFunction, but leaves out data files whose every row matches filters going by their column stats, and
+    // returns those in covered_data_files. DELETE drops them without reading them.
+    TableFunction GetDeleteScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data,
+                                        const vector<column_t> &column_ids, TableFilterSet &filters,
+                                        vector<ColumnstoreDataFile> &covered_data_files /*out*/);
+
 public:
+    string GetPath();
+
+    ColumnstoreStorageOptions GetStorageOptions();
+
     void Insert(ClientContext &context, DataChunk &chunk);
 
     void FinalizeInsert();
 
-    void Delete(ClientContext &context, vector<row_t> &row_ids);
+    // Registers data files produced by a ColumnstoreWriter in the catalog and the lake
+    void AddDataFiles(const vector<ColumnstoreDataFile> &data_files);
+
+    // Writes a small insert to the write buffer instead of new data files
+    void BufferInsert(ClientContext &context, ColumnDataCollection &collection);
+
+    // Moves the write buffer into data files once it passes the flush thresholds (or always, if force)
+    void FlushBuffer(ClientContext &context, bool force);
+
+    void Delete(ClientContext &context, RowIdSet &row_ids);
+
+    // Drops whole data files from the catalog and the lake
+    void DeleteDataFiles(const vector<ColumnstoreDataFile> &data_files);
+
+    // Deletes the old images of updated rows and writes new_rows (keyed by the file number of the old images) along
+    // with the rest of the file they came from, so each file is rewritten at most once
+    void Update(ClientContext &context, RowIdSet &row_ids,
+                unordered_map<idx_t, unique_ptr<ColumnDataCollection>> &new_rows);
 
 private:
-    vector<string> GetFilePaths(const string &path, const vector<string> &file_names);
+    // Data files followed by buffered files (which have no column stats), row ids index into this list. Returns the
+    // number of data files.
+    idx_t GetFiles(vector<ColumnstoreDataFile> &data_files /*out*/, vector<string> &file_paths /*out*/);
+
+    void DeleteAndInsert(ClientContext &context, RowIdSet &row_ids,
+                         unordered_map<idx_t, unique_ptr<ColumnDataCollection>> &new_rows);
 
 private:
     Oid oid;
     unique_ptr<ColumnstoreMetadata> metadata;
     unique_ptr<ColumnstoreWriter> writer;
+    // Set by the first GetStatistics, by logical column index. Empty while there are buffered files.
+    mutex statistics_lock;
+    bool has_statistics = false;
+    vector<unique_ptr<BaseStatistics>> column_statistics;
 };
 
 } // namespace duckdb
@@ -0,0 +1,852 @@
+#include "columnstore/columnstore_writer.hpp"
+#include "columnstore/columnstore_cache.hpp"
+#include "columnstore/columnstore_footer_cache.hpp"
+#include "duckdb/common/serializer/memory_stream.hpp"
+#include "duckdb/common/sort/sort.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/uuid.hpp"
+#include "duckdb/common/vector_operations/vector_operations.hpp"
+#include "duckdb/planner/expression/bound_reference_expression.hpp"
+#include "duckdb/storage/buffer_manager.hpp"
+#include "duckdb/storage/statistics/base_statistics.hpp"
+#include "parquet_reader.hpp"
+#include "parquet_statistics.hpp"
+#include "parquet_writer.hpp"
+#include "pgmooncake_guc.hpp"
+
+namespace duckdb {
+
+const char *x_mooncake_local_cache = "mooncake_local_cache/";
+
+// Longer strings get no min/max, they are rarely useful for pruning and would bloat the catalog
+const idx_t x_max_string_size = 64;
+
+// Directory of NULL partition values, as in Hive
+const char *x_null_partition_value = "__HIVE_DEFAULT_PARTITION__";
+
+// Writes a data file while keeping a copy of it in the local cache, which is handed to ColumnstoreCache once the data
+// file is complete
+class SingleFileCachedWriteFileSystem : public FileSystem {
+public:
+    SingleFileCachedWriteFileSystem(ClientContext &context, const string &file_name)
+        : fs(GetFileSystem(context)), file_name(file_name), cached_file_path(x_mooncake_local_cache + file_name),
+          file_size(0) {}
+
+    ~SingleFileCachedWriteFileSystem() override {
+        // A partial copy is useless
+        if (cached_file) {
+            cached_file.reset();
+            std::remove(cached_file_path.c_str());
+        }
+    }
+
+public:
+    unique_ptr<FileHandle> OpenFile(const string &path, FileOpenFlags flags,
+                                    optional_ptr<FileOpener> opener = nullptr) override {
+        if (IsRemoteFile(path) && mooncake_enable_local_cache) {
+            auto disk_space = fs.GetAvailableDiskSpace(x_mooncake_local_cache);
+            if (disk_space.IsValid() && disk_space.GetIndex() > x_min_disk_space) {
+                cached_file = fs.OpenFile(cached_file_path, flags, opener);
+            }
+        }
+        return fs.OpenFile(path, flags, opener);
+    }
+
+    int64_t Write(FileHandle &handle, void *buffer, int64_t nr_bytes) override {
+        file_size += nr_bytes;
+        if (cached_file) {
+            int64_t bytes_written = fs.Write(*cached_file, buffer, nr_bytes);
+            D_ASSERT(bytes_written == nr_bytes);
+        }
+        return fs.Write(handle, buffer, nr_bytes);
+    }
+
+    string GetName() const override {
+        return "SingleFileCachedWriteFileSystem";
+    }
+
+    idx_t GetFileSize() const {
+        return file_size;
+    }
+
+    // Called once the data file is complete
+    void Finalize() {
+        if (!cached_file) {
+            return;
+        }
+        cached_file->Close();
+        cached_file.reset();
+        if (!ColumnstoreCache::Admit(file_name, NumericCast<int64_t>(file_size))) {
+            std::remove(cached_file_path.c_str());
+        }
+    }
+
+private:
+    static const idx_t x_min_disk_space = 1024 * 1024 * 1024;
+
+    FileSystem &fs;
+    string file_name;
+    string cached_file_path;
+    unique_ptr<FileHandle> cached_file;
+    idx_t file_size;
+};
+
+const unordered_map<string, duckdb_parquet::format::CompressionCodec::type> x_compression_codecs = {
+    {"uncompressed", duckdb_parquet::format::CompressionCodec::UNCOMPRESSED},
+    {"snappy", duckdb_parquet::format::CompressionCodec::SNAPPY},
+    {"gzip", duckdb_parquet::format::CompressionCodec::GZIP},
+    {"zstd", duckdb_parquet::format::CompressionCodec::ZSTD},
+    {"brotli", duckdb_parquet::format::CompressionCodec::BROTLI},
+    {"lz4", duckdb_parquet::format::CompressionCodec::LZ4_RAW}};
+
+class DataFileWriter {
+public:
+    DataFileWriter(ClientContext &context, FileSystem &fs, string file_name, vector<LogicalType> types,
+                   vector<string> names, ChildFieldIDs field_ids, const ColumnstoreStorageOptions &options)
+        : collection(context, types, ColumnDataAllocatorType::HYBRID),
+          writer(context, fs, std::move(file_name), std::move(types), std::move(names),
+                 x_compression_codecs.at(options.compression), std::move(field_ids), {} /*kv_metadata*/,
+                 {} /*encryption_config*/,
+                 options.dictionary_compression_ratio_threshold == -1
+                     ? NumericLimits<double>::Maximum()
+                     : options.dictionary_compression_ratio_threshold,
+                 options.has_compression_level ? optional_idx(NumericCast<idx_t>(options.compression_level))
+                                               : optional_idx(),
+                 true /*debug_use_openssl*/),
+          row_group_size(NumericCast<idx_t>(options.row_group_size)),
+          row_group_size_bytes(NumericCast<idx_t>(options.row_group_size_bytes)),
+          file_size_bytes(NumericCast<idx_t>(options.file_size_bytes)) {
+        collection.InitializeAppend(append_state);
+    }
+
+public:
+    // Return true if needs to rotate to a new data file
+    bool Write(DataChunk &chunk) {
+        collection.Append(append_state, chunk);
+        if (collection.Count() >= row_group_size || collection.SizeInBytes() >= row_group_size_bytes) {
+            writer.Flush(collection);
+            append_state.current_chunk_state.handles.clear();
+            collection.InitializeAppend(append_state);
+            return writer.FileSize() >= file_size_bytes;
+        }
+        return false;
+    }
+
+    void Finalize() {
+        writer.Flush(collection);
+        writer.Finalize();
+    }
+
+private:
+    ColumnDataCollection collection;
+    ColumnDataAppendState append_state;
+    ParquetWriter writer;
+    idx_t row_group_size;
+    idx_t row_group_size_bytes;
+    idx_t file_size_bytes;
+};
+
+namespace {
+
+// Column names and values are URL-encoded like DuckDB does in hive partitioned COPY TO, so neither holds a '/' or '='.
+// format is a partition column cast to VARCHAR.
+string EscapePartitionValue(const UnifiedVectorFormat &format, idx_t row) {
+    auto idx = format.sel->get_index(row);
+    if (!format.validity.RowIsValid(idx)) {
+        return x_null_partition_value;
+    }
+    return StringUtil::URLEncode(UnifiedVectorFormat::GetData<string_t>(format)[idx].GetString());
+}
+
+template <class T, class OP>
+void NormalizeZOrderKey(Vector &input, idx_t count, uint64_t *result, OP normalize) {
+    UnifiedVectorFormat format;
+    input.ToUnifiedFormat(count, format);
+    auto data = UnifiedVectorFormat::GetData<T>(format);
+    for (idx_t i = 0; i < count; i++) {
+        auto idx = format.sel->get_index(i);
+        result[i] = format.validity.RowIsValid(idx) ? normalize(data[idx]) : 0;
+    }
+}
+
+uint64_t NormalizeSigned(int64_t value) {
+    return uint64_t(value) ^ (uint64_t(1) << 63);
+}
+
+uint64_t NormalizeDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+uint64_t NormalizeString(const string_t &value) {
+    uint64_t result = 0;
+    auto data = const_data_ptr_cast(value.GetData());
+    for (idx_t i = 0; i < MinValue<idx_t>(value.GetSize(), sizeof(result)); i++) {
+        result |= uint64_t(data[i]) << (56 - 8 * i);
+    }
+    return result;
+}
+
+// Maps the values of a key column to unsigned integers of the same order (NULLs first), only the leading bytes of
+// strings and the upper half of 128-bit integers count
+void NormalizeZOrderKey(Vector &input, idx_t count, uint64_t *result) {
+    switch (input.GetType().InternalType()) {
+    case PhysicalType::BOOL:
+    case PhysicalType::INT8:
+        return NormalizeZOrderKey<int8_t>(input, count, result, NormalizeSigned);
+    case PhysicalType::INT16:
+        return NormalizeZOrderKey<int16_t>(input, count, result, NormalizeSigned);
+    case PhysicalType::INT32:
+        return NormalizeZOrderKey<int32_t>(input, count, result, NormalizeSigned);
+    case PhysicalType::INT64:
+        return NormalizeZOrderKey<int64_t>(input, count, result, NormalizeSigned);
+    case PhysicalType::UINT8:
+        return NormalizeZOrderKey<uint8_t>(input, count, result, [](uint8_t value) { return uint64_t(value); });
+    case PhysicalType::UINT16:
+        return NormalizeZOrderKey<uint16_t>(input, count, result, [](uint16_t value) { return uint64_t(value); });
+    case PhysicalType::UINT32:
+        return NormalizeZOrderKey<uint32_t>(input, count, result, [](uint32_t value) { return uint64_t(value); });
+    case PhysicalType::UINT64:
+        return NormalizeZOrderKey<uint64_t>(input, count, result, [](uint64_t value) { return value; });
+    case PhysicalType::INT128:
+        return NormalizeZOrderKey<hugeint_t>(input, count, result,
+                                             [](hugeint_t value) { return NormalizeSigned(value.upper); });
+    case PhysicalType::UINT128:
+        return NormalizeZOrderKey<uhugeint_t>(input, count, result, [](uhugeint_t value) { return value.upper; });
+    case PhysicalType::FLOAT:
+        return NormalizeZOrderKey<float>(input, count, result, [](float value) { return NormalizeDouble(value); });
+    case PhysicalType::DOUBLE:
+        return NormalizeZOrderKey<double>(input, count, result, NormalizeDouble);
+    case PhysicalType::VARCHAR:
+        return NormalizeZOrderKey<string_t>(input, count, result, NormalizeString);
+    default:
+        throw NotImplementedException("Z-order over columns of type %s is not supported", input.GetType().ToString());
+    }
+}
+
+// Interleaves the bits of the normalized key columns, most significant first, into keys that sort rows along a
+// Z-order curve
+void ComputeZOrderKeys(DataChunk &chunk, const vector<idx_t> &key_columns, Vector &result) {
+    idx_t count = chunk.size();
+    idx_t num_keys = key_columns.size();
+    vector<uint64_t> values(count * num_keys);
+    for (idx_t k = 0; k < num_keys; k++) {
+        NormalizeZOrderKey(chunk.data[key_columns[k]], count, values.data() + k * count);
+    }
+    auto result_data = FlatVector::GetData<string_t>(result);
+    for (idx_t i = 0; i < count; i++) {
+        auto key = StringVector::EmptyString(result, num_keys * sizeof(uint64_t));
+        auto key_data = data_ptr_cast(key.GetDataWriteable());
+        memset(key_data, 0, key.GetSize());
+        idx_t bit = 0;
+        for (int shift = 63; shift >= 0; shift--) {
+            for (idx_t k = 0; k < num_keys; k++, bit++) {
+                if ((values[k * count + i] >> shift) & 1) {
+                    key_data[bit / 8] |= uint8_t(0x80 >> (bit % 8));
+                }
+            }
+        }
+        key.Finalize();
+        result_data[i] = key;
+    }
+}
+
+// Elements of list columns are numbered after the columns, depth first. The Iceberg schema of the lake table follows
+// the same numbering, see GetIcebergType.
+void SetElementFieldIDs(const LogicalType &type, FieldID &field_id, int32_t &next_id) {
+    if (type.id() != LogicalTypeId::LIST) {
+        return;
+    }
+    auto &element_id = ((*field_id.child_field_ids.ids)["element"] = FieldID(next_id++));
+    SetElementFieldIDs(ListType::GetChildType(type), element_id, next_id);
+}
+
+} // namespace
+
+// Collects rows and hands them back ordered by the key columns, or along a Z-order curve over them. Sorting goes
+// through DuckDB's sort, which spills to disk like ORDER BY does.
+class DataFileSorter {
+public:
+    DataFileSorter(ClientContext &context, const vector<LogicalType> &types, const vector<idx_t> &key_columns,
+                   bool zorder)
+        : context(context), types(types), key_columns(key_columns), zorder(zorder), size_in_bytes(0) {
+        if (zorder) {
+            key_types.push_back(LogicalType::BLOB);
+        } else {
+            for (auto column : key_columns) {
+                key_types.push_back(types[column]);
+            }
+        }
+        vector<BoundOrderByNode> orders;
+        for (idx_t i = 0; i < key_types.size(); i++) {
+            orders.emplace_back(OrderType::ASCENDING, OrderByNullType::NULLS_LAST,
+                                make_uniq<BoundReferenceExpression>(key_types[i], i));
+        }
+        payload_layout.Initialize(types);
+        auto &buffer_manager = BufferManager::GetBufferManager(context);
+        global_sort_state = make_uniq<GlobalSortState>(buffer_manager, orders, payload_layout);
+        local_sort_state.Initialize(*global_sort_state, buffer_manager);
+    }
+
+public:
+    ClientContext &GetContext() {
+        return context;
+    }
+
+    idx_t GetSizeInBytes() const {
+        return size_in_bytes;
+    }
+
+    // Returns the size of all rows collected so far
+    idx_t Append(DataChunk &chunk) {
+        DataChunk keys;
+        if (zorder) {
+            keys.Initialize(Allocator::Get(context), key_types);
+            ComputeZOrderKeys(chunk, key_columns, keys.data[0]);
+        } else {
+            keys.InitializeEmpty(key_types);
+            for (idx_t i = 0; i < key_columns.size(); i++) {
+                keys.data[i].Reference(chunk.data[key_columns[i]]);
+            }
+        }
+        keys.SetCardinality(chunk);
+        idx_t previous_size = local_sort_state.SizeInBytes();
+        local_sort_state.SinkChunk(keys, chunk);
+        size_in_bytes += local_sort_state.SizeInBytes() - previous_size;
+        // Sorted runs are merged at the end
+        if (local_sort_state.SizeInBytes() >= x_sort_run_size) {
+            local_sort_state.Sort(*global_sort_state, true /*reorder_heap*/);
+        }
+        return size_in_bytes;
+    }
+
+    void Scan(const std::function<void(DataChunk &)> &callback) {
+        global_sort_state->AddLocalState(local_sort_state);
+        if (global_sort_state->sorted_blocks.empty()) {
+            return;
+        }
+        global_sort_state->PrepareMergePhase();
+        while (global_sort_state->sorted_blocks.size() > 1) {
+            global_sort_state->InitializeMergeRound();
+            MergeSorter merge_sorter(*global_sort_state, global_sort_state->buffer_manager);
+            merge_sorter.PerformInMergeRound();
+            global_sort_state->CompleteMergeRound();
+        }
+        PayloadScanner scanner(*global_sort_state);
+        DataChunk chunk;
+        chunk.Initialize(context, types);
+        while (true) {
+            chunk.Reset();
+            scanner.Scan(chunk);
+            if (chunk.size() == 0) {
+                break;
+            }
+            callback(chunk);
+        }
+    }
+
+private:
+    static const idx_t x_sort_run_size = 256 * 1024 * 1024;
+
+    ClientContext &context;
+    vector<LogicalType> types;
+    vector<idx_t> key_columns;
+    bool zorder;
+    vector<LogicalType> key_types;
+    RowLayout payload_layout;
+    unique_ptr<GlobalSortState> global_sort_state;
+    LocalSortState local_sort_state;
+    idx_t size_in_bytes;
+};
+
+class ColumnStatsCollector {
+public:
+    explicit ColumnStatsCollector(const LogicalType &type)
+        : stats(BaseStatistics::CreateEmpty(type)), has_numeric_stats(false), null_count(0), valid_count(0) {}
+
+public:
+    void Update(Vector &vector, idx_t count) {
+        UnifiedVectorFormat format;
+        vector.ToUnifiedFormat(count, format);
+        if (stats.GetStatsType() == StatisticsType::NUMERIC_STATS) {
+            switch (stats.GetType().InternalType()) {
+            case PhysicalType::INT8:
+                return UpdateNumeric<int8_t>(format, count);
+            case PhysicalType::INT16:
+                return UpdateNumeric<int16_t>(format, count);
+            case PhysicalType::INT32:
+                return UpdateNumeric<int32_t>(format, count);
+            case PhysicalType::INT64:
+                return UpdateNumeric<int64_t>(format, count);
+            case PhysicalType::INT128:
+                return UpdateNumeric<hugeint_t>(format, count);
+            case PhysicalType::UINT8:
+                return UpdateNumeric<uint8_t>(format, count);
+            case PhysicalType::UINT16:
+                return UpdateNumeric<uint16_t>(format, count);
+            case PhysicalType::UINT32:
+                return UpdateNumeric<uint32_t>(format, count);
+            case PhysicalType::UINT64:
+                return UpdateNumeric<uint64_t>(format, count);
+            case PhysicalType::FLOAT:
+                return UpdateNumeric<float>(format, count);
+            case PhysicalType::DOUBLE:
+                return UpdateNumeric<double>(format, count);
+            default:
+                break;
+            }
+        }
+        if (stats.GetType().id() == LogicalTypeId::VARCHAR) {
+            return UpdateString(format, count);
+        }
+        for (idx_t i = 0; i < count; i++) {
+            if (format.validity.RowIsValid(format.sel->get_index(i))) {
+                valid_count++;
+            } else {
+                null_count++;
+            }
+        }
+    }
+
+    ColumnstoreColumnStats Finalize(const string &column_name) const {
+        ColumnstoreColumnStats result{column_name, null_count, false /*has_min_max*/, "", ""};
+        if (valid_count == 0) {
+            return result;
+        }
+        if (has_numeric_stats && NumericStats::HasMinMax(stats)) {
+            result.has_min_max = true;
+            result.min_value = NumericStats::Min(stats).ToString();
+            result.max_value = NumericStats::Max(stats).ToString();
+        } else if (stats.GetType().id() == LogicalTypeId::VARCHAR && min_string.size() <= x_max_string_size &&
+                   max_string.size() <= x_max_string_size) {
+            result.has_min_max = true;
+            result.min_value = min_string;
+            result.max_value = max_string;
+        }
+        return result;
+    }
+
+private:
+    template <class T>
+    void UpdateNumeric(UnifiedVectorFormat &format, idx_t count) {
+        has_numeric_stats = true;
+        auto data = UnifiedVectorFormat::GetData<T>(format);
+        for (idx_t i = 0; i < count; i++) {
+            auto idx = format.sel->get_index(i);
+            if (format.validity.RowIsValid(idx)) {
+                NumericStats::Update<T>(stats, data[idx]);
+                valid_count++;
+            } else {
+                null_count++;
+            }
+        }
+    }
+
+    void UpdateString(UnifiedVectorFormat &format, idx_t count) {
+        auto data = UnifiedVectorFormat::GetData<string_t>(format);
+        for (idx_t i = 0; i < count; i++) {
+            auto idx = format.sel->get_index(i);
+            if (!format.validity.RowIsValid(idx)) {
+                null_count++;
+                continue;
+            }
+            if (valid_count == 0 || data[idx] < AsStringT(min_string)) {
+                min_string = data[idx].GetString();
+            }
+            if (valid_count == 0 || data[idx] > AsStringT(max_string)) {
+                max_string = data[idx].GetString();
+            }
+            valid_count++;
+        }
+    }
+
+    static string_t AsStringT(const string &str) {
+        return string_t(str.c_str(), UnsafeNumericCast<uint32_t>(str.size()));
+    }
+
+private:
+    BaseStatistics stats;
+    bool has_numeric_stats;
+    string min_string;
+    string max_string;
+    int64_t null_count;
+    int64_t valid_count;
+};
+
+ColumnstoreWriter::ColumnstoreWriter(string path, vector<LogicalType> types, vector<string> names,
+                                     ColumnstoreStorageOptions options)
+    : path(std::move(path)), types(std::move(types)), names(std::move(names)), options(std::move(options)),
+      compression_ratio(1), row_count(0) {
+    for (auto &column_name : this->options.sort_by) {
+        auto it = std::find(this->names.begin(), this->names.end(), column_name);
+        if (it == this->names.end()) {
+            throw InvalidInputException("sort key \"%s\" is not a column", column_name);
+        }
+        sort_columns.push_back(NumericCast<idx_t>(it - this->names.begin()));
+    }
+    for (auto &column_name : this->options.partition_by) {
+        auto it = std::find(this->names.begin(), this->names.end(), column_name);
+        if (it == this->names.end()) {
+            throw InvalidInputException("partition key \"%s\" is not a column", column_name);
+        }
+        partition_columns.push_back(NumericCast<idx_t>(it - this->names.begin()));
+    }
+}
+
+ColumnstoreWriter::~ColumnstoreWriter() = default;
+
+void ColumnstoreWriter::Write(ClientContext &context, DataChunk &chunk) {
+    if (!partition_columns.empty()) {
+        WritePartitions(context, chunk);
+        return;
+    }
+    if (sort_columns.empty()) {
+        WriteDataFile(context, chunk);
+        return;
+    }
+    if (!sorter) {
+        sorter = make_uniq<DataFileSorter>(context, types, sort_columns, options.zorder);
+    }
+    // The sorter holds rows uncompressed, its size is scaled by how much the last flush shrank them on disk
+    if (double(sorter->Append(chunk)) * compression_ratio >= double(options.file_size_bytes)) {
+        FlushSorter();
+    }
+}
+
+void ColumnstoreWriter::WritePartitions(ClientContext &context, DataChunk &chunk) {
+    // Partition columns are cast a vector at a time and rows grouped by their raw values, only the first row of each
+    // group is escaped into its directory
+    vector<Vector> partition_values;
+    partition_values.reserve(partition_columns.size());
+    vector<UnifiedVectorFormat> formats(partition_columns.size());
+    for (idx_t k = 0; k < partition_columns.size(); k++) {
+        partition_values.emplace_back(LogicalType::VARCHAR, chunk.size());
+        VectorOperations::DefaultCast(chunk.data[partition_columns[k]], partition_values[k], chunk.size());
+        partition_values[k].ToUnifiedFormat(chunk.size(), formats[k]);
+    }
+    unordered_map<string, vector<sel_t>> group_rows;
+    string group_key;
+    for (idx_t i = 0; i < chunk.size(); i++) {
+        group_key.clear();
+        for (auto &format : formats) {
+            auto idx = format.sel->get_index(i);
+            if (!format.validity.RowIsValid(idx)) {
+                group_key += '\0';
+                continue;
+            }
+            auto &value = UnifiedVectorFormat::GetData<string_t>(format)[idx];
+            auto size = NumericCast<uint32_t>(value.GetSize());
+            group_key += '\1';
+            group_key.append(const_char_ptr_cast(&size), sizeof(size));
+            group_key.append(value.GetData(), value.GetSize());
+        }
+        group_rows[group_key].push_back(NumericCast<sel_t>(i));
+    }
+    for (auto &entry : group_rows) {
+        string directory;
+        for (idx_t k = 0; k < partition_columns.size(); k++) {
+            directory += StringUtil::URLEncode(names[partition_columns[k]]) + "=" +
+                         EscapePartitionValue(formats[k], entry.second[0]) + "/";
+        }
+        auto &partition_writer = partition_writers[directory];
+        if (!partition_writer) {
+            // Object stores have no directories, local ones need each level created
+            if (!FileSystem::IsRemoteFile(path)) {
+                auto local_fs = FileSystem::CreateLocal();
+                for (idx_t pos = directory.find('/'); pos != string::npos; pos = directory.find('/', pos + 1)) {
+                    string parent = path + directory.substr(0, pos);
+                    if (!local_fs->DirectoryExists(parent)) {
+                        local_fs->CreateDirectory(parent);
+                    }
+                }
+            }
+            auto partition_options = options;
+            partition_options.partition_by.clear();
+            partition_writer = make_uniq<ColumnstoreWriter>(path + directory, types, names, partition_options);
+        }
+        SelectionVector sel(entry.second.data());
+        DataChunk partition_chunk;
+        partition_chunk.InitializeEmpty(types);
+        partition_chunk.Slice(chunk, sel, entry.second.size());
+        partition_writer->Write(context, partition_chunk);
+    }
+}
+
+void ColumnstoreWriter::WriteDataFile(ClientContext &context, DataChunk &chunk) {
+    if (!writer) {
+        file_name = UUID::ToString(UUID::GenerateRandomUUID()) + ".parquet";
+        fs = make_uniq<SingleFileCachedWriteFileSystem>(context, file_name);
+        ChildFieldIDs field_ids;
+        // Columns are numbered by their attribute number, from 1 as Iceberg expects
+        auto next_id = NumericCast<int32_t>(names.size()) + 1;
+        for (idx_t i = 0; i < names.size(); i++) {
+            auto &field_id = ((*field_ids.ids)[names[i]] = duckdb::FieldID(NumericCast<int32_t>(i + 1)));
+            SetElementFieldIDs(types[i], field_id, next_id);
+        }
+        writer =
+            make_uniq<DataFileWriter>(context, *fs, path + file_name, types, names, std::move(field_ids), options);
+        row_count = 0;
+        for (auto &type : types) {
+            column_stats.emplace_back(type);
+        }
+    }
+    row_count += NumericCast<int64_t>(chunk.size());
+    for (idx_t i = 0; i < column_stats.size(); i++) {
+        column_stats[i].Update(chunk.data[i], chunk.size());
+    }
+    if (writer->Write(chunk)) {
+        FinalizeDataFile();
+    }
+}
+
+vector<ColumnstoreDataFile> ColumnstoreWriter::Finalize() {
+    for (auto &entry : partition_writers) {
+        for (auto &data_file : entry.second->Finalize()) {
+            data_file.file_name = entry.first + data_file.file_name;
+            data_files.push_back(std::move(data_file));
+        }
+    }
+    partition_writers.clear();
+    if (sorter) {
+        FlushSorter();
+    }
+    if (writer) {
+        FinalizeDataFile();
+    }
+    return std::move(data_files);
+}
+
+void ColumnstoreWriter::FinalizeDataFile() {
+    writer->Finalize();
+    writer.reset();
+    fs->Finalize();
+    idx_t file_size = fs->GetFileSize();
+    fs.reset();
+    ColumnstoreDataFile data_file{std::move(file_name), NumericCast<int64_t>(file_size), row_count,
+                                  {} /*column_stats*/};
+    for (idx_t i = 0; i < column_stats.size(); i++) {
+        data_file.column_stats.push_back(column_stats[i].Finalize(names[i]));
+    }
+    column_stats.clear();
+    data_files.push_back(std::move(data_file));
+}
+
+// Sorted rows end their data file, so that the min/max of files holding different batches don't overlap
+void ColumnstoreWriter::FlushSorter() {
+    auto &context = sorter->GetContext();
+    idx_t first_data_file = data_files.size();
+    sorter->Scan([&](DataChunk &chunk) { WriteDataFile(context, chunk); });
+    if (writer) {
+        FinalizeDataFile();
+    }
+    int64_t file_size = 0;
+    for (idx_t i = first_data_file; i < data_files.size(); i++) {
+        file_size += data_files[i].file_size;
+    }
+    if (sorter->GetSizeInBytes() > 0 && file_size > 0) {
+        compression_ratio = double(file_size) / double(sorter->GetSizeInBytes());
+    }
+    sorter.reset();
+}
+
+namespace {
+
+// Folds the min/max of a column chunk into min_value/max_value, row groups holding only NULLs don't count
+void UpdateMinMax(const LogicalType &type, const duckdb_parquet::format::SchemaElement &schema_element,
+                  const duckdb_parquet::format::Statistics &statistics, int64_t num_rows, bool &has_min_max,
+                  Value &min_value, Value &max_value) {
+    if (statistics.__isset.null_count && statistics.null_count == num_rows) {
+        return;
+    }
+    if (!statistics.__isset.min_value || !statistics.__isset.max_value) {
+        has_min_max = false;
+        return;
+    }
+    auto row_group_min = ParquetStatisticsUtils::ConvertValue(type, schema_element, statistics.min_value);
+    auto row_group_max = ParquetStatisticsUtils::ConvertValue(type, schema_element, statistics.max_value);
+    if (row_group_min.IsNull() || row_group_max.IsNull()) {
+        has_min_max = false;
+        return;
+    }
+    if (min_value.IsNull() || row_group_min < min_value) {
+        min_value = std::move(row_group_min);
+    }
+    if (max_value.IsNull() || row_group_max > max_value) {
+        max_value = std::move(row_group_max);
+    }
+}
+
+// Number of column chunks (leaves) under the schema element at index, which is moved past the element's subtree
+idx_t SkipSchemaElement(const vector<duckdb_parquet::format::SchemaElement> &schema, idx_t &index) {
+    auto &element = schema[index++];
+    if (!element.__isset.num_children || element.num_children == 0) {
+        return 1;
+    }
+    idx_t leaf_count = 0;
+    for (int32_t i = 0; i < element.num_children; i++) {
+        leaf_count += SkipSchemaElement(schema, index);
+    }
+    return leaf_count;
+}
+
+} // namespace
+
+ColumnstoreDataFile CopyRowGroups(ClientContext &context, const string &path, const string &file_path,
+                                  ParquetReader &reader, const vector<idx_t> &row_groups,
+                                  const vector<ColumnstoreColumnStats> &column_stats) {
+    string file_name = UUID::ToString(UUID::GenerateRandomUUID()) + ".parquet";
+    SingleFileCachedWriteFileSystem fs(context, file_name);
+    auto handle = fs.OpenFile(path + file_name, FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_FILE_CREATE_NEW);
+    auto source_handle = FileSystem::GetFileSystem(context).OpenFile(file_path, FileFlags::FILE_FLAGS_READ);
+    fs.Write(*handle, const_cast<char *>("PAR1"), 4);
+
+    auto file_metadata = *reader.GetFileMetadata();
+    file_metadata.row_groups.clear();
+    file_metadata.num_rows = 0;
+    int64_t row_count = 0;
+    // Stats are rebuilt from the copied row groups, so a file that lost rows gets exact null counts and tighter bounds.
+    // Each primitive column is a single column chunk; nested columns span several, whose stats describe their leaves
+    // rather than the column, so their null count and min/max become unknown.
+    auto &schema = reader.GetFileMetadata()->schema;
+    vector<idx_t> schema_indexes;
+    vector<idx_t> chunk_indexes;
+    vector<bool> has_null_counts;
+    idx_t schema_index = 1;
+    idx_t chunk_index = 0;
+    while (schema_index < schema.size()) {
+        schema_indexes.push_back(schema_index);
+        chunk_indexes.push_back(chunk_index);
+        idx_t leaf_count = SkipSchemaElement(schema, schema_index);
+        has_null_counts.push_back(leaf_count == 1);
+        chunk_index += leaf_count;
+    }
+    if (chunk_indexes.size() != column_stats.size()) {
+        has_null_counts.assign(column_stats.size(), false);
+    }
+    vector<int64_t> null_counts(column_stats.size(), 0);
+    vector<bool> has_min_max;
+    vector<Value> min_values(column_stats.size());
+    vector<Value> max_values(column_stats.size());
+    for (idx_t i = 0; i < column_stats.size(); i++) {
+        has_min_max.push_back(has_null_counts[i] && column_stats[i].has_min_max);
+    }
+    for (idx_t row_group_index : row_groups) {
+        auto row_group = reader.GetFileMetadata()->row_groups[row_group_index];
+        // DataFileWriter lays out the column chunks of a row group contiguously
+        int64_t start = NumericLimits<int64_t>::Maximum();
+        int64_t end = 0;
+        for (auto &column : row_group.columns) {
+            auto &meta_data = column.meta_data;
+            int64_t column_start = meta_data.__isset.dictionary_page_offset && meta_data.dictionary_page_offset > 0
+                                       ? MinValue(meta_data.dictionary_page_offset, meta_data.data_page_offset)
+                                       : meta_data.data_page_offset;
+            start = MinValue(start, column_start);
+            end = MaxValue(end, column_start + meta_data.total_compressed_size);
+        }
+        AllocatedData buffer = Allocator::Get(context).Allocate(NumericCast<idx_t>(end - start));
+        source_handle->Read(buffer.get(), buffer.GetSize(), NumericCast<idx_t>(start));
+        int64_t offset = NumericCast<int64_t>(fs.GetFileSize());
+        fs.Write(*handle, buffer.get(), NumericCast<int64_t>(buffer.GetSize()));
+
+        int64_t delta = offset - start;
+        for (idx_t i = 0; i < row_group.columns.size(); i++) {
+            auto &column = row_group.columns[i];
+            auto &meta_data = column.meta_data;
+            column.file_offset += delta;
+            meta_data.data_page_offset += delta;
+            if (meta_data.__isset.dictionary_page_offset) {
+                meta_data.dictionary_page_offset += delta;
+            }
+            if (meta_data.__isset.index_page_offset) {
+                meta_data.index_page_offset += delta;
+            }
+            // Indexes and bloom filters live outside the copied range
+            meta_data.__isset.bloom_filter_offset = false;
+            column.__isset.offset_index_offset = false;
+            column.__isset.offset_index_length = false;
+            column.__isset.column_index_offset = false;
+            column.__isset.column_index_length = false;
+        }
+        for (idx_t i = 0; i < column_stats.size(); i++) {
+            if (!has_null_counts[i]) {
+                continue;
+            }
+            auto &statistics = row_group.columns[chunk_indexes[i]].meta_data.statistics;
+            if (statistics.__isset.null_count) {
+                null_counts[i] += statistics.null_count;
+            } else {
+                has_null_counts[i] = false;
+                has_min_max[i] = false;
+            }
+            if (has_min_max[i]) {
+                UpdateMinMax(reader.return_types[i], schema[schema_indexes[i]], statistics, row_group.num_rows,
+                             has_min_max[i], min_values[i], max_values[i]);
+            }
+        }
+        if (row_group.__isset.file_offset) {
+            row_group.file_offset += delta;
+        }
+        row_count += row_group.num_rows;
+        file_metadata.row_groups.push_back(std::move(row_group));
+    }
+    file_metadata.num_rows = row_count;
+
+    MemoryStream stream;
+    WriteFileMetaData(file_metadata, stream);
+    uint32_t metadata_size = NumericCast<uint32_t>(stream.GetPosition());
+    fs.Write(*handle, stream.GetData(), NumericCast<int64_t>(stream.GetPosition()));
+    fs.Write(*handle, &metadata_size, sizeof(uint32_t));
+    fs.Write(*handle, const_cast<char *>("PAR1"), 4);
+    handle->Sync();
+    handle->Close();
+    fs.Finalize();
+    ColumnstoreFooterCache::Store(path + file_name, file_metadata);
+
+    ColumnstoreDataFile data_file{std::move(file_name), NumericCast<int64_t>(fs.GetFileSize()), row_count,
+                                  column_stats};
+    for (idx_t i = 0; i < column_stats.size(); i++) {
+        auto &stats = data_file.column_stats[i];
+        stats.null_count = has_null_counts[i] ? null_counts[i] : -1 /*unknown*/;
+        if (!has_min_max[i] || min_values[i].IsNull()) {
+            stats.has_min_max = false;
+            stats.min_value.clear();
+            stats.max_value.clear();
+            continue;
+        }
+        stats.min_value = min_values[i].ToString();
+        stats.max_value = max_values[i].ToString();
+        if (stats.min_value.size() > x_max_string_size || stats.max_value.size() > x_max_string_size) {
+            stats.has_min_max = false;
+            stats.min_value.clear();
+            stats.max_value.clear();
+        }
+    }
+    return data_file;
+}
+
+string GetPartitionDirectory(const string &file_name) {
+    auto pos = file_name.rfind('/');
+    return pos == string::npos ? "" : file_name.substr(0, pos + 1);
+}
+
+vector<std::pair<string, Value>> GetPartitionValues(const string &file_name) {
+    vector<std::pair<string, Value>> partition_values;
+    auto directories = StringUtil::Split(GetPartitionDirectory(file_name), '/');
+    for (auto &directory : directories) {
+        auto pos = directory.find('=');
+        if (pos == string::npos) {
+            continue;
+        }
+        string value = directory.substr(pos + 1);
+        partition_values.emplace_back(StringUtil::URLDecode(directory.substr(0, pos)),
+                                      value == x_null_partition_value ? Value() : Value(StringUtil::URLDecode(value)));
+    }
+    return partition_values;
+}
+
+bool IsSupportedCompression(const string &compression) {
+    return x_compression_codecs.count(compression) > 0;
+}
+
+} // namespace duckdb
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "columnstore/columnstore_metadata.hpp"
+#include "duckdb/common/types.hpp"
+#include "duckdb/common/types/value.hpp"
+#include "duckdb/common/unique_ptr.hpp"
+#include "duckdb/common/unordered_map.hpp"
+
+namespace duckdb {
+
+class ClientContext;
+class ColumnStatsCollector;
+class DataChunk;
+class DataFileSorter;
+class DataFileWriter;
+class ParquetReader;
+class SingleFileCachedWriteFileSystem;
+
+extern const char *x_mooncake_local_cache;
+
+// Writes chunks into one or more Parquet data files under path, collecting row count and per-column stats of each. The
+// writer doesn't touch the catalog, so one can be owned by each DuckDB thread; the caller registers the returned data
+// files. With sort keys, rows are held back until they fill a data file and written out sorted. With partition keys,
+// each partition gets a writer of its own, and the data files it writes are named relative to path.
+class ColumnstoreWriter {
+public:
+    ColumnstoreWriter(string path, vector<LogicalType> types, vector<string> names, ColumnstoreStorageOptions options);
+
+    ~ColumnstoreWriter();
+
+public:
+    void Write(ClientContext &context, DataChunk &chunk);
+
+    vector<ColumnstoreDataFile> Finalize();
+
+private:
+    void WritePartitions(ClientContext &context, DataChunk &chunk);
+
+    void WriteDataFile(ClientContext &context, DataChunk &chunk);
+
+    void FinalizeDataFile();
+
+    void FlushSorter();
+
+private:
+    string path;
+    vector<LogicalType> types;
+    vector<string> names;
+    ColumnstoreStorageOptions options;
+    vector<idx_t> sort_columns;
+    unique_ptr<DataFileSorter> sorter;
+    // On-disk size of the last flushed sorted rows over their size in the sorter, 1 until rows were flushed
+    double compression_ratio;
+    vector<idx_t> partition_columns;
+    // Keyed by partition directory
+    unordered_map<string, unique_ptr<ColumnstoreWriter>> partition_writers;
+    string file_name;
+    unique_ptr<SingleFileCachedWriteFileSystem> fs;
+    unique_ptr<DataFileWriter> writer;
+    int64_t row_count;
+    vector<ColumnStatsCollector> column_stats;
+    vector<ColumnstoreDataFile> data_files;
+};
+
+// Data files of partitioned tables are named <column>=<value>/.../<uuid>.parquet with both URL-encoded. Returns the
+// directory part, with its trailing slash (empty if unpartitioned).
+string GetPartitionDirectory(const string &file_name);
+
+// Columns and values of the partition a data file is in, decoded. Values are VARCHAR or NULL.
+vector<std::pair<string, Value>> GetPartitionValues(const string &file_name);
+
+// Copies the given row groups of an open data file byte for byte into a new data file under path, without decoding
+// them. column_stats are those of the source file: null counts and min/max are recomputed from the copied row groups.
+ColumnstoreDataFile CopyRowGroups(ClientContext &context, const string &path, const string &file_path,
+                                  ParquetReader &reader, const vector<idx_t> &row_groups,
+                                  const vector<ColumnstoreColumnStats> &column_stats);
+
+// Whether compression names a codec of ColumnstoreStorageOptions
+bool IsSupportedCompression(const string &compression);
+
+} // namespace duckdb
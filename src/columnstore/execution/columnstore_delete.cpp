@@ -1,5 +1,8 @@
 #include "columnstore/columnstore.hpp"
+#include "columnstore/columnstore_metadata.hpp"
+#include "columnstore/columnstore_row_id_set.hpp"
 #include "columnstore/columnstore_table.hpp"
+#include "duckdb/execution/operator/scan/physical_table_scan.hpp"
 #include "duckdb/execution/physical_operator.hpp"
 #include "duckdb/planner/expression/bound_reference_expression.hpp"
 #include "duckdb/planner/operator/logical_delete.hpp"
@@ -8,18 +11,28 @@ namespace duckdb {
 
 class ColumnstoreDeleteGlobalState : public GlobalSinkState {
 public:
-    vector<row_t> row_ids;
+    mutex lock;
+    RowIdSet row_ids;
+    idx_t delete_count = 0;
+};
+
+class ColumnstoreDeleteLocalState : public LocalSinkState {
+public:
+    RowIdSet row_ids;
+    idx_t delete_count = 0;
 };
 
 class ColumnstoreDelete : public PhysicalOperator {
 public:
     ColumnstoreDelete(vector<LogicalType> types, idx_t estimated_cardinality, ColumnstoreTable &table,
-                      idx_t row_id_index)
+                      idx_t row_id_index, vector<ColumnstoreDataFile> covered_data_files)
         : PhysicalOperator(PhysicalOperatorType::EXTENSION, std::move(types), estimated_cardinality), table(table),
-          row_id_index(row_id_index) {}
+          row_id_index(row_id_index), covered_data_files(std::move(covered_data_files)) {}
 
     ColumnstoreTable &table;
     idx_t row_id_index;
+    // Data files the scan leaves out since all their rows are deleted
+    vector<ColumnstoreDataFile> covered_data_files;
 
 public:
     string GetName() const override {
@@ -31,7 +44,7 @@ public:
     SourceResultType GetData(ExecutionContext &context, DataChunk &chunk, OperatorSourceInput &input) const override {
         auto &gstate = sink_state->Cast<ColumnstoreDeleteGlobalState>();
         chunk.SetCardinality(1);
-        chunk.SetValue(0, 0, Value::BIGINT(NumericCast<int64_t>(gstate.row_ids.size())));
+        chunk.SetValue(0, 0, Value::BIGINT(NumericCast<int64_t>(gstate.delete_count)));
         return SourceResultType::FINISHED;
     }
 
@@ -42,20 +55,34 @@ public:
 public:
     // Sink interface
     SinkResultType Sink(ExecutionContext &context, DataChunk &chunk, OperatorSinkInput &input) const override {
-        auto &gstate = input.global_state.Cast<ColumnstoreDeleteGlobalState>();
+        auto &lstate = input.local_state.Cast<ColumnstoreDeleteLocalState>();
         auto &row_ids = chunk.data[row_id_index];
         row_ids.Flatten(chunk.size());
         auto row_ids_data = FlatVector::GetData<row_t>(row_ids);
         for (idx_t i = 0; i < chunk.size(); i++) {
-            gstate.row_ids.push_back(row_ids_data[i]);
+            lstate.row_ids.Add(row_ids_data[i]);
         }
+        lstate.delete_count += chunk.size();
         return SinkResultType::NEED_MORE_INPUT;
     }
 
+    SinkCombineResultType Combine(ExecutionContext &context, OperatorSinkCombineInput &input) const override {
+        auto &gstate = input.global_state.Cast<ColumnstoreDeleteGlobalState>();
+        auto &lstate = input.local_state.Cast<ColumnstoreDeleteLocalState>();
+        lock_guard<mutex> guard(gstate.lock);
+        gstate.row_ids.Merge(std::move(lstate.row_ids));
+        gstate.delete_count += lstate.delete_count;
+        return SinkCombineResultType::FINISHED;
+    }
+
     SinkFinalizeType Finalize(Pipeline &pipeline, Event &event, ClientContext &context,
                               OperatorSinkFinalizeInput &input) const override {
         auto &gstate = input.global_state.Cast<ColumnstoreDeleteGlobalState>();
         table.Delete(context, gstate.row_ids);
+        table.DeleteDataFiles(covered_data_files);
+        for (auto &data_file : covered_data_files) {
+            gstate.delete_count += NumericCast<idx_t>(data_file.row_count) - data_file.deleted_rows.size();
+        }
         return SinkFinalizeType::READY;
     }
 
@@ -63,16 +90,52 @@ public:
         return make_uniq<ColumnstoreDeleteGlobalState>();
     }
 
+    unique_ptr<LocalSinkState> GetLocalSinkState(ExecutionContext &context) const override {
+        return make_uniq<ColumnstoreDeleteLocalState>();
+    }
+
     bool IsSink() const override {
         return true;
     }
+
+    bool ParallelSink() const override {
+        return true;
+    }
 };
 
+namespace {
+
+// The scan whose filters alone decide which rows are deleted, if any
+optional_ptr<PhysicalTableScan> GetFilteredScan(PhysicalOperator &op) {
+    if (op.type == PhysicalOperatorType::PROJECTION) {
+        return GetFilteredScan(*op.children[0]);
+    }
+    if (op.type != PhysicalOperatorType::TABLE_SCAN) {
+        return nullptr;
+    }
+    auto &scan = op.Cast<PhysicalTableScan>();
+    if (scan.function.name != "columnstore_scan" || !scan.table_filters || scan.table_filters->filters.empty()) {
+        return nullptr;
+    }
+    return scan;
+}
+
+} // namespace
+
 unique_ptr<PhysicalOperator> Columnstore::PlanDelete(ClientContext &context, LogicalDelete &op,
                                                      unique_ptr<PhysicalOperator> plan) {
+    auto &table = op.table.Cast<ColumnstoreTable>();
+    // Data files whose stats show that every row matches the filters are dropped as a whole instead of scanned, e.g.
+    // for retention deletes on a time column
+    vector<ColumnstoreDataFile> covered_data_files;
+    auto scan = GetFilteredScan(*plan);
+    if (scan && !op.return_chunk) {
+        scan->function = table.GetDeleteScanFunction(context, scan->bind_data, scan->column_ids,
+                                                     *scan->table_filters, covered_data_files);
+    }
     auto &bound_ref = op.expressions[0]->Cast<BoundReferenceExpression>();
-    auto del = make_uniq<ColumnstoreDelete>(op.types, op.estimated_cardinality, op.table.Cast<ColumnstoreTable>(),
-                                            bound_ref.index);
+    auto del = make_uniq<ColumnstoreDelete>(op.types, op.estimated_cardinality, table, bound_ref.index,
+                                            std::move(covered_data_files));
     del->children.push_back(std::move(plan));
     return std::move(del);
 }
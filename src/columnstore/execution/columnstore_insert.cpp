@@ -1,32 +1,76 @@
 #include "columnstore/columnstore.hpp"
 #include "columnstore/columnstore_table.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "duckdb/common/types/column/column_data_collection.hpp"
+#include "duckdb/execution/physical_operator.hpp"
 #include "duckdb/planner/operator/logical_insert.hpp"
+#include "pgmooncake_guc.hpp"
 
 namespace duckdb {
 
 class ColumnstoreInsertGlobalState : public GlobalSinkState {
 public:
-    ColumnstoreInsertGlobalState(ClientContext &context, const vector<LogicalType> &types,
-                                 const vector<unique_ptr<Expression>> &bound_defaults)
-        : executor(context, bound_defaults), insert_count(0) {
+    ColumnstoreInsertGlobalState(string path, ColumnstoreStorageOptions options, idx_t buffer_rows)
+        : path(std::move(path)), options(std::move(options)), buffer_rows(buffer_rows), buffered_count(0),
+          insert_count(0) {}
+
+    string path;
+    ColumnstoreStorageOptions options;
+    // Inserts of at most this many rows go to the write buffer
+    idx_t buffer_rows;
+    // Rows held back by all threads, once it passes buffer_rows every thread writes data files instead
+    atomic<idx_t> buffered_count;
+    mutex lock;
+    vector<ColumnstoreDataFile> data_files;
+    unique_ptr<ColumnDataCollection> buffer;
+    idx_t insert_count;
+};
+
+class ColumnstoreInsertLocalState : public LocalSinkState {
+public:
+    ColumnstoreInsertLocalState(ClientContext &context, const vector<unique_ptr<Expression>> &bound_defaults,
+                                const string &path, const vector<LogicalType> &types, const vector<string> &names,
+                                const ColumnstoreStorageOptions &options, bool use_buffer)
+        : executor(context, bound_defaults), writer(path, types, names, options), insert_count(0) {
         chunk.Initialize(Allocator::Get(context), types);
+        if (use_buffer) {
+            buffer = make_uniq<ColumnDataCollection>(context, types);
+        }
+    }
+
+    // Writes out the rows held back for the write buffer once they no longer fit in it
+    void SpillBuffer(ClientContext &context) {
+        ColumnDataScanState scan_state;
+        buffer->InitializeScan(scan_state);
+        DataChunk buffered_chunk;
+        buffer->InitializeScanChunk(buffered_chunk);
+        while (buffer->Scan(scan_state, buffered_chunk)) {
+            writer.Write(context, buffered_chunk);
+        }
+        buffer.reset();
     }
 
     DataChunk chunk;
     ExpressionExecutor executor;
+    ColumnstoreWriter writer;
+    unique_ptr<ColumnDataCollection> buffer;
     idx_t insert_count;
 };
 
 class ColumnstoreInsert : public PhysicalOperator {
 public:
     ColumnstoreInsert(vector<LogicalType> types, idx_t estimated_cardinality, ColumnstoreTable &table,
-                      physical_index_vector_t<idx_t> column_index_map, vector<unique_ptr<Expression>> bound_defaults)
+                      physical_index_vector_t<idx_t> column_index_map, vector<unique_ptr<Expression>> bound_defaults,
+                      bool parallel)
         : PhysicalOperator(PhysicalOperatorType::EXTENSION, std::move(types), estimated_cardinality), table(table),
-          column_index_map(std::move(column_index_map)), bound_defaults(std::move(bound_defaults)) {}
+          column_index_map(std::move(column_index_map)), bound_defaults(std::move(bound_defaults)),
+          parallel(parallel) {}
 
     ColumnstoreTable &table;
     physical_index_vector_t<idx_t> column_index_map;
     vector<unique_ptr<Expression>> bound_defaults;
+    // Whether every thread writes its own data files
+    bool parallel;
 
 public:
     string GetName() const override {
@@ -50,10 +94,11 @@ public:
     // Sink interface
     SinkResultType Sink(ExecutionContext &context, DataChunk &chunk, OperatorSinkInput &input) const override {
         auto &gstate = input.global_state.Cast<ColumnstoreInsertGlobalState>();
+        auto &lstate = input.local_state.Cast<ColumnstoreInsertLocalState>();
         chunk.Flatten();
-        gstate.executor.SetChunk(chunk);
-        gstate.chunk.Reset();
-        gstate.chunk.SetCardinality(chunk);
+        lstate.executor.SetChunk(chunk);
+        lstate.chunk.Reset();
+        lstate.chunk.SetCardinality(chunk);
         if (!column_index_map.empty()) {
             // columns specified by the user, use column_index_map
             for (auto &col : table.GetColumns().Physical()) {
@@ -61,45 +106,120 @@ public:
                 auto mapped_index = column_index_map[col.Physical()];
                 if (mapped_index == DConstants::INVALID_INDEX) {
                     // insert default value
-                    gstate.executor.ExecuteExpression(storage_idx, gstate.chunk.data[storage_idx]);
+                    lstate.executor.ExecuteExpression(storage_idx, lstate.chunk.data[storage_idx]);
                 } else {
                     // get value from child chunk
                     D_ASSERT(mapped_index < chunk.ColumnCount());
-                    D_ASSERT(gstate.chunk.data[storage_idx].GetType() == chunk.data[mapped_index].GetType());
-                    gstate.chunk.data[storage_idx].Reference(chunk.data[mapped_index]);
+                    D_ASSERT(lstate.chunk.data[storage_idx].GetType() == chunk.data[mapped_index].GetType());
+                    lstate.chunk.data[storage_idx].Reference(chunk.data[mapped_index]);
                 }
             }
         } else {
             // no columns specified, just append directly
-            for (idx_t i = 0; i < gstate.chunk.ColumnCount(); i++) {
-                D_ASSERT(gstate.chunk.data[i].GetType() == chunk.data[i].GetType());
-                gstate.chunk.data[i].Reference(chunk.data[i]);
+            for (idx_t i = 0; i < lstate.chunk.ColumnCount(); i++) {
+                D_ASSERT(lstate.chunk.data[i].GetType() == chunk.data[i].GetType());
+                lstate.chunk.data[i].Reference(chunk.data[i]);
             }
         }
-        gstate.insert_count += gstate.chunk.size();
-        table.Insert(context.client, gstate.chunk);
+        lstate.insert_count += lstate.chunk.size();
+        if (lstate.buffer) {
+            lstate.buffer->Append(lstate.chunk);
+            if (gstate.buffered_count.fetch_add(lstate.chunk.size()) + lstate.chunk.size() > gstate.buffer_rows) {
+                lstate.SpillBuffer(context.client);
+            }
+        } else {
+            lstate.writer.Write(context.client, lstate.chunk);
+        }
         return SinkResultType::NEED_MORE_INPUT;
     }
 
+    SinkCombineResultType Combine(ExecutionContext &context, OperatorSinkCombineInput &input) const override {
+        auto &gstate = input.global_state.Cast<ColumnstoreInsertGlobalState>();
+        auto &lstate = input.local_state.Cast<ColumnstoreInsertLocalState>();
+        if (lstate.buffer && gstate.buffered_count > gstate.buffer_rows) {
+            lstate.SpillBuffer(context.client);
+        }
+        auto data_files = lstate.writer.Finalize();
+        lock_guard<mutex> guard(gstate.lock);
+        gstate.insert_count += lstate.insert_count;
+        gstate.data_files.insert(gstate.data_files.end(), data_files.begin(), data_files.end());
+        if (lstate.buffer && lstate.buffer->Count() > 0) {
+            if (gstate.buffer) {
+                gstate.buffer->Combine(*lstate.buffer);
+            } else {
+                gstate.buffer = std::move(lstate.buffer);
+            }
+        }
+        return SinkCombineResultType::FINISHED;
+    }
+
+    // Catalog and lake changes must happen on a single thread, so data files are only registered here
     SinkFinalizeType Finalize(Pipeline &pipeline, Event &event, ClientContext &context,
                               OperatorSinkFinalizeInput &input) const override {
-        table.FinalizeInsert();
+        auto &gstate = input.global_state.Cast<ColumnstoreInsertGlobalState>();
+        table.AddDataFiles(gstate.data_files);
+        if (!gstate.buffer) {
+            return SinkFinalizeType::READY;
+        }
+        // Threads that combined before another one passed buffer_rows left their rows here
+        if (gstate.buffer->Count() > gstate.buffer_rows) {
+            ColumnDataScanState scan_state;
+            gstate.buffer->InitializeScan(scan_state);
+            DataChunk chunk;
+            gstate.buffer->InitializeScanChunk(chunk);
+            while (gstate.buffer->Scan(scan_state, chunk)) {
+                table.Insert(context, chunk);
+            }
+            table.FinalizeInsert();
+        } else {
+            table.BufferInsert(context, *gstate.buffer);
+        }
         return SinkFinalizeType::READY;
     }
 
     unique_ptr<GlobalSinkState> GetGlobalSinkState(ClientContext &context) const override {
-        return make_uniq<ColumnstoreInsertGlobalState>(context, table.GetTypes(), bound_defaults);
+        return make_uniq<ColumnstoreInsertGlobalState>(table.GetPath(), table.GetStorageOptions(),
+                                                       NumericCast<idx_t>(mooncake_write_buffer_rows));
+    }
+
+    unique_ptr<LocalSinkState> GetLocalSinkState(ExecutionContext &context) const override {
+        auto &gstate = sink_state->Cast<ColumnstoreInsertGlobalState>();
+        return make_uniq<ColumnstoreInsertLocalState>(context.client, bound_defaults, gstate.path, table.GetTypes(),
+                                                      table.GetColumns().GetColumnNames(), gstate.options,
+                                                      gstate.buffer_rows > 0);
     }
 
     bool IsSink() const override {
         return true;
     }
+
+    bool ParallelSink() const override {
+        return parallel;
+    }
 };
 
+namespace {
+
+// Columnstore tables don't promise insertion order, only an explicit ORDER BY in the source pins a single writer
+bool RequiresFixedOrder(PhysicalOperator &op) {
+    if (op.IsSource()) {
+        return op.SourceOrder() == OrderPreservationType::FIXED_ORDER;
+    }
+    for (auto &child : op.children) {
+        if (RequiresFixedOrder(*child)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 unique_ptr<PhysicalOperator> Columnstore::PlanInsert(ClientContext &context, LogicalInsert &op,
                                                      unique_ptr<PhysicalOperator> plan) {
+    bool parallel = !RequiresFixedOrder(*plan);
     auto insert = make_uniq<ColumnstoreInsert>(op.types, op.estimated_cardinality, op.table.Cast<ColumnstoreTable>(),
-                                               op.column_index_map, std::move(op.bound_defaults));
+                                               op.column_index_map, std::move(op.bound_defaults), parallel);
     insert->children.push_back(std::move(plan));
     return std::move(insert);
 }
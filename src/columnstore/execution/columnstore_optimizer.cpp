@@ -0,0 +1,160 @@
+#include "columnstore/columnstore.hpp"
+#include "columnstore/columnstore_statistics.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "duckdb/optimizer/optimizer.hpp"
+#include "duckdb/planner/expression/bound_aggregate_expression.hpp"
+#include "duckdb/planner/expression/bound_columnref_expression.hpp"
+#include "duckdb/planner/expression/bound_constant_expression.hpp"
+#include "duckdb/planner/operator/logical_aggregate.hpp"
+#include "duckdb/planner/operator/logical_dummy_scan.hpp"
+#include "duckdb/planner/operator/logical_get.hpp"
+#include "duckdb/planner/operator/logical_projection.hpp"
+
+namespace duckdb {
+
+namespace {
+
+// The data files a metadata-only answer is computed over, together with what is known about them
+struct MetadataScan {
+    LogicalGet &get;
+    ColumnstoreScanInfo &scan_info;
+    // Data files that may hold matching rows, each of which matches the filters in full
+    vector<reference<ColumnstoreDataFile>> data_files;
+    bool has_filters;
+};
+
+// Table column id of a column of the scan, or COLUMN_IDENTIFIER_ROW_ID
+column_t GetColumnId(LogicalGet &get, const Expression &expr) {
+    auto &column_ref = expr.Cast<BoundColumnRefExpression>();
+    idx_t index = column_ref.binding.column_index;
+    if (!get.projection_ids.empty()) {
+        index = get.projection_ids[index];
+    }
+    return get.column_ids[index];
+}
+
+const ColumnstoreColumnStats *FindColumnStats(const ColumnstoreDataFile &data_file, const string &column_name) {
+    auto it = std::find_if(data_file.column_stats.begin(), data_file.column_stats.end(),
+                           [&](const ColumnstoreColumnStats &stats) { return stats.column_name == column_name; });
+    return it != data_file.column_stats.end() ? &*it : nullptr;
+}
+
+// Answers count(*), count(column), min(column) and max(column) from the catalog, returns false if that's not possible.
+// Deletion vectors and buffered files only keep count(*) exact.
+bool TryComputeAggregate(MetadataScan &scan, BoundAggregateExpression &aggregate, Value &result /*out*/) {
+    if (aggregate.filter || aggregate.IsDistinct() || aggregate.order_bys) {
+        return false;
+    }
+    auto &name = aggregate.function.name;
+    if (name == "count_star") {
+        if (scan.has_filters && scan.scan_info.has_buffered_files) {
+            return false;
+        }
+        int64_t count = scan.has_filters ? 0 : scan.scan_info.buffered_row_count;
+        for (ColumnstoreDataFile &data_file : scan.data_files) {
+            count += data_file.row_count - NumericCast<int64_t>(data_file.deleted_rows.size());
+        }
+        result = Value::BIGINT(count);
+        return true;
+    }
+    if ((name != "count" && name != "min" && name != "max") || aggregate.children.size() != 1 ||
+        aggregate.children[0]->type != ExpressionType::BOUND_COLUMN_REF || scan.scan_info.has_buffered_files) {
+        return false;
+    }
+    column_t column_id = GetColumnId(scan.get, *aggregate.children[0]);
+    if (IsRowIdColumnId(column_id)) {
+        return false;
+    }
+    auto &column_name = scan.get.names[column_id];
+    int64_t count = 0;
+    Value min_max(aggregate.return_type);
+    for (ColumnstoreDataFile &data_file : scan.data_files) {
+        // Deleted rows are still covered by the stats of their file
+        auto stats = FindColumnStats(data_file, column_name);
+        if (!data_file.deleted_rows.empty() || !stats || stats->null_count < 0) {
+            return false;
+        }
+        count += data_file.row_count - stats->null_count;
+        if (name == "count" || stats->null_count == data_file.row_count) {
+            continue;
+        }
+        if (!stats->has_min_max) {
+            return false;
+        }
+        Value value;
+        if (!Value(name == "min" ? stats->min_value : stats->max_value)
+                 .DefaultTryCastAs(aggregate.return_type, value, nullptr /*error_message*/)) {
+            return false;
+        }
+        if (min_max.IsNull() || (name == "min" ? value < min_max : value > min_max)) {
+            min_max = std::move(value);
+        }
+    }
+    result = name == "count" ? Value::BIGINT(count) : std::move(min_max);
+    return true;
+}
+
+// Splits the data files of a columnstore scan into those that match its filters in full and those that don't match at
+// all, returns false if a file may match only in part
+bool GetMetadataScan(LogicalOperator &op, unique_ptr<MetadataScan> &scan /*out*/) {
+    if (op.type != LogicalOperatorType::LOGICAL_GET) {
+        return false;
+    }
+    auto &get = op.Cast<LogicalGet>();
+    if (get.function.name != "columnstore_scan" || !get.function.function_info) {
+        return false;
+    }
+    auto &scan_info = get.function.function_info->Cast<ColumnstoreScanInfo>();
+    bool has_filters = !get.table_filters.filters.empty();
+    scan = make_uniq<MetadataScan>(MetadataScan{get, scan_info, {}, has_filters});
+    for (auto &data_file : scan_info.data_files) {
+        auto partition_values = GetPartitionValues(data_file.file_name);
+        if (has_filters && !DataFileIsCovered(data_file.column_stats, partition_values, get.names, get.returned_types,
+                                              get.column_ids, get.table_filters)) {
+            if (DataFileMayMatch(data_file.column_stats, partition_values, get.names, get.returned_types,
+                                 get.column_ids, get.table_filters)) {
+                return false;
+            }
+            continue;
+        }
+        scan->data_files.push_back(data_file);
+    }
+    return true;
+}
+
+void OptimizeAggregate(OptimizerExtensionInput &input, unique_ptr<LogicalOperator> &plan) {
+    auto &aggregate = plan->Cast<LogicalAggregate>();
+    if (!aggregate.groups.empty() || !aggregate.grouping_functions.empty() || aggregate.children.size() != 1) {
+        return;
+    }
+    unique_ptr<MetadataScan> scan;
+    if (!GetMetadataScan(*aggregate.children[0], scan)) {
+        return;
+    }
+    vector<unique_ptr<Expression>> select_list;
+    for (auto &expr : aggregate.expressions) {
+        Value value;
+        if (!TryComputeAggregate(*scan, expr->Cast<BoundAggregateExpression>(), value)) {
+            return;
+        }
+        select_list.push_back(make_uniq<BoundConstantExpression>(std::move(value)));
+    }
+    auto projection = make_uniq<LogicalProjection>(aggregate.aggregate_index, std::move(select_list));
+    projection->children.push_back(make_uniq<LogicalDummyScan>(input.optimizer.binder.GenerateTableIndex()));
+    plan = std::move(projection);
+}
+
+} // namespace
+
+// Answers ungrouped count/min/max over a columnstore table from the row counts and column stats of its data files, so
+// no data file is read. Filters are fine as long as every data file matches them either in full or not at all.
+void Columnstore::Optimize(OptimizerExtensionInput &input, unique_ptr<LogicalOperator> &plan) {
+    for (auto &child : plan->children) {
+        Optimize(input, child);
+    }
+    if (plan->type == LogicalOperatorType::LOGICAL_AGGREGATE_AND_GROUP_BY) {
+        OptimizeAggregate(input, plan);
+    }
+}
+
+} // namespace duckdb
@@ -1,12 +1,77 @@
+#include "columnstore/columnstore_footer_cache.hpp"
 #include "columnstore/columnstore_metadata.hpp"
+#include "columnstore/columnstore_statistics.hpp"
 #include "columnstore/columnstore_table.hpp"
+#include "columnstore/columnstore_writer.hpp"
 #include "duckdb/catalog/catalog_entry/table_function_catalog_entry.hpp"
 #include "duckdb/common/multi_file_reader.hpp"
 #include "duckdb/main/extension_util.hpp"
 #include "duckdb/parser/tableref/table_function_ref.hpp"
+#include "duckdb/planner/table_filter.hpp"
 
 namespace duckdb {
 
+using DeletedRows = shared_ptr<const vector<uint32_t>>;
+
+// Data files of a scan along with their column stats, partition values and deletion vectors, so files can be pruned
+// before their footers are read. Files keep their position in ColumnstoreTable::GetFiles as file number, which row ids
+// are built from.
+class ColumnstoreFileList : public SimpleMultiFileList {
+public:
+    ColumnstoreFileList(ClientContext &context, vector<string> file_paths, vector<idx_t> file_numbers,
+                        vector<vector<ColumnstoreColumnStats>> file_stats,
+                        vector<vector<std::pair<string, Value>>> file_partition_values,
+                        vector<DeletedRows> file_deleted_rows)
+        : SimpleMultiFileList(std::move(file_paths)), context(context), file_numbers(std::move(file_numbers)),
+          file_stats(std::move(file_stats)), file_partition_values(std::move(file_partition_values)),
+          file_deleted_rows(std::move(file_deleted_rows)) {}
+
+    unique_ptr<MultiFileList> DynamicFilterPushdown(ClientContext &context, const MultiFileReaderOptions &options,
+                                                    const vector<string> &names, const vector<LogicalType> &types,
+                                                    const vector<column_t> &column_ids,
+                                                    TableFilterSet &filters) const override {
+        auto file_paths = GetPaths();
+        vector<string> new_file_paths;
+        vector<idx_t> new_file_numbers;
+        vector<vector<ColumnstoreColumnStats>> new_file_stats;
+        vector<vector<std::pair<string, Value>>> new_file_partition_values;
+        vector<DeletedRows> new_file_deleted_rows;
+        for (idx_t i = 0; i < file_paths.size(); i++) {
+            if (DataFileMayMatch(file_stats[i], file_partition_values[i], names, types, column_ids, filters)) {
+                new_file_paths.push_back(file_paths[i]);
+                new_file_numbers.push_back(file_numbers[i]);
+                new_file_stats.push_back(file_stats[i]);
+                new_file_partition_values.push_back(file_partition_values[i]);
+                new_file_deleted_rows.push_back(file_deleted_rows[i]);
+            }
+        }
+        if (new_file_paths.size() == file_paths.size()) {
+            return nullptr;
+        }
+        return make_uniq<ColumnstoreFileList>(context, std::move(new_file_paths), std::move(new_file_numbers),
+                                              std::move(new_file_stats), std::move(new_file_partition_values),
+                                              std::move(new_file_deleted_rows));
+    }
+
+protected:
+    // parquet_scan opens each file right after getting its path, so this is the last chance to supply its footer
+    string GetFileInternal(idx_t i) override {
+        string file_path = SimpleMultiFileList::GetFileInternal(i);
+        if (!file_path.empty()) {
+            ColumnstoreFooterCache::Load(context, file_path);
+        }
+        return file_path;
+    }
+
+public:
+    ClientContext &context;
+    vector<idx_t> file_numbers;
+    vector<vector<ColumnstoreColumnStats>> file_stats;
+    vector<vector<std::pair<string, Value>>> file_partition_values;
+    // nullptr for files without deleted rows
+    vector<DeletedRows> file_deleted_rows;
+};
+
 struct ColumnstoreScanMultiFileReaderGlobalState : public MultiFileReaderGlobalState {
     ColumnstoreScanMultiFileReaderGlobalState(vector<LogicalType> extra_columns,
                                               optional_ptr<const MultiFileList> file_list)
@@ -14,7 +79,8 @@ struct ColumnstoreScanMultiFileReaderGlobalState : public MultiFileReaderGlobalS
 
     idx_t row_id_index = DConstants::INVALID_INDEX;
     idx_t file_row_number_index = DConstants::INVALID_INDEX;
-    unique_ptr<Vector> row_ids;
+    vector<idx_t> file_numbers;
+    vector<DeletedRows> file_deleted_rows;
 };
 
 struct ColumnstoreScanMultiFileReader : public MultiFileReader {
@@ -22,26 +88,56 @@ struct ColumnstoreScanMultiFileReader : public MultiFileReader {
         return std::move(make_uniq<ColumnstoreScanMultiFileReader>());
     }
 
+    // GetScanFunction passes its ColumnstoreFileList by pointer instead of a list of paths
+    shared_ptr<MultiFileList> CreateFileList(ClientContext &context, const Value &input,
+                                             FileGlobOptions options) override {
+        auto &file_list = *reinterpret_cast<ColumnstoreFileList *>(input.GetPointer());
+        return make_shared_ptr<ColumnstoreFileList>(context, file_list.GetPaths(), file_list.file_numbers,
+                                                    file_list.file_stats, file_list.file_partition_values,
+                                                    file_list.file_deleted_rows);
+    }
+
     unique_ptr<MultiFileReaderGlobalState>
     InitializeGlobalState(ClientContext &context, const MultiFileReaderOptions &file_options,
                           const MultiFileReaderBindData &bind_data, const MultiFileList &file_list,
                           const vector<LogicalType> &global_types, const vector<string> &global_names,
                           const vector<column_t> &global_column_ids) override {
+        auto &columnstore_file_list = static_cast<const ColumnstoreFileList &>(file_list);
         auto it = std::find_if(global_column_ids.begin(), global_column_ids.end(),
                                [](column_t global_column_id) { return IsRowIdColumnId(global_column_id); });
+        bool has_deleted_rows =
+            std::any_of(columnstore_file_list.file_deleted_rows.begin(), columnstore_file_list.file_deleted_rows.end(),
+                        [](const DeletedRows &deleted_rows) { return deleted_rows != nullptr; });
+        // Both row ids and deletion vectors need the file row number of every row
         vector<LogicalType> extra_columns;
-        if (it != global_column_ids.end()) {
+        if (it != global_column_ids.end() || has_deleted_rows) {
             extra_columns.push_back(LogicalType::BIGINT);
         }
         auto global_state = make_uniq<ColumnstoreScanMultiFileReaderGlobalState>(std::move(extra_columns), file_list);
         if (it != global_column_ids.end()) {
             global_state->row_id_index = NumericCast<idx_t>(std::distance(global_column_ids.begin(), it));
+            global_state->file_numbers = columnstore_file_list.file_numbers;
+        }
+        if (it != global_column_ids.end() || has_deleted_rows) {
             global_state->file_row_number_index = global_column_ids.size();
-            global_state->row_ids = make_uniq<Vector>(LogicalType::BIGINT);
+        }
+        if (has_deleted_rows) {
+            global_state->file_deleted_rows = columnstore_file_list.file_deleted_rows;
         }
         return std::move(global_state);
     }
 
+    void FinalizeBind(const MultiFileReaderOptions &file_options, const MultiFileReaderBindData &options,
+                      const string &filename, const vector<string> &local_names,
+                      const vector<LogicalType> &global_types, const vector<string> &global_names,
+                      const vector<column_t> &global_column_ids, MultiFileReaderData &reader_data,
+                      ClientContext &context, optional_ptr<MultiFileReaderGlobalState> global_state) override {
+        MultiFileReader::FinalizeBind(file_options, options, filename, local_names, global_types, global_names,
+                                      global_column_ids, reader_data, context, global_state);
+        // The reader of this file has just read its footer
+        ColumnstoreFooterCache::Store(context, filename);
+    }
+
     void CreateMapping(const string &file_name, const vector<LogicalType> &local_types,
                        const vector<string> &local_names, const vector<LogicalType> &global_types,
                        const vector<string> &global_names, const vector<column_t> &global_column_ids,
@@ -51,7 +147,7 @@ struct ColumnstoreScanMultiFileReader : public MultiFileReader {
         MultiFileReader::CreateMapping(file_name, local_types, local_names, global_types, global_names,
                                        global_column_ids, filters, reader_data, initial_file, options, global_state);
         auto &gstate = global_state->Cast<ColumnstoreScanMultiFileReaderGlobalState>();
-        if (gstate.row_id_index != DConstants::INVALID_INDEX) {
+        if (gstate.file_row_number_index != DConstants::INVALID_INDEX) {
             auto it = std::find_if(local_names.begin(), local_names.end(), [](const string &local_name) {
                 return StringUtil::CIEquals(local_name, "file_row_number");
             });
@@ -66,21 +162,102 @@ struct ColumnstoreScanMultiFileReader : public MultiFileReader {
                        optional_ptr<MultiFileReaderGlobalState> global_state) override {
         MultiFileReader::FinalizeChunk(context, bind_data, reader_data, chunk, global_state);
         auto &gstate = global_state->Cast<ColumnstoreScanMultiFileReaderGlobalState>();
+        if (gstate.file_row_number_index == DConstants::INVALID_INDEX) {
+            return;
+        }
+        auto &file_row_numbers = chunk.data[gstate.file_row_number_index];
+        file_row_numbers.Flatten(chunk.size());
+        auto file_row_numbers_data = FlatVector::GetData<int64_t>(file_row_numbers);
+        const idx_t file_list_idx = reader_data.file_list_idx.GetIndex();
         if (gstate.row_id_index != DConstants::INVALID_INDEX) {
-            auto &file_row_numbers = chunk.data[gstate.file_row_number_index];
-            file_row_numbers.Flatten(chunk.size());
-            auto file_row_numbers_data = FlatVector::GetData<int64_t>(file_row_numbers);
-            gstate.row_ids->SetVectorType(VectorType::FLAT_VECTOR);
-            auto row_ids_data = FlatVector::GetData<row_t>(*gstate.row_ids);
-            const idx_t file_number = NumericCast<int32_t>(reader_data.file_list_idx.GetIndex());
+            Vector row_ids(LogicalType::BIGINT);
+            auto row_ids_data = FlatVector::GetData<row_t>(row_ids);
+            const idx_t file_number = gstate.file_numbers[file_list_idx];
             for (idx_t i = 0; i < chunk.size(); i++) {
                 row_ids_data[i] = (file_number << 32) + NumericCast<uint32_t>(file_row_numbers_data[i]);
             }
-            chunk.data[gstate.row_id_index].Reference(*gstate.row_ids);
+            // Deleted rows get a NULL row id, ColumnstoreScan filters them out
+            if (!gstate.file_deleted_rows.empty() && gstate.file_deleted_rows[file_list_idx]) {
+                auto &deleted_rows = *gstate.file_deleted_rows[file_list_idx];
+                for (idx_t i = 0; i < chunk.size(); i++) {
+                    auto file_row_number = NumericCast<uint32_t>(file_row_numbers_data[i]);
+                    if (std::binary_search(deleted_rows.begin(), deleted_rows.end(), file_row_number)) {
+                        FlatVector::SetNull(row_ids, i, true);
+                    }
+                }
+            }
+            chunk.data[gstate.row_id_index].Reference(row_ids);
         }
     }
 };
 
+// Scans of files with deletion vectors always read row ids, appended to the requested columns if the query doesn't
+// ask for them
+struct ColumnstoreScanGlobalState : public GlobalTableFunctionState {
+    idx_t MaxThreads() const override {
+        return parquet_state->MaxThreads();
+    }
+
+    TableFunction parquet_scan;
+    vector<column_t> column_ids;
+    vector<idx_t> projection_ids;
+    unique_ptr<GlobalTableFunctionState> parquet_state;
+    // Index of the row ids in the chunks parquet_scan returns, which start with the output columns
+    idx_t row_id_index;
+};
+
+struct ColumnstoreScanLocalState : public LocalTableFunctionState {
+    // nullptr once parquet_scan has nothing left for this thread
+    unique_ptr<LocalTableFunctionState> parquet_state;
+    DataChunk chunk;
+};
+
+// Drops the rows FinalizeChunk marked deleted. A chunk without rows left is skipped rather than returned, since an
+// empty chunk would make parquet_scan skip the rest of the row group.
+void ColumnstoreScan(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+    auto &gstate = data.global_state->Cast<ColumnstoreScanGlobalState>();
+    auto &lstate = data.local_state->Cast<ColumnstoreScanLocalState>();
+    if (!lstate.parquet_state) {
+        return;
+    }
+    auto &chunk = lstate.chunk;
+    if (chunk.ColumnCount() == 0) {
+        auto types = output.GetTypes();
+        if (gstate.row_id_index == types.size()) {
+            types.push_back(LogicalType::BIGINT);
+        }
+        chunk.Initialize(context, types);
+    }
+    TableFunctionInput parquet_input(data.bind_data, lstate.parquet_state.get(), gstate.parquet_state.get());
+    while (true) {
+        chunk.Reset();
+        gstate.parquet_scan.function(context, parquet_input, chunk);
+        if (chunk.size() == 0) {
+            return;
+        }
+        UnifiedVectorFormat row_ids;
+        chunk.data[gstate.row_id_index].ToUnifiedFormat(chunk.size(), row_ids);
+        SelectionVector sel(chunk.size());
+        idx_t sel_size = 0;
+        for (idx_t i = 0; i < chunk.size(); i++) {
+            if (row_ids.validity.RowIsValid(row_ids.sel->get_index(i))) {
+                sel.set_index(sel_size++, i);
+            }
+        }
+        if (sel_size == 0) {
+            continue;
+        }
+        for (idx_t i = 0; i < output.ColumnCount(); i++) {
+            output.data[i].Reference(chunk.data[i]);
+        }
+        output.SetCardinality(chunk.size());
+        if (sel_size < chunk.size()) {
+            output.Slice(sel, sel_size);
+        }
+        return;
+    }
+}
+
 void EmptyColumnstoreScan(ClientContext &context, TableFunctionInput &data, DataChunk &output) {}
 
 TableFunction GetParquetScan(ClientContext &context) {
@@ -88,44 +265,135 @@ TableFunction GetParquetScan(ClientContext &context) {
         .functions.GetFunctionByArguments(context, {LogicalType::LIST(LogicalType::VARCHAR)});
 }
 
-unique_ptr<GlobalTableFunctionState> ColumnstoreScanInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
-    // UPDATE can generate duplicate global_column_ids which ParquetReader doesn't expect
+// UPDATE can generate duplicate global_column_ids which ParquetReader doesn't expect
+void DeduplicateColumnIds(TableFunctionInitInput &input, vector<column_t> &column_ids, vector<idx_t> &projection_ids) {
     unordered_map<column_t, idx_t> column_ids_map;
-    vector<column_t> column_ids;
     for (idx_t i = 0; i < input.column_ids.size(); i++) {
         if (column_ids_map.count(input.column_ids[i]) == 0) {
             column_ids_map[input.column_ids[i]] = column_ids.size();
             column_ids.push_back(input.column_ids[i]);
         }
     }
-    vector<idx_t> projection_ids(input.projection_ids);
+    projection_ids = input.projection_ids;
     for (idx_t i = 0; i < projection_ids.size(); i++) {
         projection_ids[i] = column_ids_map[input.column_ids[projection_ids[i]]];
     }
+}
 
+unique_ptr<GlobalTableFunctionState> ParquetScanInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+    vector<column_t> column_ids;
+    vector<idx_t> projection_ids;
+    DeduplicateColumnIds(input, column_ids, projection_ids);
     TableFunctionInitInput new_input(input.bind_data, column_ids, projection_ids, input.filters);
     return GetParquetScan(context).init_global(context, new_input);
 }
 
-TableFunction ColumnstoreTable::GetScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data) {
-    auto path = metadata->TablesSearch(oid);
-    auto file_names = metadata->DataFilesSearch(oid);
-    auto file_paths = GetFilePaths(path, file_names);
+unique_ptr<GlobalTableFunctionState> ColumnstoreScanInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+    auto result = make_uniq<ColumnstoreScanGlobalState>();
+    result->parquet_scan = GetParquetScan(context);
+    vector<idx_t> projection_ids;
+    DeduplicateColumnIds(input, result->column_ids, projection_ids);
+    // parquet_scan returns the output columns, followed by the row ids unless they are one of them
+    auto &column_ids = result->column_ids;
+    if (projection_ids.empty()) {
+        for (auto column_id : input.column_ids) {
+            auto it = std::find(column_ids.begin(), column_ids.end(), column_id);
+            projection_ids.push_back(NumericCast<idx_t>(std::distance(column_ids.begin(), it)));
+        }
+    }
+    auto it = std::find_if(projection_ids.begin(), projection_ids.end(),
+                           [&](idx_t projection_id) { return IsRowIdColumnId(column_ids[projection_id]); });
+    result->row_id_index = NumericCast<idx_t>(std::distance(projection_ids.begin(), it));
+    if (it == projection_ids.end()) {
+        auto column_it = std::find_if(column_ids.begin(), column_ids.end(),
+                                      [](column_t column_id) { return IsRowIdColumnId(column_id); });
+        if (column_it == column_ids.end()) {
+            column_ids.push_back(COLUMN_IDENTIFIER_ROW_ID);
+            column_it = column_ids.end() - 1;
+        }
+        projection_ids.push_back(NumericCast<idx_t>(std::distance(column_ids.begin(), column_it)));
+    }
+    result->projection_ids = std::move(projection_ids);
+    TableFunctionInitInput new_input(input.bind_data, result->column_ids, result->projection_ids, input.filters);
+    result->parquet_state = result->parquet_scan.init_global(context, new_input);
+    return std::move(result);
+}
+
+unique_ptr<LocalTableFunctionState> ColumnstoreScanInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                             GlobalTableFunctionState *global_state) {
+    auto &gstate = global_state->Cast<ColumnstoreScanGlobalState>();
+    auto result = make_uniq<ColumnstoreScanLocalState>();
+    TableFunctionInitInput new_input(input.bind_data, gstate.column_ids, gstate.projection_ids, input.filters);
+    result->parquet_state = gstate.parquet_scan.init_local(context, new_input, gstate.parquet_state.get());
+    return std::move(result);
+}
+
+double ColumnstoreScanProgress(ClientContext &context, const FunctionData *bind_data,
+                               const GlobalTableFunctionState *global_state) {
+    auto &gstate = global_state->Cast<ColumnstoreScanGlobalState>();
+    return gstate.parquet_scan.table_scan_progress(context, bind_data, gstate.parquet_state.get());
+}
+
+idx_t ColumnstoreScanGetBatchIndex(ClientContext &context, const FunctionData *bind_data,
+                                   LocalTableFunctionState *local_state, GlobalTableFunctionState *global_state) {
+    auto &gstate = global_state->Cast<ColumnstoreScanGlobalState>();
+    auto &lstate = local_state->Cast<ColumnstoreScanLocalState>();
+    return gstate.parquet_scan.get_batch_index(context, bind_data, lstate.parquet_state.get(),
+                                               gstate.parquet_state.get());
+}
+
+// file_numbers are the positions of data_files in ColumnstoreTable::GetFiles, where the first num_data_files of them
+// are data files and the rest buffered files
+TableFunction BindColumnstoreScan(ClientContext &context, unique_ptr<FunctionData> &bind_data,
+                                  vector<ColumnstoreDataFile> &data_files, vector<string> file_paths,
+                                  vector<idx_t> file_numbers, idx_t num_data_files) {
+    vector<ColumnstoreDataFile> scan_info_data_files(data_files.begin(), data_files.begin() + num_data_files);
+    int64_t buffered_row_count = 0;
+    for (idx_t i = num_data_files; i < data_files.size(); i++) {
+        buffered_row_count += data_files[i].row_count;
+    }
+    auto scan_info = make_shared_ptr<ColumnstoreScanInfo>(std::move(scan_info_data_files), buffered_row_count,
+                                                          num_data_files < data_files.size());
     if (file_paths.empty()) {
-        return TableFunction("columnstore_scan", {} /*arguments*/, EmptyColumnstoreScan);
+        TableFunction empty_scan("columnstore_scan", {} /*arguments*/, EmptyColumnstoreScan);
+        empty_scan.function_info = std::move(scan_info);
+        return empty_scan;
+    }
+    vector<vector<ColumnstoreColumnStats>> file_stats;
+    vector<vector<std::pair<string, Value>>> file_partition_values;
+    vector<DeletedRows> file_deleted_rows;
+    bool has_deleted_rows = false;
+    for (auto &data_file : data_files) {
+        has_deleted_rows |= !data_file.deleted_rows.empty();
+        file_stats.push_back(std::move(data_file.column_stats));
+        file_partition_values.push_back(GetPartitionValues(data_file.file_name));
+        file_deleted_rows.push_back(data_file.deleted_rows.empty()
+                                        ? nullptr
+                                        : make_shared_ptr<const vector<uint32_t>>(std::move(data_file.deleted_rows)));
     }
+    ColumnstoreFileList file_list(context, std::move(file_paths), std::move(file_numbers), std::move(file_stats),
+                                  std::move(file_partition_values), std::move(file_deleted_rows));
 
     TableFunction columnstore_scan = GetParquetScan(context);
     columnstore_scan.name = "columnstore_scan";
-    columnstore_scan.init_global = ColumnstoreScanInitGlobal;
+    if (has_deleted_rows) {
+        columnstore_scan.function = ColumnstoreScan;
+        columnstore_scan.init_global = ColumnstoreScanInitGlobal;
+        columnstore_scan.init_local = ColumnstoreScanInitLocal;
+        if (columnstore_scan.table_scan_progress) {
+            columnstore_scan.table_scan_progress = ColumnstoreScanProgress;
+        }
+        if (columnstore_scan.get_batch_index) {
+            columnstore_scan.get_batch_index = ColumnstoreScanGetBatchIndex;
+        }
+    } else {
+        columnstore_scan.init_global = ParquetScanInitGlobal;
+    }
     columnstore_scan.get_multi_file_reader = ColumnstoreScanMultiFileReader::Create;
+    columnstore_scan.function_info = std::move(scan_info);
 
-    vector<Value> values;
-    for (auto &file_path : file_paths) {
-        values.push_back(Value(file_path));
-    }
     vector<Value> inputs;
-    inputs.push_back(Value::LIST(values));
+    inputs.push_back(Value::POINTER(CastPointerToValue(&file_list)));
     named_parameter_map_t named_parameters{{"file_row_number", Value(true)}};
     vector<LogicalType> input_table_types;
     vector<string> input_table_names;
@@ -137,4 +405,103 @@ TableFunction ColumnstoreTable::GetScanFunction(ClientContext &context, unique_p
     return columnstore_scan;
 }
 
+namespace {
+
+// Merges the stats of a column over all data files, nullptr if some file has no min/max for it
+unique_ptr<BaseStatistics> MergeColumnStatistics(const vector<ColumnstoreDataFile> &data_files,
+                                                 const ColumnDefinition &column) {
+    unique_ptr<BaseStatistics> result;
+    bool has_null = false;
+    for (auto &data_file : data_files) {
+        auto it = std::find_if(data_file.column_stats.begin(), data_file.column_stats.end(),
+                               [&](const ColumnstoreColumnStats &stats) { return stats.column_name == column.Name(); });
+        if (it == data_file.column_stats.end()) {
+            return nullptr;
+        }
+        has_null |= it->null_count != 0;
+        // Columns that are all NULL have no min/max
+        if (it->null_count == data_file.row_count) {
+            continue;
+        }
+        auto stats = GetColumnStatistics(*it, column.Type());
+        if (!stats) {
+            return nullptr;
+        }
+        if (result) {
+            result->Merge(*stats);
+        } else {
+            result = std::move(stats);
+        }
+    }
+    if (!result) {
+        return nullptr;
+    }
+    result->Set(has_null ? StatsInfo::CAN_HAVE_NULL_VALUES : StatsInfo::CANNOT_HAVE_NULL_VALUES);
+    return result;
+}
+
+} // namespace
+
+// Merges the column stats of all data files. Rows removed by deletion vectors are still counted, which leaves the
+// result a valid (if loose) bound. The planner asks once per column, so the stats of every column are computed from a
+// single search of the catalog on the first call.
+unique_ptr<BaseStatistics> ColumnstoreTable::GetStatistics(ClientContext &context, column_t column_id) {
+    if (IsRowIdColumnId(column_id)) {
+        return nullptr;
+    }
+    lock_guard<mutex> guard(statistics_lock);
+    if (!has_statistics) {
+        // Buffered files have no column stats
+        if (metadata->BufferedFilesSearch(oid).empty()) {
+            auto data_files = metadata->DataFilesSearch(oid);
+            for (auto &column : columns.Logical()) {
+                column_statistics.push_back(MergeColumnStatistics(data_files, column));
+            }
+        }
+        has_statistics = true;
+    }
+    if (column_id >= column_statistics.size() || !column_statistics[column_id]) {
+        return nullptr;
+    }
+    return column_statistics[column_id]->ToUnique();
+}
+
+TableFunction ColumnstoreTable::GetScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data) {
+    vector<ColumnstoreDataFile> data_files;
+    vector<string> file_paths;
+    idx_t num_data_files = GetFiles(data_files, file_paths);
+    vector<idx_t> file_numbers(data_files.size());
+    std::iota(file_numbers.begin(), file_numbers.end(), 0);
+    return BindColumnstoreScan(context, bind_data, data_files, std::move(file_paths), std::move(file_numbers),
+                               num_data_files);
+}
+
+TableFunction ColumnstoreTable::GetDeleteScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data,
+                                                      const vector<column_t> &column_ids, TableFilterSet &filters,
+                                                      vector<ColumnstoreDataFile> &covered_data_files) {
+    vector<ColumnstoreDataFile> data_files;
+    vector<string> file_paths;
+    idx_t num_data_files = GetFiles(data_files, file_paths);
+    auto names = columns.GetColumnNames();
+    auto types = columns.GetColumnTypes();
+    vector<ColumnstoreDataFile> scanned_data_files;
+    vector<string> scanned_file_paths;
+    vector<idx_t> file_numbers;
+    for (idx_t i = 0; i < data_files.size(); i++) {
+        // Buffered files have no column stats, so are never covered
+        if (i < num_data_files && DataFileIsCovered(data_files[i].column_stats,
+                                                    GetPartitionValues(data_files[i].file_name), names, types,
+                                                    column_ids, filters)) {
+            covered_data_files.push_back(std::move(data_files[i]));
+        } else {
+            scanned_data_files.push_back(std::move(data_files[i]));
+            scanned_file_paths.push_back(std::move(file_paths[i]));
+            file_numbers.push_back(i);
+        }
+    }
+    idx_t num_scanned_data_files = scanned_data_files.size() - (data_files.size() - num_data_files);
+    return BindColumnstoreScan(context, bind_data, scanned_data_files, std::move(scanned_file_paths),
+                               std::move(file_numbers), num_scanned_data_files);
+}
+
 } // namespace duckdb
@@ -1,5 +1,7 @@
 #include "columnstore/columnstore.hpp"
+#include "columnstore/columnstore_row_id_set.hpp"
 #include "columnstore/columnstore_table.hpp"
+#include "duckdb/common/types/column/column_data_collection.hpp"
 #include "duckdb/execution/physical_operator.hpp"
 #include "duckdb/planner/operator/logical_update.hpp"
 
@@ -7,12 +9,25 @@ namespace duckdb {
 
 class ColumnstoreUpdateGlobalState : public GlobalSinkState {
 public:
-    ColumnstoreUpdateGlobalState(ClientContext &context, const vector<LogicalType> &types) {
+    mutex lock;
+    RowIdSet row_ids;
+    // New row images by the file number of their old images
+    unordered_map<idx_t, unique_ptr<ColumnDataCollection>> new_rows;
+    idx_t update_count = 0;
+};
+
+class ColumnstoreUpdateLocalState : public LocalSinkState {
+public:
+    ColumnstoreUpdateLocalState(ClientContext &context, const vector<LogicalType> &types) {
         chunk.Initialize(Allocator::Get(context), types);
+        file_chunk.InitializeEmpty(types);
     }
 
     DataChunk chunk;
-    vector<row_t> row_ids;
+    DataChunk file_chunk;
+    RowIdSet row_ids;
+    unordered_map<idx_t, unique_ptr<ColumnDataCollection>> new_rows;
+    idx_t update_count = 0;
 };
 
 class ColumnstoreUpdate : public PhysicalOperator {
@@ -35,7 +50,7 @@ public:
     SourceResultType GetData(ExecutionContext &context, DataChunk &chunk, OperatorSourceInput &input) const override {
         auto &gstate = sink_state->Cast<ColumnstoreUpdateGlobalState>();
         chunk.SetCardinality(1);
-        chunk.SetValue(0, 0, Value::BIGINT(NumericCast<int64_t>(gstate.row_ids.size())));
+        chunk.SetValue(0, 0, Value::BIGINT(NumericCast<int64_t>(gstate.update_count)));
         return SourceResultType::FINISHED;
     }
 
@@ -46,35 +61,84 @@ public:
 public:
     // Sink interface
     SinkResultType Sink(ExecutionContext &context, DataChunk &chunk, OperatorSinkInput &input) const override {
-        auto &gstate = input.global_state.Cast<ColumnstoreUpdateGlobalState>();
+        auto &lstate = input.local_state.Cast<ColumnstoreUpdateLocalState>();
         auto &row_ids = chunk.data[chunk.ColumnCount() - 1];
         row_ids.Flatten(chunk.size());
         auto row_ids_data = FlatVector::GetData<row_t>(row_ids);
         for (idx_t i = 0; i < chunk.size(); i++) {
-            gstate.row_ids.push_back(row_ids_data[i]);
+            lstate.row_ids.Add(row_ids_data[i]);
         }
-        gstate.chunk.SetCardinality(chunk);
+        lstate.update_count += chunk.size();
+        lstate.chunk.SetCardinality(chunk);
         for (idx_t i = 0; i < columns.size(); i++) {
-            gstate.chunk.data[columns[i].index].Reference(chunk.data[i]);
+            lstate.chunk.data[columns[i].index].Reference(chunk.data[i]);
+        }
+        // Scans emit the rows of a file together, so a chunk almost always comes from a single file
+        set<idx_t> file_numbers;
+        for (idx_t i = 0; i < chunk.size(); i++) {
+            file_numbers.insert(NumericCast<idx_t>(row_ids_data[i] >> 32));
+        }
+        SelectionVector sel(chunk.size());
+        for (idx_t file_number : file_numbers) {
+            auto &new_rows = lstate.new_rows[file_number];
+            if (!new_rows) {
+                new_rows = make_uniq<ColumnDataCollection>(context.client, table.GetTypes());
+            }
+            if (file_numbers.size() == 1) {
+                new_rows->Append(lstate.chunk);
+                break;
+            }
+            idx_t sel_size = 0;
+            for (idx_t i = 0; i < chunk.size(); i++) {
+                if (NumericCast<idx_t>(row_ids_data[i] >> 32) == file_number) {
+                    sel.set_index(sel_size++, i);
+                }
+            }
+            lstate.file_chunk.Slice(lstate.chunk, sel, sel_size);
+            new_rows->Append(lstate.file_chunk);
         }
-        table.Insert(context.client, gstate.chunk);
         return SinkResultType::NEED_MORE_INPUT;
     }
 
+    SinkCombineResultType Combine(ExecutionContext &context, OperatorSinkCombineInput &input) const override {
+        auto &gstate = input.global_state.Cast<ColumnstoreUpdateGlobalState>();
+        auto &lstate = input.local_state.Cast<ColumnstoreUpdateLocalState>();
+        lock_guard<mutex> guard(gstate.lock);
+        gstate.row_ids.Merge(std::move(lstate.row_ids));
+        for (auto &entry : lstate.new_rows) {
+            auto &new_rows = gstate.new_rows[entry.first];
+            if (new_rows) {
+                new_rows->Combine(*entry.second);
+            } else {
+                new_rows = std::move(entry.second);
+            }
+        }
+        gstate.update_count += lstate.update_count;
+        return SinkCombineResultType::FINISHED;
+    }
+
     SinkFinalizeType Finalize(Pipeline &pipeline, Event &event, ClientContext &context,
                               OperatorSinkFinalizeInput &input) const override {
         auto &gstate = input.global_state.Cast<ColumnstoreUpdateGlobalState>();
-        table.Delete(context, gstate.row_ids);
+        table.Update(context, gstate.row_ids, gstate.new_rows);
         return SinkFinalizeType::READY;
     }
 
     unique_ptr<GlobalSinkState> GetGlobalSinkState(ClientContext &context) const override {
-        return make_uniq<ColumnstoreUpdateGlobalState>(context, table.GetTypes());
+        return make_uniq<ColumnstoreUpdateGlobalState>();
+    }
+
+    unique_ptr<LocalSinkState> GetLocalSinkState(ExecutionContext &context) const override {
+        return make_uniq<ColumnstoreUpdateLocalState>(context.client, table.GetTypes());
     }
 
     bool IsSink() const override {
         return true;
     }
+
+    bool ParallelSink() const override {
+        return true;
+    }
 };
 
 unique_ptr<PhysicalOperator> Columnstore::PlanUpdate(ClientContext &context, LogicalUpdate &op,
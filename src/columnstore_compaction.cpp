@@ -0,0 +1,124 @@
+#include "columnstore/columnstore.hpp"
+#include "columnstore/columnstore_metadata.hpp"
+#include "columnstore_handler.hpp"
+#include "pgduckdb/pgduckdb_metadata_cache.hpp"
+#include "pgduckdb/utility/cpp_wrapper.hpp"
+#include "pgmooncake_guc.hpp"
+
+extern "C" {
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "tcop/tcopprot.h"
+#include "utils/acl.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+}
+
+namespace {
+
+// Each table is compacted in its own transaction, so a failure only skips that table until the next run
+void CompactTable(Oid oid) {
+    MemoryContext context = CurrentMemoryContext;
+    SetCurrentStatementStartTimestamp();
+    StartTransactionCommand();
+    PushActiveSnapshot(GetTransactionSnapshot());
+    pgstat_report_activity(STATE_RUNNING, "compacting columnstore table");
+    PG_TRY();
+    {
+        // mooncake.tables may still list tables that were dropped
+        if (SearchSysCacheExists1(RELOID, ObjectIdGetDatum(oid))) {
+            InvokeCPPFunc(duckdb::Columnstore::Compact, oid, false /*wait*/);
+        }
+        PopActiveSnapshot();
+        CommitTransactionCommand();
+    }
+    PG_CATCH();
+    {
+        MemoryContextSwitchTo(context);
+        EmitErrorReport();
+        FlushErrorState();
+        AbortCurrentTransaction();
+    }
+    PG_END_TRY();
+}
+
+} // namespace
+
+extern "C" {
+DECLARE_PG_FUNCTION(mooncake_compact) {
+    Oid oid = PG_GETARG_OID(0);
+    if (!IsColumnstoreTable(oid)) {
+        elog(ERROR, "%s is not a columnstore table", get_rel_name(oid));
+    }
+    if (pg_class_aclcheck(oid, GetUserId(), ACL_UPDATE) != ACLCHECK_OK) {
+        elog(ERROR, "permission denied for table %s", get_rel_name(oid));
+    }
+    duckdb::Columnstore::Compact(oid, true /*wait*/);
+    PG_RETURN_VOID();
+}
+
+PGDLLEXPORT void mooncake_compaction_worker_main(Datum /*main_arg*/) {
+    pqsignal(SIGHUP, SignalHandlerForConfigReload);
+    pqsignal(SIGTERM, die);
+    BackgroundWorkerUnblockSignals();
+
+    BackgroundWorkerInitializeConnection(mooncake_compaction_database, NULL, 0);
+
+    while (true) {
+        if (ConfigReloadPending) {
+            ConfigReloadPending = false;
+            ProcessConfigFile(PGC_SIGHUP);
+        }
+
+        duckdb::vector<Oid> oids;
+        SetCurrentStatementStartTimestamp();
+        StartTransactionCommand();
+        PushActiveSnapshot(GetTransactionSnapshot());
+        // Until the extension is installed this loop is a no-op
+        if (pgduckdb::IsExtensionRegistered()) {
+            oids = duckdb::ColumnstoreMetadata(NULL /*snapshot*/).TablesSearch();
+        }
+        PopActiveSnapshot();
+        CommitTransactionCommand();
+
+        for (Oid oid : oids) {
+            CHECK_FOR_INTERRUPTS();
+            CompactTable(oid);
+        }
+        pgstat_report_stat(false);
+        pgstat_report_activity(STATE_IDLE, NULL);
+
+        WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH, mooncake_compaction_naptime * 1000L,
+                  PG_WAIT_EXTENSION);
+        CHECK_FOR_INTERRUPTS();
+        ResetLatch(MyLatch);
+    }
+}
+}
+
+void MooncakeInitCompactionWorker() {
+    if (!process_shared_preload_libraries_in_progress || mooncake_compaction_database[0] == '\0') {
+        return;
+    }
+
+    BackgroundWorker worker;
+    MemSet(&worker, 0, sizeof(BackgroundWorker));
+    worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+    worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+    snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_mooncake");
+    snprintf(worker.bgw_function_name, BGW_MAXLEN, "mooncake_compaction_worker_main");
+    snprintf(worker.bgw_name, BGW_MAXLEN, "pg_mooncake compaction worker");
+    worker.bgw_restart_time = 10;
+    worker.bgw_main_arg = (Datum)0;
+    RegisterBackgroundWorker(&worker);
+}
@@ -197,17 +197,30 @@ void columnstore_index_validate_scan(Relation table_rel, Relation index_rel, str
     elog(ERROR, "columnstore_index_validate_scan not implemented");
 }
 
+// Data lives in the table's data files, there are no other forks
 uint64 columnstore_relation_size(Relation rel, ForkNumber forkNumber) {
-    elog(ERROR, "columnstore_relation_size not implemented");
+    if (forkNumber != MAIN_FORKNUM && forkNumber != InvalidForkNumber) {
+        return 0;
+    }
+    int64_t file_size;
+    int64_t row_count;
+    duckdb::Columnstore::GetTableSize(rel->rd_id, file_size, row_count);
+    return file_size;
 }
 
 bool columnstore_relation_needs_toast_table(Relation rel) {
     return false;
 }
 
+// Attribute widths are left to the planner's per-type defaults, file sizes only reflect compressed data
 void columnstore_relation_estimate_size(Relation rel, int32 *attr_widths, BlockNumber *pages, double *tuples,
                                         double *allvisfrac) {
-    // TODO: elog(NOTICE, "columnstore_relation_estimate_size not fully implemented");
+    int64_t file_size;
+    int64_t row_count;
+    duckdb::Columnstore::GetTableSize(rel->rd_id, file_size, row_count);
+    *pages = (file_size + BLCKSZ - 1) / BLCKSZ;
+    *tuples = row_count;
+    *allvisfrac = 1;
 }
 
 bool columnstore_scan_sample_next_block(TableScanDesc scan, struct SampleScanState *scanstate) {
@@ -1,13 +1,414 @@
 #include "columnstore/columnstore_metadata.hpp"
+#include "columnstore/columnstore_writer.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/hugeint.hpp"
+#include "duckdb/common/types/value.hpp"
 #include "duckdb/common/unordered_set.hpp"
+#include "lake/lake.hpp"
+#include "pgduckdb/pgduckdb_types.hpp"
 #include "rust_extensions/delta.hpp"
 
+extern "C" {
+#include "postgres.h"
+
+#include "access/table.h"
+#include "utils/inval.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+}
+
+#include <algorithm>
+#include <cmath>
+#include <set>
 #include <utility>
 
 namespace duckdb {
 
 namespace {
 
+string JsonQuote(const string &str) {
+    string result = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (uint8_t(c) < 0x20) {
+            result += StringUtil::Format("\\u%04x", uint8_t(c));
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+// Paths in the Delta log are URIs, so the escapes in partition directories (see EscapePartitionValue) are escaped
+// once more, as Spark does
+string GetDeltaPath(const string &file_name) {
+    return StringUtil::Replace(file_name, "%", "%25");
+}
+
+// partitionValues of the Add action of a data file, as a JSON object
+string GetPartitionValuesJson(const string &file_name) {
+    string result = "{";
+    for (auto &entry : GetPartitionValues(file_name)) {
+        if (result.size() > 1) {
+            result += ",";
+        }
+        result += JsonQuote(entry.first) + ":" +
+                  (entry.second.IsNull() ? "null" : JsonQuote(StringValue::Get(entry.second)));
+    }
+    return result + "}";
+}
+
+// Delta stats take timestamps in milliseconds, values from ColumnStatsCollector look like 2024-01-01 12:34:56.123456
+// (with +00 if WITH TIME ZONE). A max is only kept if truncating it loses nothing.
+bool GetTimestampStatsJson(const string &value, bool with_time_zone, bool is_max, string &result) {
+    string timestamp = value;
+    if (with_time_zone) {
+        if (!StringUtil::EndsWith(timestamp, "+00")) {
+            return false;
+        }
+        timestamp.resize(timestamp.size() - 3);
+    }
+    // Skips infinity and BC
+    if (timestamp.size() < 19 || timestamp[4] != '-' || timestamp[10] != ' ') {
+        return false;
+    }
+    string fraction = timestamp.size() > 20 ? timestamp.substr(20) : "";
+    if (is_max && fraction.find_first_not_of('0', 3) != string::npos) {
+        return false;
+    }
+    fraction.resize(3, '0');
+    timestamp[10] = 'T';
+    result = JsonQuote(timestamp.substr(0, 19) + "." + fraction + (with_time_zone ? "Z" : ""));
+    return true;
+}
+
+// Formats a min/max of ColumnstoreColumnStats as the JSON value Delta expects for a column of this Postgres type.
+// Columns the Delta table stores as strings although Parquet doesn't (see DeltaCreateTable) get none.
+bool GetStatsValueJson(const string &column_type, const string &value, bool is_max, string &result) {
+    if (column_type == "smallint" || column_type == "integer" || column_type == "bigint" || column_type == "real" ||
+        column_type == "double precision" || column_type == "numeric") {
+        char *end;
+        double number = strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || !std::isfinite(number)) {
+            return false;
+        }
+        result = value;
+        return true;
+    }
+    if (column_type == "text" || column_type == "character varying" || column_type == "date") {
+        result = JsonQuote(value);
+        return true;
+    }
+    if (column_type == "timestamp without time zone" || column_type == "timestamp with time zone") {
+        return GetTimestampStatsJson(value, column_type == "timestamp with time zone", is_max, result);
+    }
+    return false;
+}
+
+// stats of the Add action of a data file, as JSON. Partition columns are left out, their value is in the path.
+string GetStatsJson(const ColumnstoreDataFile &data_file, const unordered_map<string, string> &column_types,
+                    const unordered_set<string> &partition_columns) {
+    string min_values;
+    string max_values;
+    string null_counts;
+    for (auto &column_stats : data_file.column_stats) {
+        auto it = column_types.find(column_stats.column_name);
+        if (it == column_types.end() || partition_columns.count(column_stats.column_name)) {
+            continue;
+        }
+        string column_name = JsonQuote(column_stats.column_name);
+        if (column_stats.null_count >= 0) {
+            null_counts += (null_counts.empty() ? "" : ",") + column_name + ":" +
+                           std::to_string(column_stats.null_count);
+        }
+        string min_value;
+        string max_value;
+        if (column_stats.has_min_max && GetStatsValueJson(it->second, column_stats.min_value, false, min_value)) {
+            min_values += (min_values.empty() ? "" : ",") + column_name + ":" + min_value;
+        }
+        if (column_stats.has_min_max && GetStatsValueJson(it->second, column_stats.max_value, true, max_value)) {
+            max_values += (max_values.empty() ? "" : ",") + column_name + ":" + max_value;
+        }
+    }
+    return "{\"numRecords\":" + std::to_string(data_file.row_count) + ",\"minValues\":{" + min_values +
+           "},\"maxValues\":{" + max_values + "},\"nullCount\":{" + null_counts + "}}";
+}
+
+// Iceberg tables reuse the Parquet field IDs ColumnstoreWriter assigns: a column's ID is its attribute number, which
+// never changes since columnstore tables reject ALTER TABLE
+struct IcebergColumn {
+    int32_t field_id;
+    LogicalType type;
+};
+
+// Partition fields are numbered from 1000, as Iceberg does
+const int32_t x_iceberg_partition_field_id = 1000;
+
+// Types of the table's columns as ColumnstoreWriter writes them to Parquet
+vector<LogicalType> GetColumnTypes(Oid oid) {
+    ::Relation table = table_open(oid, AccessShareLock);
+    TupleDesc desc = RelationGetDescr(table);
+    vector<LogicalType> types;
+    for (int i = 0; i < desc->natts; i++) {
+        Form_pg_attribute attr = &desc->attrs[i];
+        types.push_back(pgduckdb::ConvertPostgresToDuckColumnType(attr));
+    }
+    table_close(table, AccessShareLock);
+    return types;
+}
+
+// Iceberg type of a column, as JSON. List elements take field IDs from next_id, in the order SetElementFieldIDs
+// numbers them in the data files.
+string GetIcebergType(const string &column_name, const LogicalType &type, int32_t &next_id) {
+    switch (type.id()) {
+    case LogicalTypeId::BOOLEAN:
+        return "\"boolean\"";
+    case LogicalTypeId::TINYINT:
+    case LogicalTypeId::SMALLINT:
+    case LogicalTypeId::INTEGER:
+        return "\"int\"";
+    case LogicalTypeId::BIGINT:
+        return "\"long\"";
+    case LogicalTypeId::FLOAT:
+        return "\"float\"";
+    case LogicalTypeId::DOUBLE:
+        return "\"double\"";
+    case LogicalTypeId::DECIMAL:
+        return StringUtil::Format("\"decimal(%d, %d)\"", DecimalType::GetWidth(type), DecimalType::GetScale(type));
+    case LogicalTypeId::VARCHAR:
+        return "\"string\"";
+    case LogicalTypeId::BLOB:
+        return "\"binary\"";
+    case LogicalTypeId::DATE:
+        return "\"date\"";
+    case LogicalTypeId::TIME:
+        return "\"time\"";
+    case LogicalTypeId::TIMESTAMP:
+        return "\"timestamp\"";
+    case LogicalTypeId::TIMESTAMP_TZ:
+        return "\"timestamptz\"";
+    case LogicalTypeId::UUID:
+        return "\"uuid\"";
+    case LogicalTypeId::LIST: {
+        int32_t element_id = next_id++;
+        return StringUtil::Format("{\"type\":\"list\",\"element-id\":%d,\"element\":%s,\"element-required\":false}",
+                                  element_id, GetIcebergType(column_name, ListType::GetChildType(type), next_id));
+    }
+    default:
+        throw NotImplementedException("Iceberg tables do not support column \"%s\" of type %s", column_name,
+                                      type.ToString());
+    }
+}
+
+string GetIcebergSchemaJson(const vector<string> &column_names, const vector<LogicalType> &column_types) {
+    string fields;
+    auto next_id = NumericCast<int32_t>(column_names.size()) + 1;
+    for (idx_t i = 0; i < column_names.size(); i++) {
+        string type = GetIcebergType(column_names[i], column_types[i], next_id);
+        fields += StringUtil::Format("%s{\"id\":%d,\"name\":%s,\"required\":false,\"type\":%s}", i ? "," : "",
+                                     i + 1, JsonQuote(column_names[i]), type);
+    }
+    return "{\"type\":\"struct\",\"schema-id\":0,\"fields\":[" + fields + "]}";
+}
+
+// Partitions of Iceberg tables are identity transforms of the partition columns
+string GetIcebergPartitionSpecJson(const vector<string> &column_names, const vector<string> &partition_by) {
+    string fields;
+    for (idx_t i = 0; i < partition_by.size(); i++) {
+        auto source_id =
+            std::find(column_names.begin(), column_names.end(), partition_by[i]) - column_names.begin() + 1;
+        fields += StringUtil::Format(
+            "%s{\"source-id\":%d,\"field-id\":%d,\"name\":%s,\"transform\":\"identity\"}", i ? "," : "", source_id,
+            x_iceberg_partition_field_id + NumericCast<int32_t>(i), JsonQuote(partition_by[i]));
+    }
+    return "[" + fields + "]";
+}
+
+string HexEncode(const string &bytes) {
+    string result;
+    for (char c : bytes) {
+        result += StringUtil::Format("%02x", uint8_t(c));
+    }
+    return result;
+}
+
+template <class T>
+string GetLittleEndianHex(T value) {
+    return HexEncode(string(const_char_ptr_cast(&value), sizeof(T)));
+}
+
+hugeint_t GetUnscaledDecimal(const Value &value) {
+    switch (value.type().InternalType()) {
+    case PhysicalType::INT16:
+        return value.GetValueUnsafe<int16_t>();
+    case PhysicalType::INT32:
+        return value.GetValueUnsafe<int32_t>();
+    case PhysicalType::INT64:
+        return value.GetValueUnsafe<int64_t>();
+    default:
+        return value.GetValueUnsafe<hugeint_t>();
+    }
+}
+
+// Decimals are serialized as their unscaled value in big-endian two's complement, in as few bytes as possible
+string GetDecimalHex(hugeint_t unscaled) {
+    uint8_t bytes[16];
+    for (idx_t i = 0; i < 8; i++) {
+        bytes[15 - i] = uint8_t(unscaled.lower >> (8 * i));
+        bytes[7 - i] = uint8_t(uint64_t(unscaled.upper) >> (8 * i));
+    }
+    idx_t start = 0;
+    while (start < 15 && ((bytes[start] == 0x00 && !(bytes[start + 1] & 0x80)) ||
+                          (bytes[start] == 0xff && (bytes[start + 1] & 0x80)))) {
+        start++;
+    }
+    return HexEncode(string(const_char_ptr_cast(bytes + start), 16 - start));
+}
+
+// A min/max of ColumnstoreColumnStats in Iceberg's binary single-value serialization, hex-encoded. Types without one
+// here (e.g. lists) get no bounds.
+bool GetIcebergBoundHex(const LogicalType &type, const string &text, string &result) {
+    Value value;
+    string error;
+    if (!Value(text).DefaultTryCastAs(type, value, &error)) {
+        return false;
+    }
+    switch (type.id()) {
+    case LogicalTypeId::BOOLEAN:
+        result = BooleanValue::Get(value) ? "01" : "00";
+        return true;
+    case LogicalTypeId::TINYINT:
+    case LogicalTypeId::SMALLINT:
+    case LogicalTypeId::INTEGER:
+        result = GetLittleEndianHex(value.GetValue<int32_t>());
+        return true;
+    case LogicalTypeId::BIGINT:
+        result = GetLittleEndianHex(value.GetValue<int64_t>());
+        return true;
+    case LogicalTypeId::FLOAT:
+        if (std::isnan(FloatValue::Get(value))) {
+            return false;
+        }
+        result = GetLittleEndianHex(FloatValue::Get(value));
+        return true;
+    case LogicalTypeId::DOUBLE:
+        if (std::isnan(DoubleValue::Get(value))) {
+            return false;
+        }
+        result = GetLittleEndianHex(DoubleValue::Get(value));
+        return true;
+    case LogicalTypeId::DECIMAL:
+        result = GetDecimalHex(GetUnscaledDecimal(value));
+        return true;
+    case LogicalTypeId::VARCHAR:
+        result = HexEncode(StringValue::Get(value));
+        return true;
+    case LogicalTypeId::DATE:
+        if (!Date::IsFinite(DateValue::Get(value))) {
+            return false;
+        }
+        result = GetLittleEndianHex(DateValue::Get(value).days);
+        return true;
+    case LogicalTypeId::TIME:
+        result = GetLittleEndianHex(TimeValue::Get(value).micros);
+        return true;
+    case LogicalTypeId::TIMESTAMP:
+    case LogicalTypeId::TIMESTAMP_TZ: {
+        auto timestamp = value.GetValueUnsafe<timestamp_t>();
+        if (!Timestamp::IsFinite(timestamp)) {
+            return false;
+        }
+        result = GetLittleEndianHex(timestamp.value);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Stats of the manifest entry of a data file, as JSON keyed by field ID. List columns are left out, Iceberg keeps
+// stats of primitive fields only.
+string GetIcebergStatsJson(const ColumnstoreDataFile &data_file,
+                           const unordered_map<string, IcebergColumn> &iceberg_columns) {
+    string value_counts;
+    string null_counts;
+    string lower_bounds;
+    string upper_bounds;
+    for (auto &column_stats : data_file.column_stats) {
+        auto it = iceberg_columns.find(column_stats.column_name);
+        if (it == iceberg_columns.end() || it->second.type.id() == LogicalTypeId::LIST) {
+            continue;
+        }
+        string field_id = "\"" + std::to_string(it->second.field_id) + "\":";
+        value_counts += (value_counts.empty() ? "" : ",") + field_id + std::to_string(data_file.row_count);
+        if (column_stats.null_count >= 0) {
+            null_counts += (null_counts.empty() ? "" : ",") + field_id + std::to_string(column_stats.null_count);
+        }
+        string bound;
+        if (column_stats.has_min_max && GetIcebergBoundHex(it->second.type, column_stats.min_value, bound)) {
+            lower_bounds += (lower_bounds.empty() ? "" : ",") + field_id + JsonQuote(bound);
+        }
+        if (column_stats.has_min_max && GetIcebergBoundHex(it->second.type, column_stats.max_value, bound)) {
+            upper_bounds += (upper_bounds.empty() ? "" : ",") + field_id + JsonQuote(bound);
+        }
+    }
+    return "{\"recordCount\":" + std::to_string(data_file.row_count) + ",\"valueCounts\":{" + value_counts +
+           "},\"nullValueCounts\":{" + null_counts + "},\"lowerBounds\":{" + lower_bounds + "},\"upperBounds\":{" +
+           upper_bounds + "}}";
+}
+
+// Partition of the manifest entry of a data file, as JSON. Dates and timestamps are given as Iceberg stores them (days
+// and microseconds since the epoch), decimals as their unscaled value in a string.
+string GetIcebergPartitionValuesJson(const string &file_name,
+                                     const unordered_map<string, IcebergColumn> &iceberg_columns) {
+    string result = "{";
+    for (auto &entry : GetPartitionValues(file_name)) {
+        if (result.size() > 1) {
+            result += ",";
+        }
+        result += JsonQuote(entry.first) + ":";
+        if (entry.second.IsNull()) {
+            result += "null";
+            continue;
+        }
+        auto &type = iceberg_columns.at(entry.first).type;
+        auto value = entry.second.DefaultCastAs(type);
+        switch (type.id()) {
+        case LogicalTypeId::BOOLEAN:
+            result += BooleanValue::Get(value) ? "true" : "false";
+            break;
+        case LogicalTypeId::TINYINT:
+        case LogicalTypeId::SMALLINT:
+        case LogicalTypeId::INTEGER:
+        case LogicalTypeId::BIGINT:
+            result += std::to_string(value.GetValue<int64_t>());
+            break;
+        case LogicalTypeId::DOUBLE:
+            if (!std::isfinite(DoubleValue::Get(value))) {
+                throw NotImplementedException("Iceberg tables do not support partition value %s", value.ToString());
+            }
+            result += value.ToString();
+            break;
+        case LogicalTypeId::DECIMAL:
+            result += JsonQuote(Hugeint::ToString(GetUnscaledDecimal(value)));
+            break;
+        case LogicalTypeId::DATE:
+            result += std::to_string(DateValue::Get(value).days);
+            break;
+        case LogicalTypeId::TIMESTAMP:
+        case LogicalTypeId::TIMESTAMP_TZ:
+            result += std::to_string(value.GetValueUnsafe<timestamp_t>().value);
+            break;
+        default:
+            result += JsonQuote(StringValue::Get(value));
+            break;
+        }
+    }
+    return result + "}";
+}
+
 class LakeWriter {
 public:
     LakeWriter() {
@@ -21,65 +422,174 @@ public:
         vector<string> column_types;
         ColumnstoreMetadata metadata(NULL /*snapshot*/);
         metadata.GetTableMetadata(oid, table_name /*out*/, column_names /*out*/, column_types /*out*/);
-        DeltaCreateTable(table_name, path, metadata.SecretsSearchDeltaOptions(path), column_names, column_types);
+        auto options = metadata.StorageOptionsSearch(oid);
+        if (options.lake_format == "none") {
+            return;
+        }
+        if (options.lake_format == "iceberg") {
+            IcebergCreateTable(path, metadata.SecretsSearchDeltaOptions(path),
+                               GetIcebergSchemaJson(column_names, GetColumnTypes(oid)),
+                               GetIcebergPartitionSpecJson(column_names, options.partition_by),
+                               options.log_retention_secs);
+            return;
+        }
+        DeltaCreateTable(table_name, path, metadata.SecretsSearchDeltaOptions(path), column_names, column_types,
+                         options.partition_by, options.checkpoint_interval, options.log_retention_secs);
     }
 
-    void ChangeFile(Oid oid, string file_name, int64_t file_size, bool is_add_file) {
-        if (cached_table_infos.count(oid) == 0) {
-            ColumnstoreMetadata metadata(NULL /*snapshot*/);
-            string path = metadata.TablesSearch(oid);
-            cached_table_infos[oid] = {path, metadata.SecretsSearchDeltaOptions(path)};
+    // Recorded in the outbox as part of the transaction, the lake sees it once the outbox is flushed
+    void ChangeFile(Oid oid, const ColumnstoreDataFile *data_file, const string &file_name, bool is_add_file) {
+        auto &info = GetTableInfo(oid);
+        if (!info.has_lake) {
+            return;
         }
-        auto &files = xact_state[oid];
-        auto files_iter = files.find(file_name);
-        if (files_iter == files.end()) {
-            files.emplace(std::move(file_name), FileInfo{file_size, is_add_file});
-        } else {
-            D_ASSERT(files_iter->second.is_add_file && !is_add_file);
-            files.erase(files_iter);
+        LakeFileAction action{file_name, is_add_file, 0 /*file_size*/, "{}" /*partition_values*/, "" /*stats*/};
+        if (is_add_file) {
+            action.file_size = data_file->file_size;
+            if (info.is_iceberg) {
+                action.partition_values = GetIcebergPartitionValuesJson(file_name, info.iceberg_columns);
+                action.stats = GetIcebergStatsJson(*data_file, info.iceberg_columns);
+            } else {
+                action.partition_values = GetPartitionValuesJson(file_name);
+                action.stats = GetStatsJson(*data_file, info.column_types, info.partition_columns);
+            }
         }
+        ColumnstoreMetadata(NULL /*snapshot*/).LakeOutboxInsert(oid, action);
+        xact_tables.insert(oid);
     }
 
     void Abort() {
-        xact_state.clear();
+        xact_tables.clear();
+        flush_tables.clear();
     }
 
+    // The lake only sees outbox rows once they are committed, so that it never has changes the catalog lost
+    void PreCommit() {
+        flush_tables.assign(xact_tables.begin(), xact_tables.end());
+        xact_tables.clear();
+    }
+
+    // The lake worker commits the outbox rows of all transactions that committed since its last flush together. The
+    // transaction only wakes it: the flush takes as long as the object store does, and needs the locks this
+    // transaction holds until it is done.
     void Commit() {
-        if (xact_state.empty()) {
+        if (flush_tables.empty()) {
             return;
         }
-        for (auto &[oid, files] : xact_state) {
-            vector<string> file_names;
-            file_names.reserve(files.size());
-            vector<int64_t> file_sizes;
-            file_sizes.reserve(files.size());
-            vector<int8_t> is_add_files;
-            is_add_files.reserve(files.size());
-            for (const auto &[file_name, file_info] : files) {
-                file_names.emplace_back(file_name);
-                file_sizes.emplace_back(file_info.file_size);
-                is_add_files.emplace_back(file_info.is_add_file);
-            }
-            if (!file_names.empty()) {
-                auto info = cached_table_infos[oid];
-                DeltaModifyFiles(info.path, info.delta_options, file_names, file_sizes, is_add_files);
+        if (!LakeWakeWorker()) {
+            LakeStartFlushWorker(flush_tables);
+        }
+        flush_tables.clear();
+    }
+
+    // Commits the outbox of a table to the lake as one Delta version, or Iceberg snapshot. Actions are deleted from the
+    // outbox only after that, and DeltaModifyFiles (IcebergModifyFiles) skips actions the lake already has, so ones
+    // that made it before a crash aren't applied twice. A data file added and removed in the same flush is left to
+    // them as well: the add may have made it in an earlier flush that crashed, and then the remove must apply.
+    void Flush(Oid oid) {
+        if (xact_tables.count(oid)) {
+            throw InvalidInputException("cannot flush the lake changes of a table changed in the current transaction");
+        }
+        ColumnstoreMetadata metadata(NULL /*snapshot*/);
+        metadata.LakeOutboxLock(oid);
+        auto actions = metadata.LakeOutboxSearch(oid);
+        if (actions.empty()) {
+            return;
+        }
+        vector<string> file_names;
+        vector<int64_t> file_sizes;
+        vector<int8_t> is_add_files;
+        vector<string> partition_values;
+        vector<string> stats;
+        for (auto &action : actions) {
+            file_names.emplace_back(action.file_name);
+            file_sizes.emplace_back(action.file_size);
+            is_add_files.emplace_back(action.is_add_file);
+            partition_values.emplace_back(action.partition_values);
+            stats.emplace_back(action.stats);
+        }
+        // Tables dropped since have nothing left to commit to
+        string path = metadata.TablesSearch(oid);
+        if (!file_names.empty() && !path.empty() && SearchSysCacheExists1(RELOID, ObjectIdGetDatum(oid))) {
+            if (metadata.StorageOptionsSearch(oid).lake_format == "iceberg") {
+                // Iceberg takes locations where Delta takes paths relative to the table
+                for (auto &file_name : file_names) {
+                    file_name = path + file_name;
+                }
+                IcebergModifyFiles(path, metadata.SecretsSearchDeltaOptions(path), file_names, file_sizes,
+                                   is_add_files, partition_values, stats);
+            } else {
+                for (auto &file_name : file_names) {
+                    file_name = GetDeltaPath(file_name);
+                }
+                DeltaModifyFiles(path, metadata.SecretsSearchDeltaOptions(path), file_names, file_sizes,
+                                 is_add_files, partition_values, stats);
             }
         }
-        xact_state.clear();
+        metadata.LakeOutboxDelete(oid, actions);
     }
 
 private:
-    struct CachedTableInfoEntry {
-        string path;
-        string delta_options;
+    struct TableInfo {
+        // Postgres type names by column name, see GetStatsValueJson
+        unordered_map<string, string> column_types;
+        unordered_set<string> partition_columns;
+        // Unset for lake_format none
+        bool has_lake;
+        bool is_iceberg;
+        unordered_map<string, IcebergColumn> iceberg_columns;
     };
-    unordered_map<Oid, CachedTableInfoEntry> cached_table_infos;
 
-    struct FileInfo {
-        int64_t file_size;
-        bool is_add_file;
-    };
-    unordered_map<Oid, unordered_map<string, FileInfo>> xact_state;
+    // Renamed columns and dropped tables (whose oid may be reused) invalidate the relcache entry of the table
+    static void InvalidateTableInfo(Datum arg, Oid relid) {
+        auto &table_infos = static_cast<LakeWriter *>(DatumGetPointer(arg))->table_infos;
+        if (relid == InvalidOid) {
+            table_infos.clear();
+        } else {
+            table_infos.erase(relid);
+        }
+    }
+
+    TableInfo &GetTableInfo(Oid oid) {
+        if (!callback_registered) {
+            CacheRegisterRelcacheCallback(InvalidateTableInfo, PointerGetDatum(this));
+            callback_registered = true;
+        }
+        auto it = table_infos.find(oid);
+        if (it != table_infos.end()) {
+            return it->second;
+        }
+        ColumnstoreMetadata metadata(NULL /*snapshot*/);
+        auto &info = table_infos[oid];
+        string table_name;
+        vector<string> column_names;
+        vector<string> column_types;
+        metadata.GetTableMetadata(oid, table_name /*out*/, column_names /*out*/, column_types /*out*/);
+        for (idx_t i = 0; i < column_names.size(); i++) {
+            info.column_types[column_names[i]] = column_types[i];
+        }
+        auto options = metadata.StorageOptionsSearch(oid);
+        for (auto &column_name : options.partition_by) {
+            info.partition_columns.insert(column_name);
+        }
+        info.has_lake = options.lake_format != "none";
+        info.is_iceberg = options.lake_format == "iceberg";
+        if (info.is_iceberg) {
+            auto types = GetColumnTypes(oid);
+            for (idx_t i = 0; i < column_names.size(); i++) {
+                info.iceberg_columns[column_names[i]] = IcebergColumn{NumericCast<int32_t>(i + 1), types[i]};
+            }
+        }
+        return info;
+    }
+
+private:
+    bool callback_registered = false;
+    unordered_map<Oid, TableInfo> table_infos;
+    // Tables this transaction wrote to the outbox of
+    std::set<Oid> xact_tables;
+    // Tables whose outbox rows the committing transaction hands to the lake worker
+    vector<Oid> flush_tables;
 };
 
 LakeWriter lake_writer;
@@ -90,18 +600,26 @@ void LakeCreateTable(Oid oid, const string &path) {
     lake_writer.CreateTable(oid, path);
 }
 
-void LakeAddFile(Oid oid, string file_name, int64_t file_size) {
-    lake_writer.ChangeFile(oid, std::move(file_name), file_size, true /*is_add_file*/);
+void LakeAddFile(Oid oid, const ColumnstoreDataFile &data_file) {
+    lake_writer.ChangeFile(oid, &data_file, data_file.file_name, true /*is_add_file*/);
 }
 
-void LakeDeleteFile(Oid oid, string file_name) {
-    lake_writer.ChangeFile(oid, std::move(file_name), 0 /*file_size*/, false /*is_add_file*/);
+void LakeDeleteFile(Oid oid, const string &file_name) {
+    lake_writer.ChangeFile(oid, nullptr /*data_file*/, file_name, false /*is_add_file*/);
+}
+
+void LakeFlush(Oid oid) {
+    lake_writer.Flush(oid);
 }
 
 void LakeAbort() {
     lake_writer.Abort();
 }
 
+void LakePreCommit() {
+    lake_writer.PreCommit();
+}
+
 void LakeCommit() {
     lake_writer.Commit();
 }
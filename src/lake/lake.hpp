@@ -1,18 +1,36 @@
 #pragma once
 
 #include "duckdb/common/string.hpp"
+#include "duckdb/common/vector.hpp"
 #include "pgduckdb/pg/declarations.hpp"
 
 namespace duckdb {
 
+struct ColumnstoreDataFile;
+
+// Writes Delta Lake or Iceberg metadata, per the table's lake_format storage option
 void LakeCreateTable(Oid oid, const string &path);
 
-void LakeAddFile(Oid oid, string file_name, int64_t file_size);
+// Adds and deletes go to mooncake.lake_outbox, and reach the lake when the outbox is flushed by the lake worker of the
+// database once the transaction committed
+void LakeAddFile(Oid oid, const ColumnstoreDataFile &data_file);
+
+void LakeDeleteFile(Oid oid, const string &file_name);
 
-void LakeDeleteFile(Oid oid, string file_name);
+void LakeFlush(Oid oid);
 
 void LakeAbort();
 
+void LakePreCommit();
+
+// Hands the outbox rows the transaction committed to the lake worker
 void LakeCommit();
 
+// Defined with the lake worker: sets the latch of the database's worker, or has the launcher start one. Returns false
+// if there is no lake worker to be had (pg_mooncake isn't preloaded, or all mooncake.max_lake_workers are taken).
+bool LakeWakeWorker();
+
+// Flushes the outbox of the given tables in a background worker, without waiting for it, see mooncake_lake_flush_main
+void LakeStartFlushWorker(const vector<Oid> &oids);
+
 } // namespace duckdb
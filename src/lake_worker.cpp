@@ -0,0 +1,418 @@
+#include "columnstore/columnstore_metadata.hpp"
+#include "columnstore_handler.hpp"
+#include "lake/lake.hpp"
+#include "pgduckdb/pgduckdb_metadata_cache.hpp"
+#include "pgduckdb/utility/cpp_wrapper.hpp"
+#include "pgmooncake_guc.hpp"
+
+extern "C" {
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/acl.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/snapmgr.h"
+#include "utils/timestamp.h"
+}
+
+namespace {
+
+// A lake worker serves one database. The slot is claimed by the first backend that commits lake changes there, then
+// the launcher starts its worker.
+struct LakeWorkerSlot {
+    // InvalidOid while the slot is free
+    Oid database;
+    // Set by the launcher once it started the worker
+    bool started;
+    // Set by the worker once connected, committing backends set its latch
+    PGPROC *worker;
+};
+
+struct LakeWorkerState {
+    slock_t mutex;
+    PGPROC *launcher;
+    LakeWorkerSlot slots[FLEXIBLE_ARRAY_MEMBER];
+};
+
+LakeWorkerState *lake_worker_state = nullptr;
+
+// Workers don't linger in databases without writes, since a connected worker makes DROP DATABASE fail
+const long x_lake_worker_idle_timeout_ms = 60 * 1000;
+
+Size LakeWorkerShmemSize() {
+    return add_size(offsetof(LakeWorkerState, slots), mul_size(mooncake_max_lake_workers, sizeof(LakeWorkerSlot)));
+}
+
+#if PG_VERSION_NUM >= 150000
+shmem_request_hook_type prev_shmem_request_hook = nullptr;
+
+void LakeWorkerShmemRequest() {
+    if (prev_shmem_request_hook) {
+        prev_shmem_request_hook();
+    }
+    RequestAddinShmemSpace(LakeWorkerShmemSize());
+}
+#endif
+
+shmem_startup_hook_type prev_shmem_startup_hook = nullptr;
+
+void LakeWorkerShmemStartup() {
+    if (prev_shmem_startup_hook) {
+        prev_shmem_startup_hook();
+    }
+    bool found;
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+    lake_worker_state =
+        static_cast<LakeWorkerState *>(ShmemInitStruct("pg_mooncake lake worker", LakeWorkerShmemSize(), &found));
+    if (!found) {
+        SpinLockInit(&lake_worker_state->mutex);
+        lake_worker_state->launcher = nullptr;
+        for (int i = 0; i < mooncake_max_lake_workers; i++) {
+            lake_worker_state->slots[i] = LakeWorkerSlot{InvalidOid, false /*started*/, nullptr /*worker*/};
+        }
+    }
+    LWLockRelease(AddinShmemInitLock);
+}
+
+void ClearLauncher(int /*code*/, Datum /*arg*/) {
+    SpinLockAcquire(&lake_worker_state->mutex);
+    lake_worker_state->launcher = nullptr;
+    SpinLockRelease(&lake_worker_state->mutex);
+}
+
+// Frees the slot of a worker that is exiting, unless the launcher already handed it to a new worker
+void ReleaseSlot(int /*code*/, Datum arg) {
+    auto &slot = lake_worker_state->slots[DatumGetInt32(arg)];
+    SpinLockAcquire(&lake_worker_state->mutex);
+    if (slot.worker == MyProc) {
+        slot = LakeWorkerSlot{InvalidOid, false /*started*/, nullptr /*worker*/};
+    }
+    SpinLockRelease(&lake_worker_state->mutex);
+}
+
+// Each table is flushed in its own transaction, so a failure (e.g. the object store being unreachable) only holds
+// back that table, whose outbox is retried on the next run
+void FlushTable(Oid oid) {
+    MemoryContext context = CurrentMemoryContext;
+    SetCurrentStatementStartTimestamp();
+    StartTransactionCommand();
+    PushActiveSnapshot(GetTransactionSnapshot());
+    pgstat_report_activity(STATE_RUNNING, "committing columnstore table to lake");
+    PG_TRY();
+    {
+        InvokeCPPFunc(duckdb::LakeFlush, oid);
+        PopActiveSnapshot();
+        CommitTransactionCommand();
+    }
+    PG_CATCH();
+    {
+        MemoryContextSwitchTo(context);
+        EmitErrorReport();
+        FlushErrorState();
+        AbortCurrentTransaction();
+    }
+    PG_END_TRY();
+}
+
+duckdb::vector<Oid> SearchLakeOutbox() {
+    duckdb::vector<Oid> oids;
+    SetCurrentStatementStartTimestamp();
+    StartTransactionCommand();
+    PushActiveSnapshot(GetTransactionSnapshot());
+    // The extension may have been dropped since
+    if (pgduckdb::IsExtensionRegistered()) {
+        oids = duckdb::ColumnstoreMetadata(NULL /*snapshot*/).LakeOutboxSearch();
+    }
+    PopActiveSnapshot();
+    CommitTransactionCommand();
+    return oids;
+}
+
+// Returns whether there was anything to flush
+bool FlushLakeOutbox() {
+    auto oids = SearchLakeOutbox();
+    for (Oid oid : oids) {
+        CHECK_FOR_INTERRUPTS();
+        FlushTable(oid);
+    }
+    pgstat_report_stat(false);
+    pgstat_report_activity(STATE_IDLE, NULL);
+    return !oids.empty();
+}
+
+bool StartWorker(BackgroundWorker &worker, BackgroundWorkerHandle **handle) {
+    snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_mooncake");
+    worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+    worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+    worker.bgw_restart_time = BGW_NEVER_RESTART;
+    return RegisterDynamicBackgroundWorker(&worker, handle);
+}
+
+} // namespace
+
+extern "C" {
+DECLARE_PG_FUNCTION(mooncake_flush_lake) {
+    Oid oid = PG_GETARG_OID(0);
+    if (!IsColumnstoreTable(oid)) {
+        elog(ERROR, "%s is not a columnstore table", get_rel_name(oid));
+    }
+    if (pg_class_aclcheck(oid, GetUserId(), ACL_UPDATE) != ACLCHECK_OK) {
+        elog(ERROR, "permission denied for table %s", get_rel_name(oid));
+    }
+    InvokeCPPFunc(duckdb::LakeFlush, oid);
+    PG_RETURN_VOID();
+}
+
+// Starts the lake worker of each database a backend asked for, and notices workers that exited. It connects to no
+// database, workers are started on demand since there is no telling which databases have columnstore tables.
+PGDLLEXPORT void mooncake_lake_launcher_main(Datum /*main_arg*/) {
+    pqsignal(SIGHUP, SignalHandlerForConfigReload);
+    pqsignal(SIGTERM, die);
+    BackgroundWorkerUnblockSignals();
+
+    // Workers a previous launcher started but that never connected are started again
+    SpinLockAcquire(&lake_worker_state->mutex);
+    lake_worker_state->launcher = MyProc;
+    for (int i = 0; i < mooncake_max_lake_workers; i++) {
+        if (!lake_worker_state->slots[i].worker) {
+            lake_worker_state->slots[i].started = false;
+        }
+    }
+    SpinLockRelease(&lake_worker_state->mutex);
+    before_shmem_exit(ClearLauncher, 0);
+
+    duckdb::vector<BackgroundWorkerHandle *> handles(mooncake_max_lake_workers, nullptr);
+    while (true) {
+        if (ConfigReloadPending) {
+            ConfigReloadPending = false;
+            ProcessConfigFile(PGC_SIGHUP);
+        }
+
+        for (int i = 0; i < mooncake_max_lake_workers; i++) {
+            auto &slot = lake_worker_state->slots[i];
+            pid_t pid;
+            // A worker that exits frees its slot itself, unless it failed before connecting
+            if (handles[i] && GetBackgroundWorkerPid(handles[i], &pid) == BGWH_STOPPED) {
+                SpinLockAcquire(&lake_worker_state->mutex);
+                if (slot.started && !slot.worker) {
+                    slot = LakeWorkerSlot{InvalidOid, false /*started*/, nullptr /*worker*/};
+                }
+                SpinLockRelease(&lake_worker_state->mutex);
+                pfree(handles[i]);
+                handles[i] = nullptr;
+            }
+            Oid database = InvalidOid;
+            SpinLockAcquire(&lake_worker_state->mutex);
+            if (slot.database != InvalidOid && !slot.started) {
+                database = slot.database;
+                slot.started = true;
+            }
+            SpinLockRelease(&lake_worker_state->mutex);
+            if (database == InvalidOid) {
+                continue;
+            }
+
+            BackgroundWorker worker;
+            MemSet(&worker, 0, sizeof(BackgroundWorker));
+            snprintf(worker.bgw_function_name, BGW_MAXLEN, "mooncake_lake_worker_main");
+            snprintf(worker.bgw_name, BGW_MAXLEN, "pg_mooncake lake worker");
+            worker.bgw_main_arg = Int32GetDatum(i);
+            worker.bgw_notify_pid = MyProcPid;
+            // The handle of a worker still finishing its last flush isn't needed anymore
+            if (handles[i]) {
+                pfree(handles[i]);
+                handles[i] = nullptr;
+            }
+            if (!StartWorker(worker, &handles[i])) {
+                elog(WARNING,
+                     "could not start pg_mooncake lake worker for database %u, its mooncake.lake_outbox is flushed "
+                     "once it commits lake changes again (consider raising max_worker_processes)",
+                     database);
+                handles[i] = nullptr;
+                SpinLockAcquire(&lake_worker_state->mutex);
+                slot = LakeWorkerSlot{InvalidOid, false /*started*/, nullptr /*worker*/};
+                SpinLockRelease(&lake_worker_state->mutex);
+            }
+        }
+
+        // Set by backends asking for a worker, and by the postmaster when a worker started or stopped
+        WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH, mooncake_lake_naptime, PG_WAIT_EXTENSION);
+        CHECK_FOR_INTERRUPTS();
+        ResetLatch(MyLatch);
+    }
+}
+
+// Flushes the outbox of its database whenever a committing transaction wakes it, and every lake_naptime in case a
+// flush failed. Exits once idle for a while, the next commit has the launcher start it again.
+PGDLLEXPORT void mooncake_lake_worker_main(Datum main_arg) {
+    pqsignal(SIGHUP, SignalHandlerForConfigReload);
+    pqsignal(SIGTERM, die);
+    BackgroundWorkerUnblockSignals();
+
+    auto &slot = lake_worker_state->slots[DatumGetInt32(main_arg)];
+    SpinLockAcquire(&lake_worker_state->mutex);
+    Oid database = slot.database;
+    SpinLockRelease(&lake_worker_state->mutex);
+    if (database == InvalidOid) {
+        proc_exit(0);
+    }
+    BackgroundWorkerInitializeConnectionByOid(database, InvalidOid /*useroid*/, 0 /*flags*/);
+    SpinLockAcquire(&lake_worker_state->mutex);
+    slot.worker = MyProc;
+    SpinLockRelease(&lake_worker_state->mutex);
+    before_shmem_exit(ReleaseSlot, main_arg);
+
+    TimestampTz last_flush = GetCurrentTimestamp();
+    while (true) {
+        if (ConfigReloadPending) {
+            ConfigReloadPending = false;
+            ProcessConfigFile(PGC_SIGHUP);
+        }
+
+        if (FlushLakeOutbox()) {
+            last_flush = GetCurrentTimestamp();
+        } else if (TimestampDifferenceExceeds(last_flush, GetCurrentTimestamp(), x_lake_worker_idle_timeout_ms)) {
+            // Backends that found the slot set the latch after committing, so one more flush covers their changes
+            ReleaseSlot(0, main_arg);
+            FlushLakeOutbox();
+            proc_exit(0);
+        }
+
+        int rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH, mooncake_lake_naptime,
+                           PG_WAIT_EXTENSION);
+        // Woken by a commit: give concurrent transactions a moment to commit as well, so that each table gets one Delta
+        // version for all of them. Commits during the flush set the latch again and start the next group.
+        if ((rc & WL_LATCH_SET) && mooncake_lake_commit_delay > 0) {
+            WaitLatch(MyLatch, WL_TIMEOUT | WL_EXIT_ON_PM_DEATH, mooncake_lake_commit_delay, PG_WAIT_EXTENSION);
+        }
+        CHECK_FOR_INTERRUPTS();
+        ResetLatch(MyLatch);
+    }
+}
+
+// Started by a committing backend that has no lake worker to wake, without waiting for it. bgw_extra lists the tables
+// to flush, ending at InvalidOid; when it is empty the whole outbox of the database is flushed. Like a lake worker it
+// waits lake_commit_delay first, and whichever flush worker of a table gets its outbox lock first commits the rows of
+// every transaction that committed by then.
+PGDLLEXPORT void mooncake_lake_flush_main(Datum main_arg) {
+    pqsignal(SIGTERM, die);
+    BackgroundWorkerUnblockSignals();
+
+    if (mooncake_lake_commit_delay > 0) {
+        WaitLatch(MyLatch, WL_TIMEOUT | WL_EXIT_ON_PM_DEATH, mooncake_lake_commit_delay, PG_WAIT_EXTENSION);
+    }
+    BackgroundWorkerInitializeConnectionByOid(DatumGetObjectId(main_arg), InvalidOid /*useroid*/, 0 /*flags*/);
+    duckdb::vector<Oid> oids;
+    auto extra = reinterpret_cast<const Oid *>(MyBgworkerEntry->bgw_extra);
+    for (size_t i = 0; i < BGW_EXTRALEN / sizeof(Oid) && extra[i] != InvalidOid; i++) {
+        oids.push_back(extra[i]);
+    }
+    if (oids.empty()) {
+        oids = SearchLakeOutbox();
+    }
+    for (Oid oid : oids) {
+        CHECK_FOR_INTERRUPTS();
+        FlushTable(oid);
+    }
+    pgstat_report_stat(true);
+}
+}
+
+namespace duckdb {
+
+bool LakeWakeWorker() {
+    if (!lake_worker_state) {
+        return false;
+    }
+    PGPROC *worker = nullptr;
+    PGPROC *launcher = nullptr;
+    bool has_slot = false;
+    SpinLockAcquire(&lake_worker_state->mutex);
+    for (int i = 0; i < mooncake_max_lake_workers && !has_slot; i++) {
+        auto &slot = lake_worker_state->slots[i];
+        if (slot.database == MyDatabaseId) {
+            worker = slot.worker;
+            has_slot = true;
+        }
+    }
+    for (int i = 0; i < mooncake_max_lake_workers && !has_slot; i++) {
+        auto &slot = lake_worker_state->slots[i];
+        if (slot.database == InvalidOid) {
+            slot.database = MyDatabaseId;
+            launcher = lake_worker_state->launcher;
+            has_slot = true;
+        }
+    }
+    SpinLockRelease(&lake_worker_state->mutex);
+    // A worker that is starting flushes the outbox once connected, and so does the launcher's next run if it is
+    // restarting
+    if (worker) {
+        SetLatch(&worker->procLatch);
+    } else if (launcher) {
+        SetLatch(&launcher->procLatch);
+    }
+    return has_slot;
+}
+
+// The flush waits for the locks of the committing transaction, but the transaction doesn't wait for the flush
+void LakeStartFlushWorker(const vector<Oid> &oids) {
+    BackgroundWorker worker;
+    MemSet(&worker, 0, sizeof(BackgroundWorker));
+    snprintf(worker.bgw_function_name, BGW_MAXLEN, "mooncake_lake_flush_main");
+    snprintf(worker.bgw_name, BGW_MAXLEN, "pg_mooncake lake flush");
+    worker.bgw_main_arg = ObjectIdGetDatum(MyDatabaseId);
+    // Leaves room for the terminating InvalidOid
+    if (oids.size() < BGW_EXTRALEN / sizeof(Oid)) {
+        memcpy(worker.bgw_extra, oids.data(), oids.size() * sizeof(Oid));
+    }
+    BackgroundWorkerHandle *handle;
+    if (!StartWorker(worker, &handle)) {
+        // Not a WARNING, the transaction already committed. The next flush of the table picks the changes up.
+        elog(LOG, "could not start pg_mooncake lake flush worker, the changes stay in mooncake.lake_outbox until a "
+                  "later flush of the table");
+        return;
+    }
+    pfree(handle);
+}
+
+} // namespace duckdb
+
+// Lake workers need shared memory to be found by committing backends, so only run when preloaded. Elsewhere each
+// committing transaction starts a flush worker of its own.
+void MooncakeInitLakeWorker() {
+    if (!process_shared_preload_libraries_in_progress) {
+        return;
+    }
+
+    BackgroundWorker worker;
+    MemSet(&worker, 0, sizeof(BackgroundWorker));
+    worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+    worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+    snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_mooncake");
+    snprintf(worker.bgw_function_name, BGW_MAXLEN, "mooncake_lake_launcher_main");
+    snprintf(worker.bgw_name, BGW_MAXLEN, "pg_mooncake lake launcher");
+    worker.bgw_restart_time = 1;
+    worker.bgw_main_arg = (Datum)0;
+    RegisterBackgroundWorker(&worker);
+#if PG_VERSION_NUM >= 150000
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = LakeWorkerShmemRequest;
+#else
+    RequestAddinShmemSpace(LakeWorkerShmemSize());
+#endif
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = LakeWorkerShmemStartup;
+}
@@ -72,6 +72,14 @@ DefineCustomVariable(const char *name, const char *short_desc, int *var, const s
 	                         assign_hook, show_hook);
 }
 
+static void
+DefineCustomVariable(const char *name, const char *short_desc, double *var, double min, double max,
+                     GucContext context = PGC_USERSET, int flags = 0, GucRealCheckHook check_hook = NULL,
+                     GucRealAssignHook assign_hook = NULL, GucShowHook show_hook = NULL) {
+	DefineCustomRealVariable(name, gettext_noop(short_desc), NULL, var, *var, min, max, context, flags, check_hook,
+	                         assign_hook, show_hook);
+}
+
 template <typename T>
 static void
 DefineCustomVariable(const char *name, const char *short_desc, T *var, T min, T max, GucContext context = PGC_USERSET,
@@ -193,4 +201,58 @@ MooncakeInitGUC() {
 
 	DefineCustomVariable("mooncake.enable_local_cache", "Enable local cache for columnstore tables",
 	                     &mooncake_enable_local_cache);
+
+	DefineCustomVariable("mooncake.local_cache_size",
+	                     "Size budget of the local cache of remote columnstore data files shared by all backends",
+	                     &mooncake_local_cache_size, 1, INT_MAX, PGC_SIGHUP, GUC_UNIT_MB);
+
+	DefineCustomVariable("mooncake.write_buffer_rows",
+	                     "Inserts of at most this many rows go to the write buffer of columnstore tables (0 disables)",
+	                     &mooncake_write_buffer_rows, 0, INT_MAX);
+
+	DefineCustomVariable("mooncake.write_buffer_flush_rows",
+	                     "Flush the write buffer of a columnstore table once it holds this many rows",
+	                     &mooncake_write_buffer_flush_rows, 1, INT_MAX);
+
+	DefineCustomVariable("mooncake.write_buffer_flush_size",
+	                     "Flush the write buffer of a columnstore table once it holds this much data",
+	                     &mooncake_write_buffer_flush_size, 1, INT_MAX, PGC_USERSET, GUC_UNIT_KB);
+
+	DefineCustomVariable("mooncake.write_buffer_flush_interval",
+	                     "Flush the write buffer of a columnstore table once its oldest rows are this old (0 disables)",
+	                     &mooncake_write_buffer_flush_interval, 0, INT_MAX, PGC_USERSET, GUC_UNIT_S);
+
+	DefineCustomVariable("mooncake.compaction_target_file_size",
+	                     "Target size of data files merged by compaction of columnstore tables",
+	                     &mooncake_compaction_target_file_size, 1, INT_MAX, PGC_USERSET, GUC_UNIT_KB);
+
+	DefineCustomVariable("mooncake.compaction_min_file_count",
+	                     "Compact a columnstore table once it has this many small data files",
+	                     &mooncake_compaction_min_file_count, 2, INT_MAX);
+
+	DefineCustomVariable("mooncake.compaction_database",
+	                     "Database in which the background worker compacts columnstore tables (empty disables it)",
+	                     &mooncake_compaction_database, PGC_POSTMASTER, GUC_SUPERUSER_ONLY);
+
+	DefineCustomVariable("mooncake.compaction_naptime", "Time between compaction runs of the background worker",
+	                     &mooncake_compaction_naptime, 1, INT_MAX, PGC_SIGHUP, GUC_UNIT_S);
+
+	DefineCustomVariable("mooncake.max_lake_workers",
+	                     "Maximum number of databases with a background worker committing columnstore changes to the "
+	                     "lake, off the commit path of transactions",
+	                     &mooncake_max_lake_workers, 1, 1024, PGC_POSTMASTER);
+
+	DefineCustomVariable("mooncake.lake_naptime",
+	                     "Time between lake commits of a lake worker when no transaction wakes it",
+	                     &mooncake_lake_naptime, 1, INT_MAX, PGC_SIGHUP, GUC_UNIT_MS);
+
+	DefineCustomVariable("mooncake.lake_commit_delay",
+	                     "Time lake commits wait for further transactions, so that transactions committing close "
+	                     "together share one Delta version (0 does not wait)",
+	                     &mooncake_lake_commit_delay, 0, 10000, PGC_SIGHUP, GUC_UNIT_MS);
+
+	DefineCustomVariable("mooncake.deletion_vector_threshold",
+	                     "Delete rows of a columnstore data file through its deletion vector until this fraction of its "
+	                     "rows is deleted, then rewrite the file (0 always rewrites, as do tables with a lake table)",
+	                     &mooncake_deletion_vector_threshold, 0.0, 1.0, PGC_SUSET);
 }
@@ -1,14 +1,21 @@
 #include "duckdb.hpp"
 #include <regex>
 
+#include "columnstore/columnstore.hpp"
+#include "columnstore/columnstore_writer.hpp"
 #include "columnstore_handler.hpp"
 #include "pgduckdb/pgduckdb_planner.hpp"
 #include "pgduckdb/pgduckdb_utils.hpp"
 
 extern "C" {
 #include "postgres.h"
+#include "access/htup_details.h"
+#include "access/reloptions.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "catalog/indexing.h"
 #include "catalog/pg_type.h"
+#include "commands/defrem.h"
 #include "commands/event_trigger.h"
 #include "fmgr.h"
 #include "catalog/pg_authid_d.h"
@@ -19,8 +26,11 @@ extern "C" {
 #include "optimizer/optimizer.h"
 #include "tcop/utility.h"
 #include "utils/builtins.h"
+#include "utils/timestamp.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/lsyscache.h"
+#include "utils/varlena.h"
 #include "commands/event_trigger.h"
 #include "executor/spi.h"
 #include "miscadmin.h"
@@ -98,11 +108,224 @@ DuckdbHandleDDL(Node *parsetree) {
 	}
 }
 
+/*
+ * Storage options of columnstore tables (see ColumnstoreStorageOptions) are
+ * given as reloptions in CREATE TABLE ... USING columnstore WITH (...), but
+ * Postgres validates reloptions as those of heap tables and would reject them.
+ * So we take them out of the statement here, and hand them to
+ * Columnstore::CreateTable, which stores them in mooncake.storage_options.
+ * The options taken out are appended to columnstore_options. Returns false if
+ * the statement has none.
+ */
+static bool
+ExtractColumnstoreStorageOptions(CreateStmt *stmt, duckdb::ColumnstoreStorageOptions &options,
+                                 List *&columnstore_options) {
+	bool found = false;
+	List *heap_options = NIL;
+	ListCell *lc;
+	foreach (lc, stmt->options) {
+		DefElem *def = lfirst_node(DefElem, lc);
+		if (def->defnamespace) {
+			heap_options = lappend(heap_options, def);
+			continue;
+		}
+		if (strcmp(def->defname, "compression") == 0) {
+			options.compression = duckdb::StringUtil::Lower(defGetString(def));
+			if (!duckdb::IsSupportedCompression(options.compression)) {
+				elog(ERROR, "unsupported compression \"%s\", expected one of uncompressed, snappy, gzip, zstd, "
+				            "brotli, lz4",
+				     options.compression.c_str());
+			}
+		} else if (strcmp(def->defname, "compression_level") == 0) {
+			int64_t level = defGetInt64(def);
+			if (level < 1 || level > 22) {
+				elog(ERROR, "compression_level must be between 1 and 22");
+			}
+			options.has_compression_level = true;
+			options.compression_level = (int32_t)level;
+		} else if (strcmp(def->defname, "dictionary_compression_ratio_threshold") == 0) {
+			options.dictionary_compression_ratio_threshold = defGetNumeric(def);
+			if (options.dictionary_compression_ratio_threshold < 0 &&
+			    options.dictionary_compression_ratio_threshold != -1) {
+				elog(ERROR, "dictionary_compression_ratio_threshold must be at least 0, or -1 to disable dictionary "
+				            "encoding");
+			}
+		} else if (strcmp(def->defname, "row_group_size") == 0 || strcmp(def->defname, "row_group_size_bytes") == 0 ||
+		           strcmp(def->defname, "file_size_bytes") == 0) {
+			int64_t value = defGetInt64(def);
+			if (value <= 0) {
+				elog(ERROR, "%s must be positive", def->defname);
+			}
+			if (strcmp(def->defname, "row_group_size") == 0) {
+				options.row_group_size = value;
+			} else if (strcmp(def->defname, "row_group_size_bytes") == 0) {
+				options.row_group_size_bytes = value;
+			} else {
+				options.file_size_bytes = value;
+			}
+		} else if (strcmp(def->defname, "sort_by") == 0 || strcmp(def->defname, "zorder_by") == 0) {
+			if (!options.sort_by.empty()) {
+				elog(ERROR, "only one of sort_by and zorder_by can be given");
+			}
+			List *column_names;
+			if (!SplitIdentifierString(pstrdup(defGetString(def)), ',', &column_names) || column_names == NIL) {
+				elog(ERROR, "%s must be a comma-separated list of column names", def->defname);
+			}
+			ListCell *lc_column;
+			foreach (lc_column, column_names) {
+				options.sort_by.push_back((char *)lfirst(lc_column));
+			}
+			options.zorder = strcmp(def->defname, "zorder_by") == 0;
+		} else if (strcmp(def->defname, "partition_by") == 0) {
+			List *column_names;
+			if (!SplitIdentifierString(pstrdup(defGetString(def)), ',', &column_names) || column_names == NIL) {
+				elog(ERROR, "partition_by must be a comma-separated list of column names");
+			}
+			ListCell *lc_column;
+			foreach (lc_column, column_names) {
+				options.partition_by.push_back((char *)lfirst(lc_column));
+			}
+		} else if (strcmp(def->defname, "checkpoint_interval") == 0) {
+			int64_t interval = defGetInt64(def);
+			if (interval <= 0 || interval > PG_INT32_MAX) {
+				elog(ERROR, "checkpoint_interval must be a positive integer");
+			}
+			options.checkpoint_interval = (int32_t)interval;
+		} else if (strcmp(def->defname, "log_retention") == 0) {
+			Datum retention_datum = DirectFunctionCall3(interval_in, CStringGetDatum(defGetString(def)),
+			                                            ObjectIdGetDatum(InvalidOid), Int32GetDatum(-1));
+			Interval *retention = DatumGetIntervalP(retention_datum);
+			options.log_retention_secs = retention->time / USECS_PER_SEC +
+			                             ((int64_t)retention->month * DAYS_PER_MONTH + retention->day) * SECS_PER_DAY;
+			if (options.log_retention_secs <= 0) {
+				elog(ERROR, "log_retention must be positive");
+			}
+		} else if (strcmp(def->defname, "lake_format") == 0) {
+			options.lake_format = duckdb::StringUtil::Lower(defGetString(def));
+			if (options.lake_format != "delta" && options.lake_format != "iceberg" && options.lake_format != "none") {
+				elog(ERROR, "unsupported lake_format \"%s\", expected one of delta, iceberg, none",
+				     options.lake_format.c_str());
+			}
+		} else {
+			heap_options = lappend(heap_options, def);
+			continue;
+		}
+		columnstore_options = lappend(columnstore_options, def);
+		found = true;
+	}
+	if (options.has_compression_level && options.compression != "zstd") {
+		elog(ERROR, "compression_level is only supported with compression zstd");
+	}
+	stmt->options = heap_options;
+	return found;
+}
+
+static AttrNumber
+GetStorageOptionColumn(Oid relid, const std::string &column_name, const char *option_name) {
+	AttrNumber attnum = get_attnum(relid, column_name.c_str());
+	if (attnum == InvalidAttrNumber) {
+		elog(ERROR, "column \"%s\" of %s does not exist", column_name.c_str(), option_name);
+	}
+	return attnum;
+}
+
+/*
+ * Sort and partition keys must name columns of the new table. Z-order keys
+ * must have a type ColumnstoreWriter can map onto the curve, and partition
+ * keys a type whose values make sensible directory names.
+ */
+static void
+CheckColumnstoreStorageOptions(Oid relid, const duckdb::ColumnstoreStorageOptions &options) {
+	for (auto &column_name : options.sort_by) {
+		AttrNumber attnum = GetStorageOptionColumn(relid, column_name, options.zorder ? "zorder_by" : "sort_by");
+		if (!options.zorder) {
+			continue;
+		}
+		switch (get_atttype(relid, attnum)) {
+		case BOOLOID:
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+		case DATEOID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case UUIDOID:
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		case BYTEAOID:
+			break;
+		default:
+			elog(ERROR, "zorder_by does not support column \"%s\" of type %s", column_name.c_str(),
+			     format_type_be(get_atttype(relid, attnum)));
+		}
+	}
+	for (auto &column_name : options.partition_by) {
+		AttrNumber attnum = GetStorageOptionColumn(relid, column_name, "partition_by");
+		switch (get_atttype(relid, attnum)) {
+		case BOOLOID:
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case NUMERICOID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+			break;
+		default:
+			elog(ERROR, "partition_by does not support column \"%s\" of type %s", column_name.c_str(),
+			     format_type_be(get_atttype(relid, attnum)));
+		}
+	}
+}
+
+/*
+ * Adds the storage options to the reloptions of the new table once it exists,
+ * so that pg_dump emits them in its WITH clause and a restore goes through
+ * ExtractColumnstoreStorageOptions again. Postgres ignores reloptions it
+ * doesn't know when it reads them, and columnstore tables reject ALTER TABLE
+ * SET, the only command that would validate them.
+ */
+static void
+StoreColumnstoreReloptions(Oid relid, List *columnstore_options) {
+	Relation pg_class = table_open(RelationRelationId, RowExclusiveLock);
+	HeapTuple tuple = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid));
+	if (!HeapTupleIsValid(tuple)) {
+		elog(ERROR, "cache lookup failed for relation %u", relid);
+	}
+	bool isnull;
+	Datum reloptions = SysCacheGetAttr(RELOID, tuple, Anum_pg_class_reloptions, &isnull);
+	reloptions = transformRelOptions(isnull ? (Datum)0 : reloptions, columnstore_options, NULL /*namspace*/,
+	                                 NULL /*validnsps*/, false /*acceptOidsOff*/, false /*isReset*/);
+
+	Datum values[Natts_pg_class] = {0};
+	bool nulls[Natts_pg_class] = {false};
+	bool replaces[Natts_pg_class] = {false};
+	values[Anum_pg_class_reloptions - 1] = reloptions;
+	replaces[Anum_pg_class_reloptions - 1] = true;
+	HeapTuple new_tuple = heap_modify_tuple(tuple, RelationGetDescr(pg_class), values, nulls, replaces);
+	CatalogTupleUpdate(pg_class, &new_tuple->t_self, new_tuple);
+	heap_freetuple(new_tuple);
+	heap_freetuple(tuple);
+	table_close(pg_class, RowExclusiveLock);
+	CommandCounterIncrement();
+}
+
 static void
 DuckdbUtilityHook_Cpp(PlannedStmt *pstmt, const char *query_string, bool read_only_tree, ProcessUtilityContext context,
                       ParamListInfo params, struct QueryEnvironment *query_env, DestReceiver *dest,
                       QueryCompletion *qc) {
 	Node *parsetree = pstmt->utilityStmt;
+	duckdb::ColumnstoreStorageOptions storage_options;
+	List *columnstore_options = NIL;
+	bool has_storage_options = false;
 	if (IsA(parsetree, AlterTableStmt)) {
 		AlterTableStmt *stmt = (AlterTableStmt *)pstmt->utilityStmt;
 		if (IsColumnstoreTable(RangeVarGetRelid(stmt->relation, AccessShareLock, false /*missing_ok*/))) {
@@ -131,6 +354,24 @@ DuckdbUtilityHook_Cpp(PlannedStmt *pstmt, const char *query_string, bool read_on
 		if (stmt->into->accessMethod && strcmp(stmt->into->accessMethod, "columnstore") == 0) {
 			elog(ERROR, "CREATE TABLE AS USING columnstore is not supported");
 		}
+	} else if (IsA(parsetree, CreateStmt)) {
+		CreateStmt *stmt = (CreateStmt *)pstmt->utilityStmt;
+		char *access_method = stmt->accessMethod ? stmt->accessMethod : default_table_access_method;
+		if (strcmp(access_method, "columnstore") == 0 && stmt->options) {
+			if (read_only_tree) {
+				pstmt = (PlannedStmt *)copyObjectImpl(pstmt);
+				parsetree = pstmt->utilityStmt;
+				read_only_tree = false;
+			}
+			stmt = (CreateStmt *)parsetree;
+			has_storage_options = ExtractColumnstoreStorageOptions(stmt, storage_options, columnstore_options);
+			/* CREATE TABLE IF NOT EXISTS leaves an existing table alone */
+			if (stmt->if_not_exists && OidIsValid(RangeVarGetRelid(stmt->relation, NoLock, true /*missing_ok*/))) {
+				has_storage_options = false;
+			}
+		}
+		/* Also drops options left behind by a CREATE TABLE that failed */
+		duckdb::Columnstore::SetCreateTableOptions(has_storage_options ? &storage_options : nullptr);
 	}
 
 	/*
@@ -149,6 +390,16 @@ DuckdbUtilityHook_Cpp(PlannedStmt *pstmt, const char *query_string, bool read_on
 	DuckdbHandleDDL(parsetree);
 	prev_process_utility_hook(pstmt, query_string, read_only_tree, context, params, query_env, dest, qc);
 
+	if (has_storage_options) {
+		duckdb::Columnstore::SetCreateTableOptions(nullptr);
+		CreateStmt *stmt = (CreateStmt *)parsetree;
+		Oid relid = RangeVarGetRelid(stmt->relation, NoLock, false /*missing_ok*/);
+		if (IsColumnstoreTable(relid)) {
+			CheckColumnstoreStorageOptions(relid, storage_options);
+			StoreColumnstoreReloptions(relid, columnstore_options);
+		}
+	}
+
 	top_level_ddl = prev_top_level_ddl;
 }
 
@@ -1,10 +1,12 @@
 #include "pgduckdb/pgduckdb_duckdb.hpp"
 #include "columnstore/columnstore.hpp"
+#include "columnstore/columnstore_cache.hpp"
 #include "duckdb.hpp"
 #include "duckdb/common/exception.hpp"
 #include "duckdb/parser/parsed_data/create_table_function_info.hpp"
 #include "pgduckdb/pgduckdb_guc.h"
 #include "duckdb/main/extension_util.hpp"
+#include "duckdb/optimizer/optimizer_extension.hpp"
 #include "duckdb/parser/parsed_data/create_scalar_function_info.hpp"
 #include "duckdb/parser/parsed_data/create_table_function_info.hpp"
 
@@ -13,6 +15,7 @@
 #include "pgduckdb/scan/postgres_seq_scan.hpp"
 #include "pgduckdb/pg/transactions.hpp"
 #include "pgduckdb/pgduckdb_utils.hpp"
+#include "pgmooncake_guc.hpp"
 
 extern "C" {
 #include "postgres.h"
@@ -165,6 +168,13 @@ DuckDBManager::Initialize() {
 	config.SetOptionByName("extension_directory", CreateOrGetDirectoryPath("duckdb_extensions"));
 	// Transforms VIEWs into their view definition
 	config.replacement_scans.emplace_back(pgduckdb::PostgresReplacementScan);
+	duckdb::OptimizerExtension columnstore_optimizer;
+	columnstore_optimizer.optimize_function = duckdb::Columnstore::Optimize;
+	config.optimizer_extensions.push_back(columnstore_optimizer);
+	// Parquet footers are kept across queries, and columnstore scans seed them from the footer cache. The object cache
+	// belongs to the DuckDB instance, so this also keeps footers of the other Parquet files pg_duckdb reads (which
+	// ParquetReader reads again once their modification time changes). It is only on with mooncake.enable_local_cache.
+	config.options.object_cache_enable = mooncake_enable_local_cache;
 	SET_DUCKDB_OPTION(allow_unsigned_extensions);
 	SET_DUCKDB_OPTION(enable_external_access);
 	SET_DUCKDB_OPTION(autoinstall_known_extensions);
@@ -205,6 +215,10 @@ DuckDBManager::Initialize() {
 
 	database = new duckdb::DuckDB(connection_string, &config);
 
+	auto &file_system = duckdb::FileSystem::GetFileSystem(*database->instance);
+	file_system.RegisterSubSystem(duckdb::make_uniq<duckdb::ColumnstoreCacheFileSystem>(file_system));
+	duckdb::ColumnstoreCache::LoadExistingFiles();
+
 	auto &dbconfig = duckdb::DBConfig::GetConfig(*database->instance);
 	dbconfig.storage_extensions["pgduckdb"] = duckdb::make_uniq<PostgresStorageExtension>();
 	duckdb::ExtensionInstallInfo extension_install_info;
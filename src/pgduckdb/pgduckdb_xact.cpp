@@ -136,6 +136,27 @@ DuckdbXactCallback_Cpp(XactEvent event) {
 	 */
 	top_level_statement = true;
 
+	/*
+	 * Columnstore tables are also written without DuckDB (e.g. TRUNCATE), so
+	 * their lake changes are handled before looking at the DuckDB transaction.
+	 */
+	switch (event) {
+	case XACT_EVENT_PRE_COMMIT:
+	case XACT_EVENT_PARALLEL_PRE_COMMIT:
+		duckdb::Columnstore::PreCommit();
+		break;
+	case XACT_EVENT_COMMIT:
+	case XACT_EVENT_PARALLEL_COMMIT:
+		duckdb::Columnstore::Commit();
+		break;
+	case XACT_EVENT_ABORT:
+	case XACT_EVENT_PARALLEL_ABORT:
+		duckdb::Columnstore::Abort();
+		break;
+	default:
+		break;
+	}
+
 	/* If DuckDB is not initialized there's no need to do anything */
 	if (!DuckDBManager::IsInitialized()) {
 		return;
@@ -169,7 +190,6 @@ DuckdbXactCallback_Cpp(XactEvent event) {
 		duckdb_command_id = -1;
 		// Abort the DuckDB transaction too
 		context.transaction.Rollback(nullptr);
-		duckdb::Columnstore::Abort();
 		break;
 
 	case XACT_EVENT_PREPARE:
@@ -179,7 +199,6 @@ DuckdbXactCallback_Cpp(XactEvent event) {
 
 	case XACT_EVENT_COMMIT:
 	case XACT_EVENT_PARALLEL_COMMIT:
-		duckdb::Columnstore::Commit();
 		// No action needed for commit event, we already did committed the
 		// DuckDB transaction in the PRE_COMMIT event. We don't commit the
 		// DuckDB transaction here, because any failure to commit would
@@ -8,11 +8,27 @@ extern "C" {
 }
 
 void MooncakeInitGUC();
+void MooncakeInitCompactionWorker();
+void MooncakeInitLakeWorker();
+void MooncakeInitCache();
 void DuckdbInitHooks();
 
 bool mooncake_allow_local_tables = true;
 char *mooncake_default_bucket = strdup("");
 bool mooncake_enable_local_cache = true;
+int mooncake_local_cache_size = 10 * 1024;
+int mooncake_write_buffer_rows = 0;
+int mooncake_write_buffer_flush_rows = 122880;
+int mooncake_write_buffer_flush_size = 64 * 1024;
+int mooncake_write_buffer_flush_interval = 60;
+int mooncake_compaction_target_file_size = 1024 * 1024;
+int mooncake_compaction_min_file_count = 8;
+char *mooncake_compaction_database = strdup("");
+int mooncake_compaction_naptime = 60;
+int mooncake_max_lake_workers = 4;
+int mooncake_lake_naptime = 1000;
+int mooncake_lake_commit_delay = 10;
+double mooncake_deletion_vector_threshold = 0.1;
 
 extern "C" {
 PG_MODULE_MAGIC;
@@ -24,9 +40,13 @@ void _PG_init() {
     DuckdbInitHooks();
     DuckdbInitNode();
     pgduckdb::RegisterDuckdbXactCallback();
+    MooncakeInitCompactionWorker();
+    MooncakeInitLakeWorker();
+    MooncakeInitCache();
 
     auto local_fs = duckdb::FileSystem::CreateLocal();
     local_fs->CreateDirectory("mooncake_local_cache");
+    local_fs->CreateDirectory("mooncake_local_cache/footers");
     local_fs->CreateDirectory("mooncake_local_tables");
 }
 }
@@ -3,3 +3,16 @@
 extern bool mooncake_allow_local_tables;
 extern char *mooncake_default_bucket;
 extern bool mooncake_enable_local_cache;
+extern int mooncake_local_cache_size;
+extern int mooncake_write_buffer_rows;
+extern int mooncake_write_buffer_flush_rows;
+extern int mooncake_write_buffer_flush_size;
+extern int mooncake_write_buffer_flush_interval;
+extern int mooncake_compaction_target_file_size;
+extern int mooncake_compaction_min_file_count;
+extern char *mooncake_compaction_database;
+extern int mooncake_compaction_naptime;
+extern int mooncake_max_lake_workers;
+extern int mooncake_lake_naptime;
+extern int mooncake_lake_commit_delay;
+extern double mooncake_deletion_vector_threshold;
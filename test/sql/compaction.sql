@@ -0,0 +1,13 @@
+CREATE TABLE t (a int, b text) USING columnstore;
+INSERT INTO t VALUES (1, 'a');
+INSERT INTO t VALUES (2, 'b');
+INSERT INTO t VALUES (3, 'c');
+SELECT mooncake.compact('t');
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+
+SELECT mooncake.set_compaction_policy('t', min_file_count => 2);
+SELECT mooncake.compact('t');
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+SELECT * FROM t ORDER BY a;
+
+DROP TABLE t;
@@ -0,0 +1,16 @@
+CREATE TABLE t (a int, b text) USING columnstore;
+INSERT INTO t VALUES (1, 'a'), (2, 'b');
+INSERT INTO t VALUES (3, 'c'), (4, 'd');
+INSERT INTO t VALUES (5, 'e'), (6, 'f');
+
+-- the first two files are dropped without being read
+DELETE FROM t WHERE a < 5;
+SELECT * FROM t ORDER BY a;
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+
+-- files with NULLs in the filtered column go through the row-level path
+INSERT INTO t VALUES (NULL, 'x'), (7, 'y');
+DELETE FROM t WHERE a > 5;
+SELECT * FROM t ORDER BY a;
+
+DROP TABLE t;
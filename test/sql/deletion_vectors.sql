@@ -0,0 +1,41 @@
+-- With the default threshold, deleting under 10% of a file's rows extends its deletion vector
+CREATE TABLE t (a int, b text) USING columnstore WITH (lake_format = 'none');
+INSERT INTO t SELECT i, 'r' || i FROM generate_series(1, 20) AS i;
+DELETE FROM t WHERE a = 2;
+SELECT * FROM t WHERE a <= 4 ORDER BY a;
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+SELECT deleted_count FROM mooncake.deletion_vectors WHERE oid = 't'::regclass;
+DELETE FROM t WHERE a = 3;
+SELECT count(*), sum(a) FROM t;
+SELECT count(*) FROM mooncake.deletion_vectors WHERE oid = 't'::regclass;
+DROP TABLE t;
+
+SET mooncake.deletion_vector_threshold = 0.9;
+CREATE TABLE t (a int, b text) USING columnstore WITH (lake_format = 'none');
+INSERT INTO t VALUES (1, 'a'), (2, 'b'), (3, 'c'), (4, 'd');
+
+DELETE FROM t WHERE a = 2;
+SELECT * FROM t ORDER BY a;
+DELETE FROM t WHERE a = 3;
+SELECT * FROM t WHERE a > 1;
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+SELECT deleted_count FROM mooncake.deletion_vectors WHERE oid = 't'::regclass;
+
+UPDATE t SET b = 'e' WHERE a = 4;
+SELECT * FROM t ORDER BY a;
+
+DELETE FROM t WHERE a = 1;
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+SELECT count(*) FROM mooncake.deletion_vectors WHERE oid = 't'::regclass;
+SELECT * FROM t ORDER BY a;
+
+DROP TABLE t;
+
+-- Lake readers don't see deletion vectors, so tables with a lake table always rewrite
+CREATE TABLE t (a int) USING columnstore;
+INSERT INTO t VALUES (1), (2), (3), (4);
+DELETE FROM t WHERE a = 2;
+SELECT count(*) FROM mooncake.deletion_vectors WHERE oid = 't'::regclass;
+SELECT * FROM t ORDER BY a;
+DROP TABLE t;
+RESET mooncake.deletion_vector_threshold;
@@ -0,0 +1,21 @@
+CREATE TABLE t (a int, b text, c int[]) USING columnstore WITH (lake_format = 'iceberg');
+SELECT lake_format FROM mooncake.storage_options WHERE oid = 't'::regclass;
+INSERT INTO t VALUES (1, 'a', ARRAY[1]), (2, 'b', NULL);
+SELECT mooncake.flush_lake('t');
+DELETE FROM t WHERE a = 1;
+SELECT mooncake.flush_lake('t');
+SELECT * FROM t;
+SELECT pg_read_file(path || 'metadata/version-hint.text') AS version
+FROM mooncake.columnstore_tables WHERE table_name = 't';
+SELECT m->'format-version' AS format_version, jsonb_path_query_array(m, '$.schemas[0].fields[*].id') AS field_ids,
+    s->'summary'->>'operation' AS operation, s->'summary'->>'total-records' AS total_records
+FROM (SELECT pg_read_file(path || 'metadata/v3.metadata.json')::jsonb AS m
+      FROM mooncake.columnstore_tables WHERE table_name = 't') AS p,
+    jsonb_array_elements(m->'snapshots') AS s
+WHERE s->'snapshot-id' = m->'current-snapshot-id';
+SELECT count(*) FILTER (WHERE f LIKE 'snap-%.avro') AS manifest_lists,
+    count(*) FILTER (WHERE f LIKE '%.metadata.json') AS metadata_files
+FROM pg_ls_dir((SELECT path FROM mooncake.columnstore_tables WHERE table_name = 't') || 'metadata') AS f;
+DROP TABLE t;
+
+CREATE TABLE t (a int) USING columnstore WITH (lake_format = 'hudi');
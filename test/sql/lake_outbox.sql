@@ -0,0 +1,28 @@
+CREATE TABLE t (a int) USING columnstore;
+BEGIN;
+INSERT INTO t VALUES (1), (2);
+SELECT is_add_file, file_size > 0 AS has_size FROM mooncake.lake_outbox WHERE oid = 't'::regclass;
+COMMIT;
+SELECT mooncake.flush_lake('t');
+SELECT count(*) FROM mooncake.lake_outbox WHERE oid = 't'::regclass;
+
+BEGIN;
+INSERT INTO t VALUES (3);
+ROLLBACK;
+SELECT count(*) FROM mooncake.lake_outbox WHERE oid = 't'::regclass;
+
+-- A data file added and removed in the same transaction never reaches the lake
+BEGIN;
+INSERT INTO t VALUES (3);
+DELETE FROM t WHERE a = 3;
+COMMIT;
+SELECT mooncake.flush_lake('t');
+DELETE FROM t WHERE a >= 1;
+SELECT mooncake.flush_lake('t');
+SELECT f,
+    (SELECT count(*) FROM regexp_split_to_table(pg_read_file(d || f), E'\n') AS line WHERE line LIKE '{"add"%') AS adds,
+    (SELECT count(*) FROM regexp_split_to_table(pg_read_file(d || f), E'\n') AS line WHERE line LIKE '{"remove"%')
+        AS removes
+FROM (SELECT path || '_delta_log/' AS d FROM mooncake.columnstore_tables WHERE table_name = 't') AS p, pg_ls_dir(d) AS f
+WHERE f LIKE '%.json' ORDER BY f;
+DROP TABLE t;
@@ -0,0 +1,9 @@
+CREATE TABLE t (a int, b text, c float8, d date, e timestamp) USING columnstore;
+INSERT INTO t VALUES (1, 'x', 1.5, '2024-01-01', '2024-01-01 10:00:00.123456'),
+    (3, 'y', NULL, '2024-03-01', '2024-01-02 00:00:00'), (NULL, 'z', -2.5, NULL, NULL);
+SELECT mooncake.flush_lake('t');
+SELECT (line::jsonb->'add'->>'stats')::jsonb AS stats
+FROM regexp_split_to_table(pg_read_file((SELECT path FROM mooncake.columnstore_tables WHERE table_name = 't') ||
+    '_delta_log/00000000000000000001.json'), E'\n') AS line
+WHERE line LIKE '{"add"%';
+DROP TABLE t;
@@ -0,0 +1,49 @@
+SET mooncake.deletion_vector_threshold = 0.9;
+-- Deletion vectors only exist on tables without a lake table
+CREATE TABLE t (a int, b text) USING columnstore WITH (lake_format = 'none');
+INSERT INTO t VALUES (1, 'a'), (2, NULL), (3, 'c');
+INSERT INTO t VALUES (10, 'x'), (11, 'y'), (12, 'z');
+
+-- Which operators the DuckDB plan of a query has: answered from the catalog, the aggregate is replaced by a projection
+-- over a dummy scan
+CREATE FUNCTION plan_operators(query text, OUT dummy_scan bool, OUT aggregate bool, OUT columnstore_scan bool) AS $$
+DECLARE
+    plan text := '';
+    line text;
+BEGIN
+    FOR line IN EXECUTE 'EXPLAIN ' || query LOOP
+        plan := plan || line || E'\n';
+    END LOOP;
+    dummy_scan := plan LIKE '%DUMMY_SCAN%';
+    aggregate := plan LIKE '%AGGREGATE%';
+    columnstore_scan := plan LIKE '%COLUMNSTORE_SCAN%';
+END $$ LANGUAGE plpgsql;
+
+SELECT count(*), count(b), min(a), max(a), min(b), max(b) FROM t;
+SELECT * FROM plan_operators('SELECT count(*), count(b), min(a), max(a), min(b), max(b) FROM t');
+SELECT count(*), min(a), max(a) FROM t WHERE a >= 10;
+SELECT * FROM plan_operators('SELECT count(*), min(a), max(a) FROM t WHERE a >= 10');
+-- The first file matches only in part, so it is scanned
+SELECT count(*), min(a), max(a) FROM t WHERE a >= 2;
+SELECT * FROM plan_operators('SELECT count(*), min(a), max(a) FROM t WHERE a >= 2');
+SELECT count(*), min(a) FROM t WHERE a > 100;
+
+-- count(*) subtracts deleted rows, min/max/count(column) scan files with deletion vectors since their stats still
+-- cover the deleted rows
+DELETE FROM t WHERE a = 12;
+SELECT count(*) FROM mooncake.deletion_vectors WHERE oid = 't'::regclass;
+SELECT count(*) FROM t;
+SELECT * FROM plan_operators('SELECT count(*) FROM t');
+SELECT count(*), count(b), min(a), max(a) FROM t;
+SELECT * FROM plan_operators('SELECT max(a) FROM t');
+SELECT count(*) FROM t WHERE a >= 10;
+
+SET mooncake.write_buffer_rows = 10;
+INSERT INTO t VALUES (20, 'w');
+SELECT count(*), min(a), max(a) FROM t;
+SELECT count(*) FROM t WHERE a < 5;
+
+DROP TABLE t;
+DROP FUNCTION plan_operators;
+RESET mooncake.write_buffer_rows;
+RESET mooncake.deletion_vector_threshold;
@@ -0,0 +1,35 @@
+CREATE TABLE t (d int, s text, v int) USING columnstore WITH (partition_by = 'd, s');
+INSERT INTO t VALUES (1, 'a', 1), (1, 'a b', 2), (2, 'a', 3), (2, NULL, 4), (1, 'a', 5);
+SELECT partition_by FROM mooncake.storage_options WHERE oid = 't'::regclass;
+SELECT regexp_replace(file_name, '/[^/]*$', '') AS partition, row_count FROM mooncake.data_files
+    WHERE oid = 't'::regclass ORDER BY partition COLLATE "C";
+SELECT * FROM t WHERE d = 2 ORDER BY v;
+
+DELETE FROM t WHERE d = 1;
+SELECT regexp_replace(file_name, '/[^/]*$', '') AS partition, row_count FROM mooncake.data_files
+    WHERE oid = 't'::regclass ORDER BY partition COLLATE "C";
+SELECT * FROM t ORDER BY v;
+
+INSERT INTO t VALUES (2, 'a', 6);
+SELECT mooncake.set_compaction_policy('t', min_file_count => 2);
+SELECT mooncake.compact('t');
+SELECT regexp_replace(file_name, '/[^/]*$', '') AS partition, row_count FROM mooncake.data_files
+    WHERE oid = 't'::regclass ORDER BY partition COLLATE "C";
+SELECT * FROM t ORDER BY v;
+DROP TABLE t;
+
+-- Partition directories escape column names, and a DELETE drops whole partitions by their value, NULL and long text
+-- included
+CREATE TABLE t ("a/b=c" int, s text) USING columnstore
+    WITH (lake_format = 'none', partition_by = '"a/b=c", s');
+INSERT INTO t VALUES (1, NULL), (1, repeat('x', 100)), (2, 'y');
+SELECT left(regexp_replace(file_name, '/[^/]*$', ''), 40) AS partition, row_count FROM mooncake.data_files
+    WHERE oid = 't'::regclass ORDER BY partition COLLATE "C";
+DELETE FROM t WHERE s IS NULL;
+DELETE FROM t WHERE s = repeat('x', 100);
+SELECT * FROM t;
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+DROP TABLE t;
+
+CREATE TABLE t (a int) USING columnstore WITH (partition_by = 'b');
+CREATE TABLE t (a int, b float8) USING columnstore WITH (partition_by = 'b');
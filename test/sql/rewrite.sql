@@ -0,0 +1,18 @@
+CREATE TABLE t (a int) USING columnstore;
+INSERT INTO t SELECT * FROM generate_series(1, 300000);
+
+DELETE FROM t WHERE a = 150000;
+SELECT count(*), sum(a) FROM t;
+SELECT * FROM t WHERE a BETWEEN 149999 AND 150001 ORDER BY a;
+
+UPDATE t SET a = -a WHERE a = 1;
+SELECT count(*), sum(a) FROM t;
+
+DROP TABLE t;
+
+-- Row groups copied out of a file with a list column get exact stats for its other columns
+CREATE TABLE t (a int, c int[]) USING columnstore WITH (row_group_size = 1000);
+INSERT INTO t SELECT i, CASE WHEN i % 2 = 0 THEN ARRAY[i] END FROM generate_series(1, 3000) i;
+DELETE FROM t WHERE a <= 1000;
+SELECT count(*), count(a), min(a), max(a), count(c) FROM t;
+DROP TABLE t;
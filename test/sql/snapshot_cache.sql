@@ -0,0 +1,42 @@
+CREATE TABLE t (a int) USING columnstore;
+INSERT INTO t VALUES (1), (2);
+
+BEGIN ISOLATION LEVEL REPEATABLE READ;
+SELECT count(*) FROM t;
+INSERT INTO t VALUES (3);
+SELECT * FROM t ORDER BY a;
+DELETE FROM t WHERE a = 1;
+SELECT * FROM t ORDER BY a;
+COMMIT;
+
+BEGIN;
+DELETE FROM t WHERE a = 2;
+SELECT * FROM t ORDER BY a;
+ROLLBACK;
+
+SELECT * FROM t ORDER BY a;
+
+-- Catalog rows of a rolled back subtransaction are never served from the cache. DuckDB doesn't support subtransactions,
+-- so they are rolled back around a write it refuses and around a direct change of the catalog.
+DO $$
+DECLARE
+    n bigint;
+BEGIN
+    SELECT count(*) INTO n FROM t;
+    BEGIN
+        INSERT INTO t VALUES (4);
+        RAISE EXCEPTION 'rollback';
+    EXCEPTION WHEN OTHERS THEN
+        NULL;
+    END;
+    BEGIN
+        DELETE FROM mooncake.data_files WHERE oid = 't'::regclass;
+        RAISE EXCEPTION 'rollback';
+    EXCEPTION WHEN OTHERS THEN
+        NULL;
+    END;
+    SELECT count(*) INTO n FROM t;
+    RAISE NOTICE 'rows: %', n;
+END $$;
+SELECT * FROM t ORDER BY a;
+DROP TABLE t;
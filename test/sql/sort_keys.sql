@@ -0,0 +1,20 @@
+CREATE TABLE t (a int, b text) USING columnstore WITH (sort_by = 'a');
+INSERT INTO t VALUES (3, 'c'), (1, 'a'), (2, 'b');
+SELECT * FROM t;
+INSERT INTO t VALUES (6, 'f'), (4, 'd'), (5, 'e');
+
+SELECT mooncake.set_compaction_policy('t', min_file_count => 2);
+SELECT mooncake.compact('t');
+SELECT count(*) FROM mooncake.data_files WHERE oid = 't'::regclass;
+SELECT * FROM t;
+DROP TABLE t;
+
+CREATE TABLE t (x int, y int) USING columnstore WITH (zorder_by = 'x, y');
+INSERT INTO t SELECT x, y FROM generate_series(3, 0, -1) x, generate_series(3, 0, -1) y;
+SELECT sort_by, zorder FROM mooncake.storage_options WHERE oid = 't'::regclass;
+SELECT * FROM t;
+DROP TABLE t;
+
+CREATE TABLE t (a int) USING columnstore WITH (sort_by = 'b');
+CREATE TABLE t (a int, b int) USING columnstore WITH (sort_by = 'a', zorder_by = 'a, b');
+CREATE TABLE t (a int, b jsonb) USING columnstore WITH (zorder_by = 'a, b');
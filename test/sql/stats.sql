@@ -0,0 +1,15 @@
+CREATE TABLE t (a int, b text) USING columnstore;
+INSERT INTO t VALUES (1, 'a'), (2, NULL);
+INSERT INTO t VALUES (3, 'c'), (4, 'd');
+SELECT row_count, column_names, null_counts, min_values, max_values
+FROM mooncake.data_files WHERE oid = 't'::regclass ORDER BY min_values;
+SELECT * FROM t WHERE a > 2 ORDER BY a;
+SELECT * FROM t WHERE b = 'a';
+SELECT * FROM t WHERE a > 4;
+
+DELETE FROM t WHERE a = 4;
+SELECT * FROM t ORDER BY a;
+
+SELECT pg_relation_size('t') = sum(file_size) FROM mooncake.data_files WHERE oid = 't'::regclass;
+
+DROP TABLE t;
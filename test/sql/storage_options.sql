@@ -0,0 +1,34 @@
+CREATE TABLE t (a int, b text) USING columnstore WITH (compression = 'zstd', compression_level = 9,
+    dictionary_compression_ratio_threshold = -1, row_group_size = 1000, file_size_bytes = 1);
+SELECT compression, compression_level, dictionary_compression_ratio_threshold, row_group_size, file_size_bytes
+FROM mooncake.storage_options WHERE oid = 't'::regclass;
+INSERT INTO t SELECT i, 'b' || i FROM generate_series(1, 3000) i;
+SELECT count(*) > 1 AS rotated FROM mooncake.data_files WHERE oid = 't'::regclass;
+SELECT count(*), sum(a) FROM t;
+DROP TABLE t;
+
+CREATE TABLE t (a int) USING columnstore WITH (compression = 'lz4', fillfactor = 100);
+-- Kept for pg_dump
+SELECT reloptions FROM pg_class WHERE oid = 't'::regclass;
+INSERT INTO t VALUES (1), (2), (3);
+SELECT * FROM t ORDER BY a;
+DROP TABLE t;
+
+CREATE TABLE t (a int) USING columnstore WITH (checkpoint_interval = 2, log_retention = '7 days');
+SELECT checkpoint_interval, log_retention_secs FROM mooncake.storage_options WHERE oid = 't'::regclass;
+INSERT INTO t VALUES (1);
+SELECT mooncake.flush_lake('t');
+INSERT INTO t VALUES (2);
+SELECT mooncake.flush_lake('t');
+INSERT INTO t VALUES (3);
+SELECT mooncake.flush_lake('t');
+SELECT count(*) > 0 AS checkpointed
+FROM pg_ls_dir((SELECT path FROM mooncake.columnstore_tables WHERE table_name = 't') || '_delta_log') AS f
+WHERE f LIKE '%.checkpoint.parquet';
+DROP TABLE t;
+
+CREATE TABLE t (a int) USING columnstore WITH (compression = 'lzo');
+CREATE TABLE t (a int) USING columnstore WITH (compression_level = 3);
+CREATE TABLE t (a int) USING columnstore WITH (row_group_size = 0);
+CREATE TABLE t (a int) USING columnstore WITH (checkpoint_interval = 0);
+CREATE TABLE t (a int) USING columnstore WITH (log_retention = '-1 day');
@@ -0,0 +1,26 @@
+SET mooncake.write_buffer_rows = 10;
+CREATE TABLE t (a int, b text) USING columnstore;
+INSERT INTO t VALUES (1, 'a'), (2, 'b');
+INSERT INTO t VALUES (3, 'c');
+SELECT count(*) FROM mooncake.buffered_files WHERE oid = 't'::regclass;
+SELECT * FROM t ORDER BY a;
+
+DELETE FROM t WHERE a = 2;
+SELECT count(*) FROM mooncake.buffered_files WHERE oid = 't'::regclass;
+SELECT * FROM t ORDER BY a;
+
+SET mooncake.write_buffer_flush_rows = 2;
+INSERT INTO t VALUES (4, 'd');
+SELECT count(*) FROM mooncake.buffered_files WHERE oid = 't'::regclass;
+SELECT * FROM t ORDER BY a;
+
+DROP TABLE t;
+
+RESET mooncake.write_buffer_flush_rows;
+SET mooncake.write_buffer_rows = 3000;
+CREATE TABLE t (a int) USING columnstore WITH (row_group_size = 1000, file_size_bytes = 1);
+INSERT INTO t SELECT i FROM generate_series(1, 3000) i;
+-- Each buffered file records its own rows
+SELECT count(*) > 1 AS split, sum(row_count) FROM mooncake.buffered_files WHERE oid = 't'::regclass;
+SELECT count(*) FROM t;
+DROP TABLE t;